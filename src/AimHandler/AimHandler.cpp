@@ -1,24 +1,22 @@
 #include "AimHandler.h"
 #include "../GPIOHandler/GPIOHandler.h"
 #include "../ServoHandler/ServoHandler.h"
+#include "../MotionController/MotionController.h"
 #include "../Logger/Logger.h"
 #include "../ExceptionExtensions/ExceptionExtensions.h"
 #include "../LaserHandler/LaserHandler.h"
+#include "../PulseEngine/PulseEngine.h"
 #include "../DbHandler/DbHandler.h"
+#include "../SafetyTrace/SafetyTrace.h"
 
 namespace DebuggerInfrastructure
 {
     std::mutex AimHandler::mtx;
-    ServoHandler* AimHandler::XServoPtr = nullptr;
-    ServoHandler* AimHandler::YServoPtr = nullptr;
-    std::pair<double, double> AimHandler::defaultState = {0,0};
-    bool AimHandler::m_initialized = false;
-    bool AimHandler::locked = false;
-    bool AimHandler::calibrationActive = false;
-    CalibrationSettings AimHandler::calbration;
-    std::chrono::_V2::system_clock::time_point AimHandler::lastShoot;
+    std::vector<std::unique_ptr<AimHandler>> AimHandler::turrets;
+    std::atomic<bool> AimHandler::m_initialized{false};
+    std::atomic<bool> AimHandler::calibrationActive{false};
 
-    void AimHandler::Initialize(int pwmChip, int xChannel, int yChannel, std::string calibrationPath)
+    void AimHandler::Initialize(std::vector<TurretSettings> turretSettings, std::string calibrationPath)
     {
         std::lock_guard<std::mutex> guard(mtx);
 
@@ -26,83 +24,225 @@ namespace DebuggerInfrastructure
             Logger::Info("AimHandler already initialized");
             return;
         }
-        calbration = ExternalConfigsHelper::getOrCreateCalibrationSettings(calibrationPath);
-        XServoPtr = new ServoHandler(pwmChip, xChannel, 50.0);
-        YServoPtr = new ServoHandler(pwmChip, yChannel, 50.0);
+        if (turretSettings.empty()) {
+            throw std::runtime_error("AimHandler needs at least one turret");
+        }
+        RegionMask fireZone(ExternalConfigsHelper::getOrCreateRegionSettings(calibrationPath));
+        MotionLimits limits = ExternalConfigsHelper::getOrCreateMotionLimits(calibrationPath);
+        for (size_t id = 0; id < turretSettings.size(); id++) {
+            turrets.push_back(std::make_unique<AimHandler>(id, turretSettings[id],
+                ExternalConfigsHelper::getOrCreateCalibrationSettings(calibrationPath, id), limits));
+            turrets.back()->SetFireZone(fireZone);
+        }
         m_initialized = true;
+        Logger::Info("AimHandler initialized with {} turret(s)", turrets.size());
+    }
+
+    size_t AimHandler::Count()
+    {
+        return turrets.size();
+    }
+
+    AimHandler& AimHandler::Get(size_t turret)
+    {
+        CheckIfInitialized(NAMEOF(AimHandler::Get));
+        if (turret >= turrets.size())
+            throw BadRequestException(fmt::format("There is no turret {}.", turret).c_str());
+        return *turrets[turret];
+    }
+
+    AimHandler::AimHandler(size_t id, const TurretSettings& settings, CalibrationSettings calibration, const MotionLimits& limits)
+        : m_id(id)
+        , m_settings(settings)
+    {
+        SetCalibration(std::move(calibration));
+        m_xServo = std::make_unique<ServoHandler>(settings.pwmChip, settings.xChannel, 50.0, settings.pwmRoot);
+        m_yServo = std::make_unique<ServoHandler>(settings.pwmChip, settings.yChannel, 50.0, settings.pwmRoot);
+        m_feedback = std::make_unique<ServoFeedback>(settings.feedback, settings.pwmChip, settings.xChannel, settings.yChannel);
+        m_motion = std::make_unique<MotionController>(*m_xServo, *m_yServo, limits, std::make_pair(0.0, 0.0),
+                                                      [this] { OnArrival(); }, fmt::format("control {}", id), m_feedback.get());
+        Logger::Info("Turret {} on pwmchip{} channels {}/{}, laser line {}, feedback {}/{}", id, settings.pwmChip,
+                     settings.xChannel, settings.yChannel, settings.laserLine, settings.feedback.x.source, settings.feedback.y.source);
+    }
+
+    AimHandler::~AimHandler()
+    {
+        // The controller drives the servos, it has to stop first
+        m_motion.reset();
+        m_feedback.reset();
+        m_xServo.reset();
+        m_yServo.reset();
+    }
+
+    size_t AimHandler::Id() const
+    {
+        return m_id;
+    }
+
+    const TurretSettings& AimHandler::GetSettings() const
+    {
+        return m_settings;
+    }
+
+    CalibrationSettings AimHandler::GetCalibration()
+    {
+        std::lock_guard<std::mutex> guard(m_calibrationMutex);
+        return m_calibration;
+    }
+
+    void AimHandler::SetCalibration(CalibrationSettings settings)
+    {
+        CalibrationModel model(settings);
+        const CalibrationReport& report = model.Report();
+        Logger::Info("Turret {} calibration model: {} fit from {} points, RMS error {:.3f} deg, max error {:.3f} deg",
+                     m_id, CalibrationModel::FitName(report.fit), report.points, report.rmsError, report.maxError);
+
+        std::lock_guard<std::mutex> guard(m_calibrationMutex);
+        m_calibration = std::move(settings);
+        m_calibrationModel = std::move(model);
+    }
+
+    std::pair<double, double> AimHandler::MapPoint(std::pair<double, double> point)
+    {
+        std::lock_guard<std::mutex> guard(m_calibrationMutex);
+        return m_calibrationModel.Map(point);
+    }
+
+    void AimHandler::SetFireZone(RegionMask zone)
+    {
+        std::lock_guard<std::mutex> guard(m_calibrationMutex);
+        m_fireZone = std::move(zone);
+    }
+
+    bool AimHandler::IsOnTarget()
+    {
+        return m_motion->IsOnTarget();
+    }
+
+    double AimHandler::EstimateTravelMs(std::pair<double, double> point)
+    {
+        return m_motion->EstimateTravelMs(MapPoint(point));
+    }
+
+    FeedbackStats AimHandler::GetFeedbackStats() const
+    {
+        return m_feedback->GetStats();
     }
 
     std::chrono::_V2::system_clock::time_point AimHandler::GetLastShoot()
     {
-        return AimHandler::lastShoot;
+        return m_state.Load().lastShoot;
+    }
+
+    TurretState AimHandler::GetState() const
+    {
+        return m_state.Load();
     }
 
     std::string AimHandler::ShootAt(std::pair<double, double> point)
     {
-        std::string response = fmt::format("Shooting at X({}) Y({})\t", point.first, point.second);
-        if(!IsLaserEnabled())
+        CheckFireZone(point);
+        std::string response = fmt::format("Turret {} shooting at X({}) Y({})\t", m_id, point.first, point.second);
+        response += SetPoint(point) + "\t";
+        // Small corrections keep the laser on, anything further is fired by the controller once the turret settled
+        if(m_motion->IsWithinTolerance(m_motion->GetTarget()))
         {
-            response += LaserHandler::Enable() + "\t";
+            if(PulseEngine::EngagesInPulses())
+            {
+                if(!PulseEngine::IsBusy(m_id))
+                {
+                    response += PulseEngine::Fire(m_id);
+                }
+            }
+            else if(!IsLaserEnabled())
+            {
+                response += LaserHandler::Enable(m_id);
+            }
         }
-        response += SetPoint(point);
-        lastShoot = std::chrono::_V2::system_clock::now();
+        else
+        {
+            PulseEngine::Abort(m_id);
+            if(IsLaserEnabled())
+            {
+                response += LaserHandler::Disable(m_id) + "\t";
+            }
+            m_motion->Arm();
+            response += "Laser armed for arrival";
+        }
+        auto now = std::chrono::_V2::system_clock::now();
+        m_state.Update([now](TurretState& state) { state.lastShoot = now; });
         return response;
     }
 
     bool AimHandler::IsLaserEnabled()
     {
-        return LaserHandler::GetStatus()=="Enabled";
+        return LaserHandler::IsEnabled(m_id);
     }
 
+    bool AimHandler::IsEngaged()
+    {
+        return IsLaserEnabled() || m_motion->IsArmed() || PulseEngine::IsBusy(m_id);
+    }
 
-
+    void AimHandler::OnArrival()
+    {
+        // Runs on the motion thread, must not take m_mutex: the destructor joins that thread
+        try
+        {
+            if(PulseEngine::EngagesInPulses())
+            {
+                if(!PulseEngine::IsBusy(m_id))
+                {
+                    Logger::Info(PulseEngine::Fire(m_id));
+                }
+            }
+            else if(!IsLaserEnabled())
+            {
+                Logger::Info(LaserHandler::Enable(m_id));
+            }
+        }
+        catch(const std::exception& ex)
+        {
+            Logger::Warning("Turret {} laser not enabled on arrival: {}", m_id, ex.what());
+        }
+    }
 
     std::string AimHandler::SetPoint(std::pair<double, double> point)
     {
-        if (locked) throw BadRequestException("Servos locked, cannot move.");
+        if (m_state.Load().locked) throw BadRequestException("Servos locked, cannot move.");
 
         if (point.first < 0.0 || point.first > 1.0 || point.second < 0.0 || point.second > 1.0)
             throw BadRequestException("Invalid point. Must be in range [0, 1].");
 
-        point.second = 1.0 - point.second;    
-
-        double angleX;
-        if (point.first < 0.5) {
-            angleX = AimHandler::calbration.calibrationX.first + 
-                    (AimHandler::calbration.calibrationCenter.first - AimHandler::calbration.calibrationX.first) * (point.first / 0.5);
-        } else {
-            angleX = AimHandler::calbration.calibrationCenter.first + 
-                    (AimHandler::calbration.calibrationX.second - AimHandler::calbration.calibrationCenter.first) * ((point.first - 0.5) / 0.5);
-        }
-
-        double angleY;
-        if (point.second < 0.5) {
-            angleY = AimHandler::calbration.calibrationY.first + 
-                    (AimHandler::calbration.calibrationCenter.second - AimHandler::calbration.calibrationY.first) * (point.second / 0.5);
-        } else {
-            angleY = AimHandler::calbration.calibrationCenter.second + 
-                    (AimHandler::calbration.calibrationY.second - AimHandler::calbration.calibrationCenter.second) * ((point.second - 0.5) / 0.5);
-        }
-        
-        return SetAnglePoint({angleX, angleY});
+        CheckFireZone(point);
+        return SetAnglePoint(MapPoint(point));
     }
 
     std::string AimHandler::Disarm()
     {
-        std::string response = fmt::format("Disarming\t");
-        response += LaserHandler::Disable() + "\t";
-        response += SetAnglePoint(defaultState);
+        std::string response = fmt::format("Turret {} disarming\t", m_id);
+        m_motion->Disarm();
+        PulseEngine::Abort(m_id);
+        if(IsLaserEnabled())
+        {
+            response += LaserHandler::Disable(m_id) + "\t";
+        }
+        TurretState state = m_state.Load();
+        response += SetAnglePoint({state.defaultX, state.defaultY});
         return response;
     }
 
     std::string AimHandler::EnableCalibration()
     {
         std::string response = fmt::format("Enabling calibration\t");
-        if(!IsLaserEnabled())
+        for (auto& turret : turrets)
         {
-            response += LaserHandler::Enable() + "\t";
+            if(!turret->IsLaserEnabled())
+            {
+                response += LaserHandler::Enable(turret->m_id) + "\t";
+            }
         }
-        calibrationActive = true;
+        calibrationActive.store(true);
         DbHandler::InsertDataNow(CALIBRATIONSTART, NAMEOF(RESTApi), "System entered the calibration mode.");
         return response;
     }
@@ -110,13 +250,15 @@ namespace DebuggerInfrastructure
     std::string AimHandler::DisableCalibration()
     {
         std::string response = fmt::format("Disabling calibration\t");
-        if(IsLaserEnabled())
+        for (auto& turret : turrets)
         {
-            response += LaserHandler::Disable() + "\t";
+            if(turret->IsLaserEnabled())
+            {
+                response += LaserHandler::Disable(turret->m_id) + "\t";
+            }
         }
-        if(calibrationActive == true)
+        if(calibrationActive.exchange(false))
         {
-            calibrationActive = false;
             DbHandler::InsertDataNow(CALIBRATIONEND, NAMEOF(RESTApi), "System exited the calibration mode.");
         }
         return response;
@@ -124,14 +266,17 @@ namespace DebuggerInfrastructure
 
     bool AimHandler::IsCalibrationEnabled()
     {
-        return calibrationActive;
+        return calibrationActive.load();
     }
 
     std::string AimHandler::SetDefaultState(std::pair<double, double> point)
     {
-        std::string response = fmt::format("Setting default state to X({}) Y({})\t", point.first, point.second);
-        defaultState = point;
-        response += SetAnglePoint(defaultState);
+        std::string response = fmt::format("Setting default state of turret {} to X({}) Y({})\t", m_id, point.first, point.second);
+        m_state.Update([point](TurretState& state) {
+            state.defaultX = point.first;
+            state.defaultY = point.second;
+        });
+        response += SetAnglePoint(point);
         return response;
     }
 
@@ -144,66 +289,102 @@ namespace DebuggerInfrastructure
         }
     }
 
+    void AimHandler::CheckFireZone(std::pair<double, double> point)
+    {
+        bool allowed;
+        {
+            std::lock_guard<std::mutex> guard(m_calibrationMutex);
+            allowed = m_fireZone.IsAllowed(point.first, point.second);
+        }
+        if (!allowed)
+            throw BadRequestException(fmt::format("Point X({}) Y({}) lies in a no-fire zone.", point.first, point.second).c_str());
+    }
+
     bool AimHandler::SetXAngle(double angle)
     {
-        std::lock_guard<std::mutex> guard(mtx);
-        if (locked) return false;
+        std::lock_guard<std::mutex> guard(m_mutex);
+        if (m_state.Load().locked) return false;
 
-        CheckIfInitialized(NAMEOF(AimHandler::SetXAngle));
-        XServoPtr->SetAngle(angle);
-        defaultState.first = angle;
+        m_motion->SetTarget({angle, m_motion->GetTarget().second});
+        m_state.Update([angle](TurretState& state) { state.defaultX = angle; });
         return true;
     }
 
     bool AimHandler::SetYAngle(double angle)
     {
-        std::lock_guard<std::mutex> guard(mtx);
-        if (locked) return false;
+        std::lock_guard<std::mutex> guard(m_mutex);
+        if (m_state.Load().locked) return false;
 
-        CheckIfInitialized(NAMEOF(AimHandler::SetYAngle));
-        YServoPtr->SetAngle(angle);
-        defaultState.second = angle;
+        m_motion->SetTarget({m_motion->GetTarget().first, angle});
+        m_state.Update([angle](TurretState& state) { state.defaultY = angle; });
         return true;
     }
 
     std::string AimHandler::SetAnglePoint(std::pair<double,double> anglePoint)
     {
-        std::lock_guard<std::mutex> guard(mtx);
-        if (locked) throw BadRequestException("Servos locked, cannot move.");
+        std::lock_guard<std::mutex> guard(m_mutex);
+        if (m_state.Load().locked) throw BadRequestException("Servos locked, cannot move.");
 
-        CheckIfInitialized(NAMEOF(AimHandler::SetAnglePoint));
-        XServoPtr->SetAngle(anglePoint.first);
-        YServoPtr->SetAngle(anglePoint.second);
-        return fmt::format("Successfully set angle point X({}) Y({})", anglePoint.first, anglePoint.second);
+        double travelMs = m_motion->EstimateTravelMs(anglePoint);
+        m_motion->SetTarget(anglePoint);
+        return fmt::format("Moving turret {} to angle point X({}) Y({}), arrival in {:.0f} ms", m_id, anglePoint.first, anglePoint.second, travelMs);
     }
 
     void AimHandler::EmergencyDisableAndLock()
     {
         std::lock_guard<std::mutex> guard(mtx);
+        for (auto& turret : turrets)
+        {
+            turret->m_motion->Disarm();
+        }
+        SafetyTrace::Mark(TraceHop::MotionDisarmed);
         LaserHandler::EmergencyDisableAndLock();
+        for (auto& turret : turrets)
+        {
+            PulseEngine::Abort(turret->m_id);
+        }
         CheckIfInitialized(NAMEOF(AimHandler::EmergencyDisableAndLock));
         DisableCalibration();
-        XServoPtr->EmergencyDisableAndLock();
-        YServoPtr->EmergencyDisableAndLock();
-        locked = true;
+        for (auto& turret : turrets)
+        {
+            turret->Lock();
+        }
+        SafetyTrace::Mark(TraceHop::ServosParked);
+    }
+
+    void AimHandler::Lock()
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_xServo->EmergencyDisableAndLock();
+        m_yServo->EmergencyDisableAndLock();
+        // The servos are parked at 0 degrees now, the controller has to start from there after the unlock
+        m_motion->Reset({0.0, 0.0});
+        m_state.Update([](TurretState& state) { state.locked = true; });
     }
 
     void AimHandler::Unlock()
     {
         std::lock_guard<std::mutex> guard(mtx);
         CheckIfInitialized(NAMEOF(AimHandler::Unlock));
-        XServoPtr->Unlock();
-        YServoPtr->Unlock();
-        locked = false;
+        for (auto& turret : turrets)
+        {
+            turret->Release();
+        }
+    }
+
+    void AimHandler::Release()
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_xServo->Unlock();
+        m_yServo->Unlock();
+        m_state.Update([](TurretState& state) { state.locked = false; });
     }
 
     void AimHandler::Dispose()
     {
         std::lock_guard<std::mutex> guard(mtx);
         CheckIfInitialized(NAMEOF(AimHandler::Dispose));
-        delete XServoPtr;
-        delete YServoPtr;
-        XServoPtr = YServoPtr = nullptr;
+        turrets.clear();
         m_initialized = false;
     }
 
@@ -211,7 +392,16 @@ namespace DebuggerInfrastructure
     {
         std::lock_guard<std::mutex> guard(mtx);
         CheckIfInitialized(NAMEOF(AimHandler::RestoreLastState));
-        XServoPtr->SetAngle(defaultState.first);
-        YServoPtr->SetAngle(defaultState.second);
+        for (auto& turret : turrets)
+        {
+            turret->Restore();
+        }
+    }
+
+    void AimHandler::Restore()
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        TurretState state = m_state.Load();
+        m_motion->SetTarget({state.defaultX, state.defaultY});
     }
-}
\ No newline at end of file
+}
@@ -1,12 +1,21 @@
 #pragma once
 #include <utility>
+#include <atomic>
+#include <chrono>
+#include <memory>
 #include <mutex>
+#include <vector>
 #include "../Logger/Logger.h"
 #include "../ExternalConfigsHelper/ExternalConfigsHelper.h"
-class gpiod_line;
+#include "../RegionMask/RegionMask.h"
+#include "../CalibrationModel/CalibrationModel.h"
+#include "../Seqlock/Seqlock.h"
+#include "../ServoFeedback/ServoFeedback.h"
 namespace DebuggerInfrastructure
 {
     class ServoHandler;
+    class MotionController;
+    struct MotionLimits;
 
 
     struct CalibrationSettings
@@ -14,40 +23,108 @@ namespace DebuggerInfrastructure
         std::pair<double, double> calibrationX;
         std::pair<double, double> calibrationY;
         std::pair<double, double> calibrationCenter;
+        // Optional, fitted instead of the three values above when present (see CalibrationModel).
+        std::vector<CalibrationPoint> calibrationPoints;
+    };
+
+    struct TurretSettings
+    {
+        int pwmChip = 0;
+        int xChannel = 0;
+        int yChannel = 1;
+        size_t laserLine = 16;
+        FeedbackSettings feedback;                  ///< Optional "feedback" object, no sensors by default.
+        std::string pwmRoot = "/sys/class/pwm";    ///< Not part of the config, taken from the hardware settings.
+    };
+
+
+    // Published as one snapshot, so readers on the vision and REST threads never take a lock.
+    struct TurretState
+    {
+        bool locked = false;
+        double defaultX = 0.0;
+        double defaultY = 0.0;
+        std::chrono::_V2::system_clock::time_point lastShoot {};
     };
 
 
     class DbHandler;
 
+    /**
+     * @brief One pan/tilt turret: a servo pair, its motion controller, its laser and its calibration.
+     *
+     * Turrets are created from the "turrets" config by Initialize and addressed by index through Get.
+     * The static methods act on the whole system: an emergency locks every turret, calibration mode
+     * turns every laser on.
+     */
     class AimHandler {
     public:
-        static void Initialize(int pwmChip = 0, int xChannel = 0, int yChannel = 1, std::string calibrationPath = "config.json");
-        static bool SetXAngle(double angle);
-        static bool SetYAngle(double angle);
-        static std::string SetAnglePoint(std::pair<double,double> anglePoint);
-        static std::string SetPoint(std::pair<double,double> Point);
-        static std::string SetDefaultState(std::pair<double,double> Point);
-        static std::string Disarm();
-        static std::string ShootAt(std::pair<double, double> point);
+        static void Initialize(std::vector<TurretSettings> turrets, std::string calibrationPath = "config.json");
+        static void Dispose();
+        static size_t Count();
+        static AimHandler& Get(size_t turret);
         static std::string EnableCalibration();
         static std::string DisableCalibration();
+        static bool IsCalibrationEnabled();
         static void EmergencyDisableAndLock();
         static void Unlock();
-        static void Dispose();
         static void RestoreLastState();
-        static bool IsLaserEnabled();
-        static bool IsCalibrationEnabled();
-        static std::chrono::_V2::system_clock::time_point GetLastShoot();
+
+        AimHandler(size_t id, const TurretSettings& settings, CalibrationSettings calibration, const MotionLimits& limits);
+        ~AimHandler();
+        AimHandler(const AimHandler&) = delete;
+        AimHandler& operator=(const AimHandler&) = delete;
+
+        size_t Id() const;
+        const TurretSettings& GetSettings() const;
+        bool SetXAngle(double angle);
+        bool SetYAngle(double angle);
+        std::string SetAnglePoint(std::pair<double,double> anglePoint);
+        std::string SetPoint(std::pair<double,double> Point);
+        std::string SetDefaultState(std::pair<double,double> Point);
+        std::string Disarm();
+        std::string ShootAt(std::pair<double, double> point);
+        bool IsLaserEnabled();
+        // True while the laser is on or waiting for the turret to arrive at a target.
+        bool IsEngaged();
+        std::chrono::_V2::system_clock::time_point GetLastShoot();
+        TurretState GetState() const;
+        // True once the turret settled on the last requested angles.
+        bool IsOnTarget();
+        // Time to slew from where the turret is now to the frame point and settle there.
+        double EstimateTravelMs(std::pair<double, double> point);
+        FeedbackStats GetFeedbackStats() const;
+        CalibrationSettings GetCalibration();
+        // Swaps the calibration used by SetPoint, e.g. after an automatic calibration run.
+        void SetCalibration(CalibrationSettings settings);
+        std::pair<double, double> MapPoint(std::pair<double, double> point);
+        // Where SetPoint and ShootAt may aim, in the frame of the camera the turret is calibrated to.
+        // The top-level regions until NeuralNetworkHandler sets the ones of that camera.
+        void SetFireZone(RegionMask zone);
     private:
         static void CheckIfInitialized(std::string methodName);
+        void CheckFireZone(std::pair<double, double> point);
+        void Lock();
+        void Release();
+        void Restore();
+        void OnArrival();
+
         static std::mutex mtx;
-        static ServoHandler* XServoPtr;
-        static ServoHandler* YServoPtr;
-        static CalibrationSettings calbration;
-        static std::pair<double, double> defaultState;
-        static bool m_initialized;
-        static bool locked;
-        static bool calibrationActive;
-        static std::chrono::_V2::system_clock::time_point  lastShoot;      
+        static std::vector<std::unique_ptr<AimHandler>> turrets;
+        static std::atomic<bool> m_initialized;
+        static std::atomic<bool> calibrationActive;
+
+        size_t m_id;
+        TurretSettings m_settings;
+        std::mutex m_mutex;
+        std::mutex m_calibrationMutex;
+        std::unique_ptr<ServoHandler> m_xServo;
+        std::unique_ptr<ServoHandler> m_yServo;
+        std::unique_ptr<ServoFeedback> m_feedback;
+        std::unique_ptr<MotionController> m_motion;
+        CalibrationSettings m_calibration;
+        CalibrationModel m_calibrationModel;
+        RegionMask m_fireZone;                      ///< Guarded by m_calibrationMutex, same frame as the calibration.
+        Seqlock<TurretState> m_state;
     };
-}
\ No newline at end of file
+}
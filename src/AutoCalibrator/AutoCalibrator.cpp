@@ -0,0 +1,256 @@
+#include "AutoCalibrator.h"
+#include "../AimHandler/AimHandler.h"
+#include "../DeadLocker/DeadLocker.h"
+#include "../ExternalConfigsHelper/ExternalConfigsHelper.h"
+#include "../LaserHandler/LaserHandler.h"
+#include "../Logger/Logger.h"
+#include <algorithm>
+#include <limits>
+
+namespace DebuggerInfrastructure
+{
+    AutoCalibrator::FrameSource             AutoCalibrator::source_;
+    size_t                                  AutoCalibrator::cameras_ = 0;
+    std::mutex                              AutoCalibrator::mtx_;
+    AutoCalibrationStatus                   AutoCalibrator::status_;
+    std::thread                             AutoCalibrator::thread_;
+    std::atomic<bool>                       AutoCalibrator::abort_{false};
+    std::chrono::steady_clock::time_point   AutoCalibrator::started_;
+
+    void AutoCalibrator::Initialize(FrameSource source, size_t cameras)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (status_.state == AutoCalibrationState::Running) {
+            throw std::runtime_error("Cannot change the AutoCalibrator frame source during a run");
+        }
+        source_ = std::move(source);
+        cameras_ = cameras;
+        Logger::Info("AutoCalibrator initialized with {} camera(s).", cameras_);
+    }
+
+    bool AutoCalibrator::Start(AutoCalibrationSettings settings, std::string calibrationPath)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (status_.state == AutoCalibrationState::Running) return false;
+        if (thread_.joinable()) thread_.join();
+
+        status_ = AutoCalibrationStatus{};
+        status_.state = AutoCalibrationState::Running;
+        status_.pointsTotal = settings.gridSize * settings.gridSize;
+        abort_.store(false);
+        started_ = std::chrono::steady_clock::now();
+        thread_ = std::thread(&AutoCalibrator::ThreadFunc, settings, std::move(calibrationPath));
+        return true;
+    }
+
+    AutoCalibrationStatus AutoCalibrator::GetStatus()
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        AutoCalibrationStatus status = status_;
+        if (status.state == AutoCalibrationState::Running) {
+            status.durationMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started_).count();
+        }
+        return status;
+    }
+
+    void AutoCalibrator::Dispose()
+    {
+        abort_.store(true);
+        if (thread_.joinable()) thread_.join();
+        Logger::Info("Disposed of AutoCalibrator.");
+    }
+
+    std::string AutoCalibrator::StateName(AutoCalibrationState state)
+    {
+        switch (state) {
+            case AutoCalibrationState::Running: return "Running";
+            case AutoCalibrationState::Succeeded: return "Succeeded";
+            case AutoCalibrationState::Failed: return "Failed";
+            default: return "Idle";
+        }
+    }
+
+    std::optional<std::pair<double, double>> AutoCalibrator::DetectDot(const cv::Mat& frame, const AutoCalibrationSettings& settings)
+    {
+        if (frame.empty() || frame.type() != CV_8UC3) return std::nullopt;
+
+        const int minRed = settings.minRed;
+        const int minDominance = settings.minRedDominance;
+        double sumX = 0.0;
+        double sumY = 0.0;
+        size_t count = 0;
+        #pragma omp parallel for reduction(+:sumX, sumY, count)
+        for (int y = 0; y < frame.rows; y++) {
+            const uchar* row = frame.ptr<uchar>(y);
+            for (int x = 0; x < frame.cols; x++) {
+                int b = row[3 * x];
+                int g = row[3 * x + 1];
+                int r = row[3 * x + 2];
+                if (r >= minRed && r - std::max(g, b) >= minDominance) {
+                    sumX += x;
+                    sumY += y;
+                    count++;
+                }
+            }
+        }
+        if (count < settings.minPixels) return std::nullopt;
+        return std::make_pair((sumX / double(count) + 0.5) / double(frame.cols),
+                              (sumY / double(count) + 0.5) / double(frame.rows));
+    }
+
+    void AutoCalibrator::ThreadFunc(AutoCalibrationSettings settings, std::string calibrationPath)
+    {
+        try {
+            Run(settings, calibrationPath);
+        } catch (const std::exception& ex) {
+            Finish(AutoCalibrationState::Failed, ex.what());
+        }
+    }
+
+    void AutoCalibrator::Run(const AutoCalibrationSettings& settings, const std::string& calibrationPath)
+    {
+        if (settings.gridSize < 3) {
+            throw std::invalid_argument("Auto calibration needs a grid of at least 3x3");
+        }
+        if (!source_) {
+            throw std::runtime_error("AutoCalibrator not initialized, no frame source");
+        }
+        if (settings.cameraId >= cameras_) {
+            throw std::invalid_argument(fmt::format("Camera {} does not exist", settings.cameraId));
+        }
+        if (DeadLocker::IsLocked()) {
+            throw std::runtime_error("System is locked, cannot calibrate");
+        }
+        AimHandler& turret = AimHandler::Get(settings.turret);
+
+        // Sweep the angles the current calibration spans, plus a margin
+        double minX = std::numeric_limits<double>::max(), maxX = std::numeric_limits<double>::lowest();
+        double minY = minX, maxY = maxX;
+        for (auto corner : {std::make_pair(0.0, 0.0), std::make_pair(1.0, 0.0), std::make_pair(0.0, 1.0), std::make_pair(1.0, 1.0)}) {
+            auto angles = turret.MapPoint(corner);
+            minX = std::min(minX, angles.first);
+            maxX = std::max(maxX, angles.first);
+            minY = std::min(minY, angles.second);
+            maxY = std::max(maxY, angles.second);
+        }
+        minX -= settings.marginDeg;
+        maxX += settings.marginDeg;
+        minY -= settings.marginDeg;
+        maxY += settings.marginDeg;
+        Logger::Info("Auto calibration of turret {} started: {}x{} grid over X({}..{}) Y({}..{}) deg",
+                     settings.turret, settings.gridSize, settings.gridSize, minX, maxX, minY, maxY);
+
+        bool enabledCalibration = !AimHandler::IsCalibrationEnabled();
+        if (enabledCalibration) {
+            Logger::Info(AimHandler::EnableCalibration());
+        }
+        // Only the calibrated turret's dot may be visible
+        for (size_t other = 0; other < AimHandler::Count(); other++) {
+            if (other != settings.turret && AimHandler::Get(other).IsLaserEnabled()) {
+                Logger::Info(LaserHandler::Disable(other));
+            }
+        }
+        auto restore = [enabledCalibration] {
+            try {
+                if (enabledCalibration) Logger::Info(AimHandler::DisableCalibration());
+                if (!DeadLocker::IsLocked()) AimHandler::RestoreLastState();
+            } catch (const std::exception& ex) {
+                Logger::Warning("Could not restore the turret after auto calibration: {}", ex.what());
+            }
+        };
+
+        std::vector<CalibrationPoint> points;
+        try {
+            const size_t n = settings.gridSize;
+            for (size_t row = 0; row < n; row++) {
+                for (size_t i = 0; i < n; i++) {
+                    // Serpentine order keeps every move one grid step long
+                    size_t col = row % 2 == 0 ? i : n - 1 - i;
+                    if (abort_.load() || DeadLocker::IsLocked()) {
+                        throw std::runtime_error("Auto calibration aborted");
+                    }
+                    std::pair<double, double> angles = {minX + (maxX - minX) * double(col) / double(n - 1),
+                                                        minY + (maxY - minY) * double(row) / double(n - 1)};
+                    auto dot = Measure(settings, turret, angles);
+                    if (dot) points.push_back(CalibrationPoint{*dot, angles});
+
+                    std::lock_guard<std::mutex> lock(mtx_);
+                    status_.pointsVisited++;
+                    status_.pointsMeasured = points.size();
+                }
+            }
+        } catch (...) {
+            restore();
+            throw;
+        }
+        restore();
+
+        if (points.size() < 6) {
+            throw std::runtime_error(fmt::format("Laser dot found at only {} of {} grid points", points.size(), settings.gridSize * settings.gridSize));
+        }
+
+        CalibrationSettings calibration = turret.GetCalibration();
+        calibration.calibrationPoints = std::move(points);
+        CalibrationModel model(calibration);
+        ExternalConfigsHelper::setCalibrationSettings(calibration, calibrationPath, settings.turret);
+        turret.SetCalibration(calibration);
+
+        const CalibrationReport& report = model.Report();
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            status_.report = report;
+        }
+        Finish(AutoCalibrationState::Succeeded,
+               fmt::format("{} fit from {} points, RMS error {:.3f} deg, max error {:.3f} deg",
+                           CalibrationModel::FitName(report.fit), report.points, report.rmsError, report.maxError));
+    }
+
+    std::optional<std::pair<double, double>> AutoCalibrator::Measure(const AutoCalibrationSettings& settings, AimHandler& turret,
+                                                                     std::pair<double, double> angles)
+    {
+        const auto poll = std::chrono::milliseconds(5);
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double, std::milli>(settings.timeoutMs));
+
+        turret.SetAnglePoint(angles);
+        while (!turret.IsOnTarget()) {
+            if (abort_.load() || std::chrono::steady_clock::now() > deadline) {
+                Logger::Warning("Turret did not reach X({}) Y({}) in time", angles.first, angles.second);
+                return std::nullopt;
+            }
+            std::this_thread::sleep_for(poll);
+        }
+        std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(settings.settleMs));
+
+        // Only a frame captured after the turret settled shows the dot where it is now
+        uint64_t settledSequence = 0;
+        source_(settings.cameraId, settledSequence);
+        while (true) {
+            uint64_t sequence = 0;
+            cv::Mat frame = source_(settings.cameraId, sequence);
+            if (sequence > settledSequence) {
+                auto dot = DetectDot(frame, settings);
+                if (!dot) Logger::Verbose("No laser dot at X({}) Y({})", angles.first, angles.second);
+                return dot;
+            }
+            if (abort_.load() || std::chrono::steady_clock::now() > deadline) {
+                Logger::Warning("No fresh frame from camera {} in time", settings.cameraId);
+                return std::nullopt;
+            }
+            std::this_thread::sleep_for(poll);
+        }
+    }
+
+    void AutoCalibrator::Finish(AutoCalibrationState state, std::string message)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        status_.state = state;
+        status_.durationMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started_).count();
+        status_.message = std::move(message);
+        if (state == AutoCalibrationState::Succeeded) {
+            Logger::Info("Auto calibration finished in {:.0f} ms: {}", status_.durationMs, status_.message);
+        } else {
+            Logger::Error("Auto calibration failed after {:.0f} ms: {}", status_.durationMs, status_.message);
+        }
+    }
+}
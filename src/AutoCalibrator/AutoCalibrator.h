@@ -0,0 +1,91 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include "../CalibrationModel/CalibrationModel.h"
+
+namespace DebuggerInfrastructure
+{
+    class AimHandler;
+
+    struct AutoCalibrationSettings
+    {
+        size_t cameraId = 0;
+        size_t turret = 0;              ///< Must be calibrated to cameraId's view.
+        size_t gridSize = 5;            ///< Samples per axis over the angle range of the current calibration.
+        double marginDeg = 2.0;         ///< Added around that range, so the fit does not have to extrapolate.
+        double settleMs = 120.0;        ///< Extra wait after the turret reported it is on target.
+        double timeoutMs = 2000.0;      ///< Per grid point, for both travel and a fresh frame.
+        int minRed = 200;               ///< Laser dot pixels: red channel at least this...
+        int minRedDominance = 60;       ///< ...and this much above both green and blue.
+        size_t minPixels = 3;
+    };
+
+    enum class AutoCalibrationState
+    {
+        Idle,
+        Running,
+        Succeeded,
+        Failed
+    };
+
+    struct AutoCalibrationStatus
+    {
+        AutoCalibrationState state = AutoCalibrationState::Idle;
+        size_t pointsTotal = 0;
+        size_t pointsVisited = 0;
+        size_t pointsMeasured = 0;      ///< Grid points where the dot was found.
+        double durationMs = 0.0;
+        CalibrationReport report;
+        std::string message;
+    };
+
+    /**
+     * @brief Calibrates the turret from the camera: sweeps a grid of servo angles with the laser on,
+     * finds the dot in each raw frame and fits a CalibrationModel from the pairs.
+     *
+     * The result is written through ExternalConfigsHelper and applied to AimHandler right away.
+     * Runs on its own thread and aborts as soon as the system gets locked.
+     */
+    class AutoCalibrator
+    {
+    public:
+        // Last raw frame of a camera and its capture sequence number, see NeuralNetworkHandler::GetLatestRawFrame.
+        using FrameSource = std::function<cv::Mat(size_t cameraId, uint64_t& sequence)>;
+
+        // cameras - number of cameras the source serves, ids 0 to cameras - 1
+        static void Initialize(FrameSource source, size_t cameras);
+        // Returns false if a run is already in progress.
+        static bool Start(AutoCalibrationSettings settings = {}, std::string calibrationPath = "config.json");
+        static AutoCalibrationStatus GetStatus();
+        static void Dispose();
+
+        /**
+         * @brief Centroid of the laser dot in normalized frame coordinates, if there is one.
+         */
+        static std::optional<std::pair<double, double>> DetectDot(const cv::Mat& frame, const AutoCalibrationSettings& settings);
+
+        static std::string StateName(AutoCalibrationState state);
+
+    private:
+        static void ThreadFunc(AutoCalibrationSettings settings, std::string calibrationPath);
+        static void Run(const AutoCalibrationSettings& settings, const std::string& calibrationPath);
+        static std::optional<std::pair<double, double>> Measure(const AutoCalibrationSettings& settings, AimHandler& turret,
+                                                                std::pair<double, double> angles);
+        static void Finish(AutoCalibrationState state, std::string message);
+
+        static FrameSource source_;
+        static size_t cameras_;
+        static std::mutex mtx_;
+        static AutoCalibrationStatus status_;
+        static std::thread thread_;
+        static std::atomic<bool> abort_;
+        static std::chrono::steady_clock::time_point started_;
+    };
+}
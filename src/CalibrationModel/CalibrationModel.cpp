@@ -0,0 +1,185 @@
+#include "CalibrationModel.h"
+#include "../AimHandler/AimHandler.h"
+#include "../Logger/Logger.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace DebuggerInfrastructure
+{
+    namespace
+    {
+        constexpr size_t affineTerms = 3;
+        constexpr size_t polynomialTerms = 6;
+    }
+
+    CalibrationModel::CalibrationModel()
+        : resolution_(2)
+        , table_(4, {0.f, 0.f})
+    {
+    }
+
+    CalibrationModel::CalibrationModel(const CalibrationSettings& settings, size_t resolution)
+        : resolution_(resolution)
+    {
+        if (resolution_ < 2) {
+            throw std::invalid_argument("Calibration table needs at least 2 samples per axis");
+        }
+
+        const auto& points = settings.calibrationPoints;
+        Coefficients cx, cy;
+        report_.fit = CalibrationFit::Legacy;
+        if (points.size() >= polynomialTerms && Fit(points, polynomialTerms, cx, cy)) {
+            report_.fit = CalibrationFit::Polynomial;
+        } else if (points.size() >= affineTerms && Fit(points, affineTerms, cx, cy)) {
+            report_.fit = CalibrationFit::Affine;
+        }
+        if (!points.empty() && report_.fit == CalibrationFit::Legacy) {
+            Logger::Warning("{} calibration points are degenerate, using the three-point calibration", points.size());
+        }
+
+        table_.resize(resolution_ * resolution_);
+        double terms[polynomialTerms];
+        for (size_t row = 0; row < resolution_; row++) {
+            double y = double(row) / double(resolution_ - 1);
+            for (size_t col = 0; col < resolution_; col++) {
+                double x = double(col) / double(resolution_ - 1);
+                std::pair<double, double> angles;
+                if (report_.fit == CalibrationFit::Legacy) {
+                    angles = Legacy(settings, {x, y});
+                } else {
+                    Terms(x, y, cx.size(), terms);
+                    angles = {0.0, 0.0};
+                    for (size_t i = 0; i < cx.size(); i++) {
+                        angles.first += cx[i] * terms[i];
+                        angles.second += cy[i] * terms[i];
+                    }
+                }
+                table_[row * resolution_ + col] = {float(angles.first), float(angles.second)};
+            }
+        }
+
+        // Measured against the table, so interpolation error is part of the report
+        report_.points = points.size();
+        double sumSquares = 0.0;
+        for (const auto& point : points) {
+            auto mapped = Map(point.point);
+            double error = std::hypot(mapped.first - point.angles.first, mapped.second - point.angles.second);
+            sumSquares += error * error;
+            report_.maxError = std::max(report_.maxError, error);
+        }
+        report_.rmsError = points.empty() ? 0.0 : std::sqrt(sumSquares / double(points.size()));
+    }
+
+    std::pair<double, double> CalibrationModel::Map(std::pair<double, double> point) const
+    {
+        const double scale = double(resolution_ - 1);
+        double fx = std::clamp(point.first, 0.0, 1.0) * scale;
+        double fy = std::clamp(point.second, 0.0, 1.0) * scale;
+        size_t col = std::min(size_t(fx), resolution_ - 2);
+        size_t row = std::min(size_t(fy), resolution_ - 2);
+        double tx = fx - double(col);
+        double ty = fy - double(row);
+
+        const auto& a = table_[row * resolution_ + col];
+        const auto& b = table_[row * resolution_ + col + 1];
+        const auto& c = table_[(row + 1) * resolution_ + col];
+        const auto& d = table_[(row + 1) * resolution_ + col + 1];
+        double top = a.first + (b.first - a.first) * tx;
+        double bottom = c.first + (d.first - c.first) * tx;
+        double angleX = top + (bottom - top) * ty;
+        top = a.second + (b.second - a.second) * tx;
+        bottom = c.second + (d.second - c.second) * tx;
+        double angleY = top + (bottom - top) * ty;
+        return {angleX, angleY};
+    }
+
+    const CalibrationReport& CalibrationModel::Report() const
+    {
+        return report_;
+    }
+
+    std::string CalibrationModel::FitName(CalibrationFit fit)
+    {
+        switch (fit) {
+            case CalibrationFit::Affine: return "affine";
+            case CalibrationFit::Polynomial: return "polynomial";
+            default: return "legacy";
+        }
+    }
+
+    bool CalibrationModel::Fit(const std::vector<CalibrationPoint>& points, size_t terms, Coefficients& x, Coefficients& y)
+    {
+        // Normal equations, small enough that conditioning is not an issue on the unit square
+        std::vector<std::vector<double>> normal(terms, std::vector<double>(terms, 0.0));
+        std::vector<double> rhsX(terms, 0.0), rhsY(terms, 0.0);
+        double row[polynomialTerms];
+        for (const auto& point : points) {
+            Terms(point.point.first, point.point.second, terms, row);
+            for (size_t i = 0; i < terms; i++) {
+                for (size_t j = 0; j < terms; j++) {
+                    normal[i][j] += row[i] * row[j];
+                }
+                rhsX[i] += row[i] * point.angles.first;
+                rhsY[i] += row[i] * point.angles.second;
+            }
+        }
+        return Solve(normal, rhsX, x) && Solve(normal, rhsY, y);
+    }
+
+    bool CalibrationModel::Solve(std::vector<std::vector<double>> matrix, std::vector<double> vector, Coefficients& result)
+    {
+        const size_t n = vector.size();
+        for (size_t col = 0; col < n; col++) {
+            size_t pivot = col;
+            for (size_t r = col + 1; r < n; r++) {
+                if (std::abs(matrix[r][col]) > std::abs(matrix[pivot][col])) pivot = r;
+            }
+            if (std::abs(matrix[pivot][col]) < 1e-12) return false;
+            std::swap(matrix[col], matrix[pivot]);
+            std::swap(vector[col], vector[pivot]);
+            for (size_t r = col + 1; r < n; r++) {
+                double factor = matrix[r][col] / matrix[col][col];
+                for (size_t c = col; c < n; c++) matrix[r][c] -= factor * matrix[col][c];
+                vector[r] -= factor * vector[col];
+            }
+        }
+        result.assign(n, 0.0);
+        for (size_t i = n; i-- > 0;) {
+            double sum = vector[i];
+            for (size_t c = i + 1; c < n; c++) sum -= matrix[i][c] * result[c];
+            result[i] = sum / matrix[i][i];
+        }
+        return true;
+    }
+
+    void CalibrationModel::Terms(double x, double y, size_t count, double* terms)
+    {
+        const double all[polynomialTerms] = {1.0, x, y, x * x, x * y, y * y};
+        std::copy(all, all + count, terms);
+    }
+
+    std::pair<double, double> CalibrationModel::Legacy(const CalibrationSettings& settings, std::pair<double, double> point)
+    {
+        point.second = 1.0 - point.second;
+
+        double angleX;
+        if (point.first < 0.5) {
+            angleX = settings.calibrationX.first +
+                    (settings.calibrationCenter.first - settings.calibrationX.first) * (point.first / 0.5);
+        } else {
+            angleX = settings.calibrationCenter.first +
+                    (settings.calibrationX.second - settings.calibrationCenter.first) * ((point.first - 0.5) / 0.5);
+        }
+
+        double angleY;
+        if (point.second < 0.5) {
+            angleY = settings.calibrationY.first +
+                    (settings.calibrationCenter.second - settings.calibrationY.first) * (point.second / 0.5);
+        } else {
+            angleY = settings.calibrationCenter.second +
+                    (settings.calibrationY.second - settings.calibrationCenter.second) * ((point.second - 0.5) / 0.5);
+        }
+        return {angleX, angleY};
+    }
+}
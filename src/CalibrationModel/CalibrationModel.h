@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace DebuggerInfrastructure
+{
+    struct CalibrationSettings;
+
+    // A measured pair: normalized frame point (same space as AimHandler::SetPoint) and the servo angles hitting it.
+    struct CalibrationPoint
+    {
+        std::pair<double, double> point;
+        std::pair<double, double> angles;
+    };
+
+    enum class CalibrationFit
+    {
+        Legacy,         ///< Two-segment linear interpolation from calibrationX/Y/Center.
+        Affine,         ///< Least squares over 1, x, y.
+        Polynomial      ///< Least squares over 1, x, y, x^2, xy, y^2.
+    };
+
+    struct CalibrationReport
+    {
+        CalibrationFit fit = CalibrationFit::Legacy;
+        size_t points = 0;
+        double rmsError = 0.0;      ///< deg, lookup table against the calibration points
+        double maxError = 0.0;      ///< deg
+    };
+
+    /**
+     * @brief Maps normalized frame points to servo angles through a table compiled once at load time.
+     *
+     * With enough calibration points a second order polynomial is fitted per axis (an affine fit with fewer,
+     * the legacy three-point interpolation without any), which absorbs lens distortion and servo non-linearity.
+     * The fitted model is sampled into a dense grid, so Map is a single bilinear fetch.
+     */
+    class CalibrationModel
+    {
+    public:
+        CalibrationModel();
+        explicit CalibrationModel(const CalibrationSettings& settings, size_t resolution = 65);
+
+        std::pair<double, double> Map(std::pair<double, double> point) const;
+        const CalibrationReport& Report() const;
+
+        static std::string FitName(CalibrationFit fit);
+
+    private:
+        using Coefficients = std::vector<double>;
+
+        static bool Fit(const std::vector<CalibrationPoint>& points, size_t terms, Coefficients& x, Coefficients& y);
+        static bool Solve(std::vector<std::vector<double>> matrix, std::vector<double> vector, Coefficients& result);
+        static void Terms(double x, double y, size_t count, double* terms);
+        static std::pair<double, double> Legacy(const CalibrationSettings& settings, std::pair<double, double> point);
+
+        size_t resolution_;
+        std::vector<std::pair<float, float>> table_;
+        CalibrationReport report_;
+    };
+}
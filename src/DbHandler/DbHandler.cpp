@@ -26,15 +26,16 @@ namespace DebuggerInfrastructure
     //----------------------------------------------
     // RecordData definitions
     //----------------------------------------------
-    RecordData::RecordData(sqlite_int64 time, int event, const unsigned char* className, const unsigned char* description)
+    RecordData::RecordData(sqlite_int64 time, int event, const unsigned char* className, const unsigned char* description, const unsigned char* clip)
         : time(time), event(event)
     {
         this->className = safeConvertToString(className);
         this->description   = safeConvertToString(description);
+        this->clip          = clip ? safeConvertToString(clip) : "";
     }
 
-    RecordData::RecordData(int64_t time, int event, const std::string& className, const std::string& description)
-        : time(time), event(event), className(className), description(description)
+    RecordData::RecordData(int64_t time, int event, const std::string& className, const std::string& description, const std::string& clip)
+        : time(time), event(event), className(className), description(description), clip(clip)
     {
     }
 
@@ -43,6 +44,7 @@ namespace DebuggerInfrastructure
 
     // Buffer for records
     std::vector<RecordData> DbHandler::buffer_;
+    std::vector<SafetyTraceData> DbHandler::traceBuffer_;
 
     // Interval after which we also force a flush
     std::chrono::steady_clock::time_point DbHandler::lastFlushTime;
@@ -67,6 +69,8 @@ namespace DebuggerInfrastructure
         lastFlushTime = std::chrono::steady_clock::now();
         OpenDb();
         CreateTableIfNeeded();
+        MigrateTableIfNeeded();
+        CreateTraceTableIfNeeded();
         initialized = true;
     }
 
@@ -98,38 +102,46 @@ namespace DebuggerInfrastructure
     //----------------------------------------------
     // InsertData (buffered)
     //----------------------------------------------
-    void DbHandler::InsertData(int64_t time, int event, const std::string& className, const std::string& description)
+    void DbHandler::InsertData(int64_t time, int event, const std::string& className, const std::string& description, const std::string& clip)
     {
         CheckInitialized();
         // Lock to protect shared resources
         std::lock_guard<std::mutex> lock(mutex_);
 
         // Add the record to the in-memory buffer
-        buffer_.push_back(RecordData(time, event, className, description));
+        buffer_.push_back(RecordData(time, event, className, description, clip));
 
         // Check if we need to flush now
         MaybeFlush();
     }
 
-    void DbHandler::InsertData(int64_t time, Event event, const std::string& className, const std::string& description)
+    void DbHandler::InsertData(int64_t time, Event event, const std::string& className, const std::string& description, const std::string& clip)
     {
-        DbHandler::InsertData(time, (int)(event), className, description);
+        DbHandler::InsertData(time, (int)(event), className, description, clip);
     }
 
-    void DbHandler::InsertDataNow(int event, const std::string& className, const std::string& description)
+    void DbHandler::InsertDataNow(int event, const std::string& className, const std::string& description, const std::string& clip)
     {
-        DbHandler::InsertData(std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()), event, className, description);
+        DbHandler::InsertData(std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()), event, className, description, clip);
     }
 
-    void DbHandler::InsertDataNow(Event event, const std::string& className, const std::string& description)
+    void DbHandler::InsertDataNow(Event event, const std::string& className, const std::string& description, const std::string& clip)
     {
-        DbHandler::InsertDataNow((int)(event), className, description);
+        DbHandler::InsertDataNow((int)(event), className, description, clip);
     }
 
     void DbHandler::InsertData(RecordData record)
     {
         // Just reuse the other InsertData
-        InsertData(record.time, record.event, record.className, record.description);
+        InsertData(record.time, record.event, record.className, record.description, record.clip);
+    }
+
+    void DbHandler::InsertSafetyTrace(const SafetyTraceData& trace)
+    {
+        CheckInitialized();
+        std::lock_guard<std::mutex> lock(mutex_);
+        traceBuffer_.push_back(trace);
+        MaybeFlush();
     }
 
     //----------------------------------------------
@@ -139,7 +151,7 @@ namespace DebuggerInfrastructure
     {
         CheckInitialized();
         std::vector<RecordData> output;
-        const char* sql = "SELECT * FROM Events ORDER BY TIME DESC;";
+        const char* sql = "SELECT TIME, EVENT, CLASS, DESCRIPTION, CLIP FROM Events ORDER BY TIME DESC;";
         sqlite3_stmt* stmt;
 
         FlushBuffer();
@@ -154,7 +166,8 @@ namespace DebuggerInfrastructure
                 sqlite3_column_int64(stmt, 0),
                 sqlite3_column_int(stmt, 1),
                 sqlite3_column_text(stmt, 2),
-                sqlite3_column_text(stmt, 3)
+                sqlite3_column_text(stmt, 3),
+                sqlite3_column_text(stmt, 4)
             ));
         }
 
@@ -165,7 +178,7 @@ namespace DebuggerInfrastructure
     std::vector<RecordData> DbHandler::ReadDataByRange(int64_t start, int64_t end)
     {
         CheckInitialized();
-        const char* sql = "SELECT * FROM Events WHERE TIME BETWEEN ? AND ? ORDER BY TIME DESC;";
+        const char* sql = "SELECT TIME, EVENT, CLASS, DESCRIPTION, CLIP FROM Events WHERE TIME BETWEEN ? AND ? ORDER BY TIME DESC;";
         sqlite3_stmt* stmt;
         std::vector<RecordData> output;
 
@@ -182,7 +195,8 @@ namespace DebuggerInfrastructure
                 sqlite3_column_int64(stmt, 0),
                 sqlite3_column_int(stmt, 1),
                 sqlite3_column_text(stmt, 2),
-                sqlite3_column_text(stmt, 3)
+                sqlite3_column_text(stmt, 3),
+                sqlite3_column_text(stmt, 4)
             ));
         }
 
@@ -193,7 +207,7 @@ namespace DebuggerInfrastructure
     std::vector<RecordData> DbHandler::ReadDataAfter(int64_t time)
     {
         CheckInitialized();
-        const char* sql = "SELECT * FROM Events WHERE TIME > ? ORDER BY TIME DESC;";
+        const char* sql = "SELECT TIME, EVENT, CLASS, DESCRIPTION, CLIP FROM Events WHERE TIME > ? ORDER BY TIME DESC;";
         sqlite3_stmt* stmt;
         std::vector<RecordData> output;
 
@@ -209,7 +223,8 @@ namespace DebuggerInfrastructure
                 sqlite3_column_int64(stmt, 0),
                 sqlite3_column_int(stmt, 1),
                 sqlite3_column_text(stmt, 2),
-                sqlite3_column_text(stmt, 3)
+                sqlite3_column_text(stmt, 3),
+                sqlite3_column_text(stmt, 4)
             ));
         }
 
@@ -221,7 +236,7 @@ namespace DebuggerInfrastructure
     {
         CheckInitialized();
         std::vector<RecordData> output;
-        const char* sql = "SELECT * FROM Events WHERE TIME < ? ORDER BY TIME DESC;";
+        const char* sql = "SELECT TIME, EVENT, CLASS, DESCRIPTION, CLIP FROM Events WHERE TIME < ? ORDER BY TIME DESC;";
         sqlite3_stmt* stmt;
 
         if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
@@ -236,7 +251,8 @@ namespace DebuggerInfrastructure
                 sqlite3_column_int64(stmt, 0),
                 sqlite3_column_int(stmt, 1),
                 sqlite3_column_text(stmt, 2),
-                sqlite3_column_text(stmt, 3)
+                sqlite3_column_text(stmt, 3),
+                sqlite3_column_text(stmt, 4)
             ));
         }
 
@@ -244,6 +260,40 @@ namespace DebuggerInfrastructure
         return output;
     }
 
+    std::vector<SafetyTraceData> DbHandler::ReadSafetyTraces(size_t limit)
+    {
+        CheckInitialized();
+        std::lock_guard<std::mutex> lock(mutex_);
+        const char* sql = "SELECT TIME, REASON, DETECTEDUS, INITIATEDUS, DISARMEDUS, LASERCUTUS, PARKEDUS, BUDGETUS "
+                          "FROM SafetyTraces ORDER BY TIME DESC LIMIT ?;";
+        sqlite3_stmt* stmt;
+        std::vector<SafetyTraceData> output;
+
+        FlushBuffer();
+
+        if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+            Logger::Error("Failed to prepare statement: {}", sqlite3_errmsg(db));
+            throw std::runtime_error("Failed to prepare statement: " + std::string(sqlite3_errmsg(db)));
+        }
+
+        sqlite3_bind_int64(stmt, 1, int64_t(limit));
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            output.push_back(SafetyTraceData{
+                sqlite3_column_int64(stmt, 0),
+                safeConvertToString(sqlite3_column_text(stmt, 1)),
+                sqlite3_column_int64(stmt, 2),
+                sqlite3_column_int64(stmt, 3),
+                sqlite3_column_int64(stmt, 4),
+                sqlite3_column_int64(stmt, 5),
+                sqlite3_column_int64(stmt, 6),
+                sqlite3_column_int64(stmt, 7)
+            });
+        }
+
+        sqlite3_finalize(stmt);
+        return output;
+    }
+
     //----------------------------------------------
     // Create table if needed
     //----------------------------------------------
@@ -254,7 +304,8 @@ namespace DebuggerInfrastructure
                 TIME        INTEGER NOT NULL,
                 EVENT       INTEGER NOT NULL,
                 CLASS       TEXT    NOT NULL,
-                DESCRIPTION TEXT    NOT NULL
+                DESCRIPTION TEXT    NOT NULL,
+                CLIP        TEXT    NOT NULL DEFAULT ''
             );
         )";
 
@@ -271,6 +322,53 @@ namespace DebuggerInfrastructure
         }
     }
 
+    void DbHandler::CreateTraceTableIfNeeded()
+    {
+        const char* sql = R"(
+            CREATE TABLE IF NOT EXISTS SafetyTraces (
+                TIME        INTEGER NOT NULL,
+                REASON      TEXT    NOT NULL,
+                DETECTEDUS  INTEGER NOT NULL,
+                INITIATEDUS INTEGER NOT NULL,
+                DISARMEDUS  INTEGER NOT NULL,
+                LASERCUTUS  INTEGER NOT NULL,
+                PARKEDUS    INTEGER NOT NULL,
+                BUDGETUS    INTEGER NOT NULL
+            );
+        )";
+
+        char* errorMessage = nullptr;
+        if (sqlite3_exec(db, sql, nullptr, nullptr, &errorMessage) != SQLITE_OK) {
+            std::string errStr = errorMessage ? errorMessage : "Unknown error";
+            Logger::Error("Error creating trace table: {}", errStr);
+            sqlite3_free(errorMessage);
+            throw std::runtime_error(fmt::format("Error creating trace table: {}", errStr));
+        }
+    }
+
+    void DbHandler::MigrateTableIfNeeded()
+    {
+        const char* sql = "SELECT 1 FROM pragma_table_info('Events') WHERE name = 'CLIP';";
+        sqlite3_stmt* stmt;
+
+        if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+            Logger::Error("Failed to prepare statement: {}", sqlite3_errmsg(db));
+            throw std::runtime_error("Failed to prepare statement: " + std::string(sqlite3_errmsg(db)));
+        }
+        bool hasClip = sqlite3_step(stmt) == SQLITE_ROW;
+        sqlite3_finalize(stmt);
+        if (hasClip) return;
+
+        char* errorMessage = nullptr;
+        if (sqlite3_exec(db, "ALTER TABLE Events ADD COLUMN CLIP TEXT NOT NULL DEFAULT '';", nullptr, nullptr, &errorMessage) != SQLITE_OK) {
+            std::string errStr = errorMessage ? errorMessage : "Unknown error";
+            Logger::Error("Error migrating table: {}", errStr);
+            sqlite3_free(errorMessage);
+            throw std::runtime_error(fmt::format("Error migrating table: {}", errStr));
+        }
+        Logger::Info("Events table migrated: CLIP column added.");
+    }
+
     //----------------------------------------------
     // Open DB
     //----------------------------------------------
@@ -292,7 +390,7 @@ namespace DebuggerInfrastructure
         CheckInitialized();
         // We check size limit or time limit
         auto now = std::chrono::steady_clock::now();
-        if (buffer_.size() >= maxBufferSize_ ||
+        if (buffer_.size() + traceBuffer_.size() >= maxBufferSize_ ||
             (now - lastFlushTime) >= flushInterval_)
         {
             FlushBuffer();
@@ -303,11 +401,11 @@ namespace DebuggerInfrastructure
     void DbHandler::FlushBuffer()
     {
         CheckInitialized();
-        if (buffer_.empty()) {
+        if (buffer_.empty() && traceBuffer_.empty()) {
             return; // Nothing to flush
         }
 
-        Logger::Verbose("Flushing {} records to the database...", buffer_.size());
+        Logger::Verbose("Flushing {} records and {} safety traces to the database...", buffer_.size(), traceBuffer_.size());
 
         // Begin transaction
         char* errMsg = nullptr;
@@ -319,7 +417,7 @@ namespace DebuggerInfrastructure
         }
 
         // Prepare statement for multiple inserts
-        const char* sql = "INSERT INTO Events (TIME, EVENT, CLASS, DESCRIPTION) VALUES (?, ?, ?, ?);";
+        const char* sql = "INSERT INTO Events (TIME, EVENT, CLASS, DESCRIPTION, CLIP) VALUES (?, ?, ?, ?, ?);";
         sqlite3_stmt* stmt = nullptr;
 
         if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
@@ -334,6 +432,7 @@ namespace DebuggerInfrastructure
             sqlite3_bind_int   (stmt, 2, record.event);
             sqlite3_bind_text  (stmt, 3, record.className.c_str(), -1, SQLITE_STATIC);
             sqlite3_bind_text  (stmt, 4, record.description.c_str(),   -1, SQLITE_STATIC);
+            sqlite3_bind_text  (stmt, 5, record.clip.c_str(),          -1, SQLITE_STATIC);
 
             if (sqlite3_step(stmt) != SQLITE_DONE) {
                 Logger::Error("Error inserting data: {}", sqlite3_errmsg(db));
@@ -346,6 +445,33 @@ namespace DebuggerInfrastructure
 
         sqlite3_finalize(stmt);
 
+        const char* traceSql = "INSERT INTO SafetyTraces (TIME, REASON, DETECTEDUS, INITIATEDUS, DISARMEDUS, LASERCUTUS, PARKEDUS, BUDGETUS) "
+                               "VALUES (?, ?, ?, ?, ?, ?, ?, ?);";
+        if (sqlite3_prepare_v2(db, traceSql, -1, &stmt, nullptr) != SQLITE_OK) {
+            Logger::Error("Failed to prepare statement: {}", sqlite3_errmsg(db));
+            throw std::runtime_error("Failed to prepare statement: " + std::string(sqlite3_errmsg(db)));
+        }
+
+        for (const auto& trace : traceBuffer_)
+        {
+            sqlite3_bind_int64(stmt, 1, trace.time);
+            sqlite3_bind_text (stmt, 2, trace.reason.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_int64(stmt, 3, trace.detectedUs);
+            sqlite3_bind_int64(stmt, 4, trace.initiatedUs);
+            sqlite3_bind_int64(stmt, 5, trace.motionDisarmedUs);
+            sqlite3_bind_int64(stmt, 6, trace.laserCutUs);
+            sqlite3_bind_int64(stmt, 7, trace.servosParkedUs);
+            sqlite3_bind_int64(stmt, 8, trace.budgetUs);
+
+            if (sqlite3_step(stmt) != SQLITE_DONE) {
+                Logger::Error("Error inserting safety trace: {}", sqlite3_errmsg(db));
+                throw std::runtime_error("Error inserting safety trace: " + std::string(sqlite3_errmsg(db)));
+            }
+            sqlite3_reset(stmt);
+        }
+
+        sqlite3_finalize(stmt);
+
         // Commit transaction
         if (sqlite3_exec(db, "COMMIT TRANSACTION;", nullptr, nullptr, &errMsg) != SQLITE_OK) {
             std::string errorStr = errMsg ? errMsg : "Unknown error";
@@ -356,6 +482,7 @@ namespace DebuggerInfrastructure
 
         // Clear buffer
         buffer_.clear();
+        traceBuffer_.clear();
         Logger::Verbose("Flush complete.");
     }
 }
\ No newline at end of file
@@ -28,9 +28,26 @@ namespace DebuggerInfrastructure
         int event;
         std::string className;
         std::string description;
+        std::string clip;       ///< Path of the incident clip recorded for this event, empty if none.
 
-        RecordData(sqlite_int64 time, int event, const unsigned char* className, const unsigned char* description);
-        RecordData(int64_t time, int event, const std::string& className, const std::string& description);
+        RecordData(sqlite_int64 time, int event, const unsigned char* className, const unsigned char* description, const unsigned char* clip);
+        RecordData(int64_t time, int event, const std::string& className, const std::string& description, const std::string& clip = "");
+    };
+
+    /**
+     * @brief One emergency traced from its trigger to the laser being off, see SafetyTrace.
+     *        Hop times are microseconds since the trigger, -1 for a hop that was not reached.
+     */
+    struct SafetyTraceData
+    {
+        int64_t time;
+        std::string reason;
+        int64_t detectedUs;
+        int64_t initiatedUs;
+        int64_t motionDisarmedUs;
+        int64_t laserCutUs;
+        int64_t servosParkedUs;
+        int64_t budgetUs;
     };
 
     enum Event
@@ -77,11 +94,12 @@ namespace DebuggerInfrastructure
          * @param event Event ID
          * @param className Class name
          * @param description Outcome
+         * @param clip Path of the incident clip linked to the event (optional)
          */
-        static void InsertData(int64_t time, int event, const std::string& className, const std::string& description);
-        static void InsertData(int64_t time, Event event, const std::string& className, const std::string& description);
-        static void InsertDataNow(int event, const std::string& className, const std::string& description);
-        static void InsertDataNow(Event event, const std::string& className, const std::string& description);
+        static void InsertData(int64_t time, int event, const std::string& className, const std::string& description, const std::string& clip = "");
+        static void InsertData(int64_t time, Event event, const std::string& className, const std::string& description, const std::string& clip = "");
+        static void InsertDataNow(int event, const std::string& className, const std::string& description, const std::string& clip = "");
+        static void InsertDataNow(Event event, const std::string& className, const std::string& description, const std::string& clip = "");
 
         /**
          * @brief Adds a record to internal buffer; flushes to DB if conditions met.
@@ -117,6 +135,17 @@ namespace DebuggerInfrastructure
          */
         static std::vector<RecordData> ReadDataBefore(int64_t time);
 
+        /**
+         * @brief Adds a safety trace to the buffer, written with the events.
+         */
+        static void InsertSafetyTrace(const SafetyTraceData& trace);
+
+        /**
+         * @brief Reads the latest safety traces, newest first.
+         * @param limit Maximum number of traces
+         */
+        static std::vector<SafetyTraceData> ReadSafetyTraces(size_t limit);
+
     private:
         /**
          * @brief Opens the database connection and initializes 'db'.
@@ -130,6 +159,18 @@ namespace DebuggerInfrastructure
          */
         static void CreateTableIfNeeded();
 
+        /**
+         * @brief Adds the CLIP column to tables created before incident clips existed.
+         * @throws std::runtime_error if the migration fails
+         */
+        static void MigrateTableIfNeeded();
+
+        /**
+         * @brief Creates the SafetyTraces table (if it doesn't exist).
+         * @throws std::runtime_error if creation fails
+         */
+        static void CreateTraceTableIfNeeded();
+
         /**
          * @brief Flushes the buffer to the database if conditions are met (size/time).
          */
@@ -149,6 +190,7 @@ namespace DebuggerInfrastructure
 
         // Buffer for records
         static std::vector<RecordData> buffer_;
+        static std::vector<SafetyTraceData> traceBuffer_;
 
         // Maximum number of records to accumulate before forcing a flush
         static constexpr size_t maxBufferSize_ = 0xff;
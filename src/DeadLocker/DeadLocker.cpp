@@ -3,35 +3,68 @@
 #include "../AimHandler/AimHandler.h"
 #include "../LaserHandler/LaserHandler.h"
 #include "../DbHandler/DbHandler.h"
+#include "../SafetyTrace/SafetyTrace.h"
+#include "../RecordQueue/RecordQueue.h"
+#include <algorithm>
+#include <time.h>
 namespace DebuggerInfrastructure
 {
-    gpiod_line*                                         DeadLocker::ButtonLine   = nullptr;
-    std::thread                                         DeadLocker::thrd;
-    std::atomic<bool>                                   DeadLocker::cycle{false};
+    unsigned int                                        DeadLocker::ButtonLine   = 0;
     std::atomic<bool>                                   DeadLocker::locked{false};
     double                                              DeadLocker::UnlockDelayMs = 5000;
-    std::set<std::string>                               DeadLocker::lockReasons;
+    double                                              DeadLocker::DebounceMs = 20;
+    std::mutex                                          DeadLocker::buttonMtx;
+    bool                                                DeadLocker::pressed = false;
+    int64_t                                             DeadLocker::lastEdgeNs = 0;
+    TimerId                                             DeadLocker::settleTimer = 0;
+    TimerId                                             DeadLocker::releaseTimer = 0;
+    std::mutex                                          DeadLocker::statsMtx;
+    ButtonStats                                         DeadLocker::buttonStats;
     std::mutex                                          DeadLocker::mtx;
-    std::unordered_map<std::string, std::thread>        DeadLocker::unlockThrdPool;
-    std::unordered_map<std::string, std::atomic<std::chrono::_V2::system_clock::time_point>>  DeadLocker::cancelUnlockMap;
-    std::unordered_map<std::string, std::atomic<bool>>  DeadLocker::resolvingMap;
+    std::atomic<uint32_t>                               DeadLocker::reasonMask{0};
+    std::array<std::atomic<int64_t>, size_t(LockReason::Count)> DeadLocker::reasonSince{};
+    SafetySubscriberId                                  DeadLocker::dbSubscriber = 0;
+    std::unique_ptr<TimerScheduler>                     DeadLocker::scheduler;
+    std::array<DeadLocker::PendingUnlock, size_t(LockReason::Count)> DeadLocker::pendingUnlocks{};
+    uint64_t                                            DeadLocker::unlockSequence = 0;
 
-    void DeadLocker::Initialize(int lineOffset) {
-        ButtonLine    = GPIOHandler::GetLine(lineOffset);
-        GPIOHandler::RequestLineInput(ButtonLine, "EmergencyButtonGPIO");
-        cycle.store(true);
-        thrd = std::thread(threadFunc);
+    void DeadLocker::Initialize(int lineOffset, std::unique_ptr<TimerScheduler> timers) {
+        ButtonLine    = static_cast<unsigned int>(lineOffset);
+        scheduler     = timers ? std::move(timers) : std::make_unique<TimerScheduler>(NAMEOF(DeadLocker));
+        dbSubscriber  = SafetyStateChannel::Subscribe(NAMEOF(DbHandler), &DeadLocker::logTransitions);
+        GPIOHandler::RequestLineEvents(ButtonLine, "EmergencyButtonGPIO");
+        {
+            // Active low, the button pulls the line to ground while held
+            std::lock_guard<std::mutex> lk(buttonMtx);
+            pressed = false;
+            lastEdgeNs = monotonicNs();
+            if (GPIOHandler::GetValue(ButtonLine) == 0) applyButton(true, lastEdgeNs);
+        }
+        // No thread of our own, the edges come from the GPIO event loop
+        GPIOHandler::Watch(ButtonLine, [](unsigned int, const GpioEvent& event) { DeadLocker::onEdge(event); });
     }
 
     void DeadLocker::Dispose() {
-        cycle.store(false);
-        if (thrd.joinable()) thrd.join();
-
-        for(auto& el : cancelUnlockMap)
+        // Returns once a running edge callback is done
+        GPIOHandler::Unwatch(ButtonLine);
         {
-            el.second.store(std::chrono::system_clock::now());
+            std::lock_guard<std::mutex> blk(buttonMtx);
+            if (scheduler) {
+                scheduler->Cancel(settleTimer);
+                scheduler->Cancel(releaseTimer);
+            }
+            settleTimer = 0;
+            releaseTimer = 0;
         }
-        
+        {
+            // Pending unlocks are dropped, the system stays locked
+            std::lock_guard<std::mutex> lk(mtx);
+            pendingUnlocks.fill(PendingUnlock{});
+        }
+        scheduler.reset();
+        SafetyStateChannel::Unsubscribe(dbSubscriber);
+        dbSubscriber = 0;
+
         GPIOHandler::ReleaseLine(ButtonLine);
     }
 
@@ -39,79 +72,236 @@ namespace DebuggerInfrastructure
         return locked.load();
     }
 
-    void DeadLocker::EmergencyInitiate(const std::string& caller) {
+    void DeadLocker::EmergencyInitiate(LockReason reason) {
         std::lock_guard<std::mutex> lk(mtx);
-        if (lockReasons.empty()) {
+        SafetyTrace::Mark(TraceHop::Initiated);
+        if (reasonMask.load() == 0) {
             locked.store(true);
             AimHandler::EmergencyDisableAndLock();
-            if(caller != NAMEOF(main))
-            {
-                DbHandler::InsertDataNow(EMERGENCYLOCK, NAMEOF(DeadLocker), "System was locked because of an emergency.");
-            }
         }
-        cancelUnlockMap[caller].store(std::chrono::system_clock::now());
-        lockReasons.insert(caller);
+        cancelUnlock(reason);
+        if (!(reasonMask.load() & bit(reason))) {
+            int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+            reasonSince[size_t(reason)].store(now, std::memory_order_relaxed);
+            reasonMask.fetch_or(bit(reason), std::memory_order_release);
+        }
+        // Cut first, everyone else learns about it from the channel
+        publishLocked();
     }
 
-    void DeadLocker::Recover(const std::string& caller) {
-        std::lock_guard<std::mutex> lk(mtx);
-        if(lockReasons.find(caller) == lockReasons.end()) return;
-        bool callerAlreadyUnlocking = DeadLocker::resolvingMap[caller].load();
-        if (!callerAlreadyUnlocking) {
-            unlockThrdPool[caller] = std::thread([caller] {
-                std::chrono::_V2::system_clock::time_point unlockTime = std::chrono::system_clock::now();
-                DeadLocker::resolvingMap[caller].store(true);
-                auto total = int64_t(DeadLocker::UnlockDelayMs);
-                int64_t waited = 0;
-                while (waited < total && unlockTime > DeadLocker::cancelUnlockMap[caller].load()) {
-                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
-                    waited += 10;
-                }
-                if (unlockTime > DeadLocker::cancelUnlockMap[caller].load()) 
-                {
-                    DeadLocker::lockReasons.erase(caller);
-                    if(DeadLocker::lockReasons.empty())
-                    {
-                        DeadLocker::unlockNow();
-                        DbHandler::InsertDataNow(EMERGENCYUNLOCK, NAMEOF(DeadLocker), "All emergencies were cleared. System recovered.");
-                    }
-                }
-                DeadLocker::resolvingMap[caller].store(false);
-            });
-            unlockThrdPool[caller].detach();
-        }
-    }
-
-    void DeadLocker::unlockNow() {
+    void DeadLocker::cancelUnlock(LockReason reason) {
+        PendingUnlock& pending = pendingUnlocks[size_t(reason)];
+        if (pending.timer == 0) return;
+        if (scheduler) scheduler->Cancel(pending.timer);
+        pending = PendingUnlock{};
+    }
+
+    void DeadLocker::Recover(LockReason reason) {
         std::lock_guard<std::mutex> lk(mtx);
-        if (locked.load() && lockReasons.empty()) {
-            locked.store(false);
-            LaserHandler::Unlock();
-            AimHandler::Unlock();
-            AimHandler::RestoreLastState();
+        recoverLocked(reason);
+    }
+
+    void DeadLocker::recoverLocked(LockReason reason) {
+        if(!(reasonMask.load() & bit(reason))) return;
+        PendingUnlock& pending = pendingUnlocks[size_t(reason)];
+        // Already counting down for this reason
+        if(pending.timer != 0) return;
+        if(!scheduler)
+        {
+            Logger::Warning("DeadLocker is not running, {} cannot recover", ReasonName(reason));
+            return;
+        }
+        uint64_t sequence = ++unlockSequence;
+        pending.sequence = sequence;
+        pending.timer = scheduler->ScheduleAfter(std::chrono::duration_cast<TimerScheduler::Clock::duration>(
+                                                     std::chrono::duration<double, std::milli>(UnlockDelayMs)),
+                                                 [reason, sequence] { DeadLocker::finishRecover(reason, sequence); });
+        publishLocked();
+    }
+
+    void DeadLocker::finishRecover(LockReason reason, uint64_t sequence) {
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            PendingUnlock& pending = pendingUnlocks[size_t(reason)];
+            // Cancelled by a new emergency of the same reason after the timer had started
+            if (pending.timer == 0 || pending.sequence != sequence) return;
+            pending = PendingUnlock{};
+            uint32_t remaining = reasonMask.fetch_and(~bit(reason), std::memory_order_acq_rel) & ~bit(reason);
+            if (remaining == 0 && locked.load()) {
+                locked.store(false);
+                LaserHandler::Unlock();
+                AimHandler::Unlock();
+                AimHandler::RestoreLastState();
+            }
+            publishLocked();
         }
     }
 
-    void DeadLocker::threadFunc() {
-        auto lastReleased = std::chrono::system_clock::now();
-        while (cycle.load()) {
-            if (!gpiod_line_get_value(ButtonLine) && !lockReasons.contains(NAMEOF(DeadLocker))) {
-                EmergencyInitiate(NAMEOF(DeadLocker));
+    void DeadLocker::publishLocked() {
+        uint32_t recovering = 0;
+        for (size_t i = 0; i < pendingUnlocks.size(); i++) {
+            if (pendingUnlocks[i].timer != 0) recovering |= bit(static_cast<LockReason>(i));
+        }
+        SafetyStateChannel::Publish(locked.load(), reasonMask.load(), recovering);
+    }
+
+    void DeadLocker::logTransitions(const SafetyState& previous, const SafetyState& current) {
+        // Coalesced transitions alternate, starting from the previous state
+        uint64_t transitions = (current.locks - previous.locks) + (current.unlocks - previous.unlocks);
+        int64_t time = current.changedNs / 1000000000;
+        for (uint64_t i = 0; i < transitions; i++) {
+            bool locking = (i % 2 == 0) != previous.locked;
+            if (!locking) {
+                DbHandler::InsertData(RecordData(time, EMERGENCYUNLOCK, NAMEOF(DeadLocker), "All emergencies were cleared. System recovered."));
+            } else if (!(current.reasonMask & bit(LockReason::Main))) {
+                DbHandler::InsertData(RecordData(time, EMERGENCYLOCK, NAMEOF(DeadLocker), "System was locked because of an emergency."));
+            }
+        }
+    }
+
+    bool DeadLocker::HasReason(LockReason reason) {
+        return reasonMask.load(std::memory_order_acquire) & bit(reason);
+    }
+
+    uint32_t DeadLocker::GetReasonMask() {
+        return reasonMask.load(std::memory_order_acquire);
+    }
+
+    std::vector<ActiveLockReason> DeadLocker::GetReasons() {
+        uint32_t mask = reasonMask.load(std::memory_order_acquire);
+        std::vector<ActiveLockReason> reasons;
+        for (size_t i = 0; i < size_t(LockReason::Count); i++) {
+            LockReason reason = static_cast<LockReason>(i);
+            if (!(mask & bit(reason))) continue;
+            auto since = std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                std::chrono::nanoseconds(reasonSince[i].load(std::memory_order_relaxed))));
+            reasons.push_back(ActiveLockReason{reason, since});
+        }
+        std::sort(reasons.begin(), reasons.end(),
+                  [](const ActiveLockReason& a, const ActiveLockReason& b) { return a.since < b.since; });
+        return reasons;
+    }
+
+    std::string DeadLocker::DescribeReasons() {
+        std::string description;
+        for (const ActiveLockReason& active : GetReasons()) {
+            description += " " + std::string(ReasonName(active.reason)) + " ";
+        }
+        return description;
+    }
+
+    std::string_view DeadLocker::ReasonName(LockReason reason) {
+        switch (reason) {
+            case LockReason::Main:                  return NAMEOF(main);
+            case LockReason::EmergencyButton:       return NAMEOF(DeadLocker);
+            case LockReason::NeuralNetworkHandler:  return NAMEOF(NeuralNetworkHandler);
+            case LockReason::RESTApi:               return NAMEOF(RESTApi);
+            case LockReason::Watchdog:              return NAMEOF(Watchdog);
+            default:                                return "Unknown";
+        }
+    }
+
+    ButtonStats DeadLocker::GetButtonStats() {
+        std::lock_guard<std::mutex> lk(statsMtx);
+        return buttonStats;
+    }
+
+    double DeadLocker::GetUnlockDelayMs() {
+        return UnlockDelayMs;
+    }
+
+    double DeadLocker::GetDebounceMs() {
+        return DebounceMs;
+    }
+
+    int64_t DeadLocker::monotonicNs() {
+        // The scheduler's clock, CLOCK_MONOTONIC like the edge timestamps unless it is a virtual one
+        if (scheduler) {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(scheduler->Now().time_since_epoch()).count();
+        }
+        timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return int64_t(now.tv_sec) * 1000000000 + now.tv_nsec;
+    }
+
+    void DeadLocker::onPress(int64_t edgeNs) {
+        bool newReason = !HasReason(LockReason::EmergencyButton);
+        SafetyTrace::Scope trace(LockReason::EmergencyButton,
+                                 SafetyTrace::Clock::time_point(std::chrono::nanoseconds(edgeNs)));
+        SafetyTrace::Mark(TraceHop::Detected);
+        // Also when already locked: a press cancels an unlock that is counting down
+        EmergencyInitiate(LockReason::EmergencyButton);
+        double latencyUs = double(monotonicNs() - edgeNs) / 1000.0;
+        {
+            std::lock_guard<std::mutex> lk(statsMtx);
+            buttonStats.presses++;
+            buttonStats.lastLatencyUs = latencyUs;
+            buttonStats.meanLatencyUs += (latencyUs - buttonStats.meanLatencyUs) / double(buttonStats.presses);
+            buttonStats.maxLatencyUs = std::max(buttonStats.maxLatencyUs, latencyUs);
+        }
+        // The next edge may be waiting on this thread, the console and the database are written elsewhere
+        RecordQueue::Post([latencyUs, newReason] {
+            Logger::Info("Emergency button press handled, lasers off {:.0f} us after the edge", latencyUs);
+            if (newReason) {
                 DbHandler::InsertDataNow(EMERGENCYADDLOCKREASON, NAMEOF(DeadLocker), "The Emergency Button was pressed.");
-                GPIOHandler::WaitForValue(ButtonLine, true, cycle);
-                lastReleased = std::chrono::system_clock::now();
-            } else {
-                auto now = std::chrono::system_clock::now();
-                if (locked.load() &&
-                    std::chrono::duration<double, std::milli>(now - lastReleased).count()
-                        > UnlockDelayMs && lockReasons.contains(NAMEOF(DeadLocker))
-                    && (!resolvingMap.contains(NAMEOF(DeadLocker)) || !resolvingMap.at(NAMEOF(DeadLocker)).load()))
-                {
-                    Recover(NAMEOF(DeadLocker));
-                    DbHandler::InsertDataNow(EMERGENCYREMOVELOCKREASON, NAMEOF(DeadLocker), "The Emergency Button was released.");
-                }
             }
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        });
+    }
+
+    void DeadLocker::onRelease() {
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            if (!HasReason(LockReason::EmergencyButton)) return;
+            // Pressed again while this timer was already running. Checked under mtx, so a press
+            // that comes later finds the unlock pending and cancels it in EmergencyInitiate
+            if (GPIOHandler::GetValue(ButtonLine) == 0) return;
+            recoverLocked(LockReason::EmergencyButton);
+        }
+        RecordQueue::Post([] {
+            DbHandler::InsertDataNow(EMERGENCYREMOVELOCKREASON, NAMEOF(DeadLocker), "The Emergency Button was released.");
+        });
+    }
+
+    void DeadLocker::onEdge(const GpioEvent& event) {
+        std::lock_guard<std::mutex> blk(buttonMtx);
+        const int64_t debounceNs = int64_t(DebounceMs * 1e6);
+        // The first edge acts at once, what follows within the debounce window is contact bounce
+        if (event.timestampNs - lastEdgeNs < debounceNs) {
+            {
+                std::lock_guard<std::mutex> lk(statsMtx);
+                buttonStats.bounces++;
+            }
+            if (settleTimer == 0 && scheduler) {
+                int64_t remainingNs = std::max<int64_t>(0, lastEdgeNs + debounceNs - monotonicNs());
+                settleTimer = scheduler->ScheduleAfter(std::chrono::nanoseconds(remainingNs), [] { DeadLocker::onSettled(); });
+            }
+            return;
+        }
+        if (!event.rising != pressed) applyButton(!event.rising, event.timestampNs);
+    }
+
+    void DeadLocker::onSettled() {
+        std::lock_guard<std::mutex> blk(buttonMtx);
+        if (settleTimer == 0) return;
+        settleTimer = 0;
+        int value = GPIOHandler::GetValue(ButtonLine);
+        if (value >= 0 && (value == 0) != pressed) applyButton(value == 0, monotonicNs());
+    }
+
+    void DeadLocker::applyButton(bool nowPressed, int64_t edgeNs) {
+        pressed = nowPressed;
+        lastEdgeNs = edgeNs;
+        if (releaseTimer != 0) {
+            scheduler->Cancel(releaseTimer);
+            releaseTimer = 0;
+        }
+        if (pressed) {
+            onPress(edgeNs);
+            return;
         }
+        // The button has to stay released for UnlockDelayMs before its lock reason starts recovering
+        int64_t remainingNs = std::max<int64_t>(0, edgeNs + int64_t(UnlockDelayMs * 1e6) - monotonicNs());
+        releaseTimer = scheduler->ScheduleAfter(std::chrono::nanoseconds(remainingNs), [] { DeadLocker::onRelease(); });
     }
-}
\ No newline at end of file
+}
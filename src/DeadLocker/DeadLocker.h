@@ -1,41 +1,120 @@
 #pragma once
 #include <chrono>
-#include <thread>
 #include <atomic>
+#include <cstdint>
 #include <mutex>
-#include <set>
+#include <array>
 #include <string>
-#include <gpiod.h>
-#include <unordered_map>
+#include <string_view>
+#include <vector>
+#include <memory>
 #include "../Logger/Logger.h"
+#include "../TimerScheduler/TimerScheduler.h"
+#include "../SafetyStateChannel/SafetyStateChannel.h"
 
 namespace DebuggerInfrastructure
 {
     class DbHandler;
+    struct GpioEvent;
+
+    struct ButtonStats
+    {
+        uint64_t presses = 0;
+        uint64_t bounces = 0;           ///< Edges dropped by the debounce.
+        double lastLatencyUs = 0.0;     ///< Kernel edge timestamp to lasers off.
+        double meanLatencyUs = 0.0;
+        double maxLatencyUs = 0.0;
+    };
+
+    /**
+     * @brief Everything that can hold the system locked, one bit each in the DeadLocker mask.
+     *
+     * The names are the ones written to the database and shown on /status.
+     */
+    enum class LockReason : uint8_t
+    {
+        Main,                   ///< "main", shutdown or a signal
+        EmergencyButton,        ///< "DeadLocker", the physical button
+        NeuralNetworkHandler,   ///< a protected entity is in view
+        RESTApi,                ///< the veto of POST /disable
+        Watchdog,               ///< a pipeline stage stopped making progress
+        Count
+    };
+
+    struct ActiveLockReason
+    {
+        LockReason reason;
+        std::chrono::system_clock::time_point since;
+    };
 
     class DeadLocker {
     public:
         // lineOffset - GPIO line for emergency button
-        // unlockDelayMs - delay after "Recover" before final unlock
-        static void Initialize(int lineOffset);
+        // timers - runs the unlock delays and is the clock of the button, nullptr for a threaded one.
+        //          A virtual scheduler makes the whole interlock replayable, see InterlockSimulation
+        static void Initialize(int lineOffset, std::unique_ptr<TimerScheduler> timers = nullptr);
         static void Dispose();
         static bool IsLocked();
-        static void EmergencyInitiate(const std::string& caller);
-        static void Recover(const std::string& caller);
-        static std::set<std::string> lockReasons;
+        static void EmergencyInitiate(LockReason reason);
+        static void Recover(LockReason reason);
+        // Lock-free, one atomic load: safe to call on every frame
+        static bool HasReason(LockReason reason);
+        static uint32_t GetReasonMask();
+        // Active reasons with the time each one was raised, oldest first
+        static std::vector<ActiveLockReason> GetReasons();
+        // e.g. " NeuralNetworkHandler  RESTApi ", for the human readable status strings
+        static std::string DescribeReasons();
+        static std::string_view ReasonName(LockReason reason);
+        static ButtonStats GetButtonStats();
+        // Delay after "Recover" before final unlock, the button also has to stay released this long first
+        static double GetUnlockDelayMs();
+        static double GetDebounceMs();
 
     private:
-        static void threadFunc();
-        static void unlockNow();
+        // Called by the GPIO event loop for every edge of the button line
+        static void onEdge(const GpioEvent& event);
+        // Caller holds buttonMtx
+        static void applyButton(bool nowPressed, int64_t edgeNs);
+        static void onSettled();
+        // Caller holds mtx
+        static void recoverLocked(LockReason reason);
+        static void finishRecover(LockReason reason, uint64_t sequence);
+        static void cancelUnlock(LockReason reason);
+        static void publishLocked();
+        // Subscribed to the SafetyStateChannel, records the lock transitions off the cut path
+        static void logTransitions(const SafetyState& previous, const SafetyState& current);
+        static constexpr uint32_t bit(LockReason reason) { return 1u << static_cast<unsigned>(reason); }
+        static void onPress(int64_t edgeNs);
+        static void onRelease();
+        static int64_t monotonicNs();
 
-        static gpiod_line* ButtonLine;
-        static std::thread thrd;
-        static std::atomic<bool> cycle;
+        static unsigned int ButtonLine;
         static std::atomic<bool> locked;
         static double UnlockDelayMs;
+        static double DebounceMs;
+        // Debounced button state, taken before mtx when both are needed
+        static std::mutex buttonMtx;
+        static bool pressed;
+        static int64_t lastEdgeNs;
+        static TimerId settleTimer;     ///< Re-reads the level once a bounce has settled
+        static TimerId releaseTimer;    ///< Recovers the button reason after UnlockDelayMs released
+        static std::mutex statsMtx;
+        static ButtonStats buttonStats;
+        // Serializes the lock transitions, readers of the mask never take it
         static std::mutex mtx;
-        static std::unordered_map<std::string, std::thread>       unlockThrdPool;
-        static std::unordered_map<std::string, std::atomic<std::chrono::_V2::system_clock::time_point>> cancelUnlockMap;
-        static std::unordered_map<std::string, std::atomic<bool>> resolvingMap;
+        static std::atomic<uint32_t> reasonMask;
+        // system_clock ns since epoch, written before the bit is set
+        static std::array<std::atomic<int64_t>, size_t(LockReason::Count)> reasonSince;
+
+        struct PendingUnlock
+        {
+            TimerId timer = 0;      ///< 0 when the reason is not counting down
+            uint64_t sequence = 0;  ///< Tells a late timer apart from the one that replaced it
+        };
+
+        static SafetySubscriberId dbSubscriber;
+        static std::unique_ptr<TimerScheduler> scheduler;
+        static std::array<PendingUnlock, size_t(LockReason::Count)> pendingUnlocks;
+        static uint64_t unlockSequence;
     };
 }
\ No newline at end of file
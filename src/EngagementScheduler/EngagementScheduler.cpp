@@ -0,0 +1,135 @@
+#include "EngagementScheduler.h"
+#include "../Logger/Logger.h"
+#include <algorithm>
+#include <cmath>
+
+namespace DebuggerInfrastructure
+{
+    EngagementScheduler::EngagementScheduler(std::chrono::milliseconds dwell)
+        : dwell_(dwell)
+    {
+    }
+
+    const Track* EngagementScheduler::Next(const std::vector<Track>& tracks, bool firing, std::chrono::steady_clock::time_point now)
+    {
+        auto elapsed = lastTick_ ? now - *lastTick_ : std::chrono::steady_clock::duration::zero();
+        lastTick_ = now;
+        while (!completions_.empty() && now - completions_.front() > std::chrono::minutes(1)) completions_.pop_front();
+
+        // Retired ids are only remembered while their track lives
+        std::erase_if(retired_, [&](uint64_t id) {
+            return std::none_of(tracks.begin(), tracks.end(), [id](const Track& track) { return track.id == id; });
+        });
+
+        std::vector<const Track*> candidates;
+        for (const auto& track : tracks) {
+            if (track.verification != Verification::Confirmed || track.lastSeen != now || retired_.contains(track.id)) continue;
+            candidates.push_back(&track);
+        }
+
+        if (current_) {
+            auto it = std::find_if(candidates.begin(), candidates.end(), [&](const Track* track) { return track->id == *current_; });
+            if (it == candidates.end()) {
+                lost_++;
+                Logger::Verbose("Target #{} lost after {} ms of firing", *current_,
+                                std::chrono::duration_cast<std::chrono::milliseconds>(fired_).count());
+                current_.reset();
+            } else {
+                if (firing) fired_ += elapsed;
+                if (fired_ < dwell_) {
+                    aim_ = {(*it)->x, (*it)->y};
+                    return *it;
+                }
+                retired_.insert(*current_);
+                completions_.push_back(now);
+                engaged_++;
+                Logger::Info("Target #{} engaged, {:.1f} targets per minute", *current_, Stats(now).engagedPerMinute);
+                current_.reset();
+                candidates.erase(it);
+            }
+        }
+
+        if (candidates.empty()) return nullptr;
+        if (candidates.size() > maxPlanned) {
+            // Beyond this the tour gets expensive and is stale by the next frame anyway
+            std::partial_sort(candidates.begin(), candidates.begin() + maxPlanned, candidates.end(), [&](const Track* a, const Track* b) {
+                return Distance(aim_, {a->x, a->y}) < Distance(aim_, {b->x, b->y});
+            });
+            candidates.resize(maxPlanned);
+        }
+
+        std::vector<std::pair<double, double>> points;
+        points.reserve(candidates.size());
+        for (const Track* track : candidates) points.emplace_back(track->x, track->y);
+        const Track* next = candidates[Plan(aim_, points).front()];
+
+        slew_ += Distance(aim_, {next->x, next->y});
+        switches_++;
+        current_ = next->id;
+        fired_ = std::chrono::steady_clock::duration::zero();
+        aim_ = {next->x, next->y};
+        return next;
+    }
+
+    EngagementStats EngagementScheduler::Stats(std::chrono::steady_clock::time_point now) const
+    {
+        EngagementStats stats;
+        stats.engaged = engaged_;
+        stats.lost = lost_;
+        stats.engagedPerMinute = double(std::count_if(completions_.begin(), completions_.end(),
+                                                      [&](auto time) { return now - time <= std::chrono::minutes(1); }));
+        stats.averageSlew = switches_ > 0 ? slew_ / double(switches_) : 0.0;
+        return stats;
+    }
+
+    bool EngagementScheduler::IsRetired(uint64_t id) const
+    {
+        return retired_.contains(id);
+    }
+
+    std::chrono::milliseconds EngagementScheduler::Dwell() const
+    {
+        return dwell_;
+    }
+
+    double EngagementScheduler::Distance(std::pair<double, double> a, std::pair<double, double> b)
+    {
+        return std::max(std::abs(a.first - b.first), std::abs(a.second - b.second));
+    }
+
+    std::vector<size_t> EngagementScheduler::Plan(std::pair<double, double> start, const std::vector<std::pair<double, double>>& points)
+    {
+        const size_t n = points.size();
+        std::vector<size_t> order;
+        order.reserve(n);
+        std::vector<bool> used(n, false);
+        std::pair<double, double> from = start;
+        for (size_t k = 0; k < n; k++) {
+            size_t best = n;
+            for (size_t i = 0; i < n; i++) {
+                if (!used[i] && (best == n || Distance(from, points[i]) < Distance(from, points[best]))) best = i;
+            }
+            used[best] = true;
+            order.push_back(best);
+            from = points[best];
+        }
+
+        // 2-opt on the open path, position 0 is the fixed start
+        auto at = [&](size_t position) { return position == 0 ? start : points[order[position - 1]]; };
+        bool improved = true;
+        for (size_t pass = 0; improved && pass < 8; pass++) {
+            improved = false;
+            for (size_t i = 1; i < n; i++) {
+                for (size_t j = i + 1; j <= n; j++) {
+                    double before = Distance(at(i - 1), at(i)) + (j < n ? Distance(at(j), at(j + 1)) : 0.0);
+                    double after = Distance(at(i - 1), at(j)) + (j < n ? Distance(at(i), at(j + 1)) : 0.0);
+                    if (after + 1e-9 < before) {
+                        std::reverse(order.begin() + long(i - 1), order.begin() + long(j));
+                        improved = true;
+                    }
+                }
+            }
+        }
+        return order;
+    }
+}
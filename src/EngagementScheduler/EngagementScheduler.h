@@ -0,0 +1,63 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "../TargetTracker/TargetTracker.h"
+
+namespace DebuggerInfrastructure
+{
+    struct EngagementStats
+    {
+        uint64_t engaged = 0;           ///< Targets that received their full dwell and were retired.
+        uint64_t lost = 0;              ///< Targets whose track vanished before the dwell completed.
+        double engagedPerMinute = 0.0;  ///< Over the last minute.
+        double averageSlew = 0.0;       ///< Mean jump between consecutive targets, normalized frame units.
+    };
+
+    /**
+     * @brief Decides which confirmed track of one camera the turret engages next.
+     *
+     * The current target is held until it received its dwell time with the laser on, then retired for as
+     * long as its track lives. The next target is the head of an open tour over the remaining confirmed
+     * tracks, starting at the last aim point: greedy nearest neighbour, improved with 2-opt. Distances are
+     * Chebyshev, since both servos slew at the same time and the longer axis decides the travel time.
+     */
+    class EngagementScheduler
+    {
+    public:
+        explicit EngagementScheduler(std::chrono::milliseconds dwell = std::chrono::milliseconds(400));
+
+        /**
+         * @param firing Whether the laser is on at the current target, dwell only counts while it is.
+         * @return The track to aim at, or nullptr when there is nothing left to engage.
+         */
+        const Track* Next(const std::vector<Track>& tracks, bool firing, std::chrono::steady_clock::time_point now);
+
+        EngagementStats Stats(std::chrono::steady_clock::time_point now) const;
+        bool IsRetired(uint64_t id) const;
+        std::chrono::milliseconds Dwell() const;
+
+    private:
+        static double Distance(std::pair<double, double> a, std::pair<double, double> b);
+        static std::vector<size_t> Plan(std::pair<double, double> start, const std::vector<std::pair<double, double>>& points);
+
+        std::chrono::milliseconds dwell_;
+        std::optional<uint64_t> current_;
+        std::chrono::steady_clock::duration fired_ {};      ///< Laser-on time accumulated on current_.
+        std::optional<std::chrono::steady_clock::time_point> lastTick_;
+        std::pair<double, double> aim_ {0.5, 0.5};
+        std::unordered_set<uint64_t> retired_;
+        std::deque<std::chrono::steady_clock::time_point> completions_;
+        uint64_t engaged_ = 0;
+        uint64_t lost_ = 0;
+        uint64_t switches_ = 0;
+        double slew_ = 0.0;
+
+        static constexpr size_t maxPlanned = 32;
+    };
+}
@@ -1,4 +1,9 @@
 #include "../AimHandler/AimHandler.h"
+#include "../MotionController/MotionController.h"
+#include "../PulseEngine/PulseEngine.h"
+#include "../SafetyTrace/SafetyTrace.h"
+#include "../Watchdog/Watchdog.h"
+#include "../GPIOHandler/GPIOHandler.h"
 #include "ExternalConfigsHelper.h"
 #include <fstream>
 namespace DebuggerInfrastructure
@@ -19,38 +24,59 @@ namespace DebuggerInfrastructure
         return ss.str();
     }
 
-    CalibrationSettings ExternalConfigsHelper::getCalibrationSettings(std::string path)
+    std::string calibrationKey(const std::string& path, size_t turret) {
+        return turret == 0 ? path : path + "#" + std::to_string(turret);
+    }
+
+    // Turret 0 keeps its calibration at the top level, where it was before there were several turrets
+    nlohmann::json& calibrationNode(nlohmann::json& root, size_t turret) {
+        return turret == 0 ? root : root["turrets"][turret]["calibration"];
+    }
+
+    CalibrationSettings ExternalConfigsHelper::getCalibrationSettings(std::string path, size_t turret)
     {
         CalibrationSettings settings;
-        if(settingsMap.contains(path))
+        std::string key = calibrationKey(path, turret);
+        if(settingsMap.contains(key))
         {
-            settings = settingsMap.at(path); 
+            settings = settingsMap.at(key); 
         }
         else
         {
-            nlohmann::json settingsJson = readJson(path);
+            nlohmann::json rootJson = readJson(path);
+            nlohmann::json& settingsJson = calibrationNode(rootJson, turret);
             std::vector<double> calibrationArrayX = settingsJson["calibrationX"];
             std::vector<double> calibrationArrayY = settingsJson["calibrationY"];
             std::vector<double> calibrationCenter = settingsJson["calibrationCenter"];
             settings.calibrationX = {calibrationArrayX[0],calibrationArrayX[1]};
             settings.calibrationY = {calibrationArrayY[0],calibrationArrayY[1]};
             settings.calibrationCenter = {calibrationCenter[0],calibrationCenter[1]};
-            settingsMap[path] = settings;
+            if(settingsJson.contains("calibrationPoints"))
+            {
+                for(const auto& pointJson : settingsJson.at("calibrationPoints"))
+                {
+                    settings.calibrationPoints.push_back(CalibrationPoint{
+                        {pointJson.at("x").get<double>(), pointJson.at("y").get<double>()},
+                        {pointJson.at("angleX").get<double>(), pointJson.at("angleY").get<double>()}
+                    });
+                }
+            }
+            settingsMap[key] = settings;
         }
         return settings;
     }
 
-    CalibrationSettings ExternalConfigsHelper::getOrCreateCalibrationSettings(std::string path)
+    CalibrationSettings ExternalConfigsHelper::getOrCreateCalibrationSettings(std::string path, size_t turret)
     {
         CalibrationSettings settings;
         try
         {
-            settings = getCalibrationSettings(path);
+            settings = getCalibrationSettings(path, turret);
         }
         catch(...)
         {
-            setDefaultCalibrationSettings(path);
-            settings = getCalibrationSettings(path);
+            setDefaultCalibrationSettings(path, turret);
+            settings = getCalibrationSettings(path, turret);
         }
         return settings;
     }
@@ -72,29 +98,265 @@ namespace DebuggerInfrastructure
         return nlohmann::json::parse(fileContentsString);
     }
 
-    void ExternalConfigsHelper::setCalibrationSettings(CalibrationSettings settings, std::string path)
+    void ExternalConfigsHelper::setCalibrationSettings(CalibrationSettings settings, std::string path, size_t turret)
     {
-        settingsMap[path] = settings;
-        nlohmann::json jsonSettings;
+        settingsMap[calibrationKey(path, turret)] = settings;
+        nlohmann::json rootJson;
         if(fileExists(path))
         {
-            jsonSettings = readJson(path);
+            rootJson = readJson(path);
         }
+        nlohmann::json& jsonSettings = calibrationNode(rootJson, turret);
         jsonSettings["calibrationX"] = std::vector<double>{settings.calibrationX.first, settings.calibrationX.second};
         jsonSettings["calibrationY"] = std::vector<double>{settings.calibrationY.first, settings.calibrationY.second};
         jsonSettings["calibrationCenter"] = std::vector<double>{settings.calibrationCenter.first, settings.calibrationCenter.second};
+        nlohmann::json points = nlohmann::json::array();
+        for(const auto& point : settings.calibrationPoints)
+        {
+            points.push_back({{"x", point.point.first}, {"y", point.point.second},
+                              {"angleX", point.angles.first}, {"angleY", point.angles.second}});
+        }
+        jsonSettings["calibrationPoints"] = points;
+        writeJson(rootJson, path);
+    }
+
+    void ExternalConfigsHelper::setDefaultCalibrationSettings(std::string path, size_t turret)
+    {
+        setCalibrationSettings(defaultCalibrationSettings, path, turret);
+    }
+
+    std::vector<TurretSettings> ExternalConfigsHelper::getOrCreateTurretSettings(std::string path)
+    {
+        nlohmann::json settingsJson = fileExists(path) ? readJson(path) : nlohmann::json::object();
+        if(!settingsJson.contains("turrets"))
+        {
+            TurretSettings turret;
+            settingsJson["turrets"] = nlohmann::json::array({ nlohmann::json{
+                {"pwmChip", turret.pwmChip},
+                {"xChannel", turret.xChannel},
+                {"yChannel", turret.yChannel},
+                {"laserLine", turret.laserLine}
+            } });
+            writeJson(settingsJson, path);
+        }
+
+        std::vector<TurretSettings> turrets;
+        for(const auto& turretJson : settingsJson.at("turrets"))
+        {
+            TurretSettings turret;
+            turret.pwmChip = turretJson.value("pwmChip", turret.pwmChip);
+            turret.xChannel = turretJson.value("xChannel", turret.xChannel);
+            turret.yChannel = turretJson.value("yChannel", turret.yChannel);
+            turret.laserLine = turretJson.at("laserLine").get<size_t>();
+            if(turretJson.contains("feedback"))
+            {
+                const nlohmann::json& feedbackJson = turretJson.at("feedback");
+                FeedbackSettings& feedback = turret.feedback;
+                feedback.sampleHz = feedbackJson.value("sampleHz", feedback.sampleHz);
+                feedback.toleranceDeg = feedbackJson.value("toleranceDeg", feedback.toleranceDeg);
+                feedback.timeoutMs = feedbackJson.value("timeoutMs", feedback.timeoutMs);
+                for(auto [key, axis] : {std::pair<const char*, AxisFeedbackSettings*>{"x", &feedback.x}, {"y", &feedback.y}})
+                {
+                    if(!feedbackJson.contains(key)) continue;
+                    const nlohmann::json& axisJson = feedbackJson.at(key);
+                    axis->source = axisJson.value("source", axis->source);
+                    axis->adcPath = axisJson.value("adcPath", axis->adcPath);
+                    axis->rawAtMin = axisJson.value("rawAtMin", axis->rawAtMin);
+                    axis->rawAtMax = axisJson.value("rawAtMax", axis->rawAtMax);
+                    axis->minLimitLine = axisJson.value("minLimitLine", axis->minLimitLine);
+                    axis->maxLimitLine = axisJson.value("maxLimitLine", axis->maxLimitLine);
+                }
+            }
+            turrets.push_back(turret);
+        }
+        return turrets;
+    }
+
+    RegionSettings ExternalConfigsHelper::getRegionSettings(std::string path)
+    {
+        RegionSettings settings;
+        if(regionSettingsMap.contains(path))
+        {
+            settings = regionSettingsMap.at(path);
+        }
+        else
+        {
+            nlohmann::json settingsJson = readJson(path);
+            settings.regionsOfInterest = settingsJson.at("regionsOfInterest").get<std::vector<Polygon>>();
+            settings.exclusionZones = settingsJson.at("exclusionZones").get<std::vector<Polygon>>();
+            regionSettingsMap[path] = settings;
+        }
+        return settings;
+    }
+
+    RegionSettings ExternalConfigsHelper::getOrCreateRegionSettings(std::string path)
+    {
+        // Unlike calibration, malformed zones are not replaced with defaults: that would silently drop no-fire zones.
+        if(!regionSettingsMap.contains(path))
+        {
+            nlohmann::json settingsJson = fileExists(path) ? readJson(path) : nlohmann::json::object();
+            if(!settingsJson.contains("regionsOfInterest") || !settingsJson.contains("exclusionZones"))
+            {
+                RegionSettings settings;
+                settings.regionsOfInterest = settingsJson.value("regionsOfInterest", std::vector<Polygon>{});
+                settings.exclusionZones = settingsJson.value("exclusionZones", std::vector<Polygon>{});
+                setRegionSettings(settings, path);
+            }
+        }
+        return getRegionSettings(path);
+    }
+
+    void ExternalConfigsHelper::setRegionSettings(RegionSettings settings, std::string path)
+    {
+        regionSettingsMap[path] = settings;
+        nlohmann::json jsonSettings;
+        if(fileExists(path))
+        {
+            jsonSettings = readJson(path);
+        }
+        jsonSettings["regionsOfInterest"] = settings.regionsOfInterest;
+        jsonSettings["exclusionZones"] = settings.exclusionZones;
         writeJson(jsonSettings, path);
     }
 
-    void ExternalConfigsHelper::setDefaultCalibrationSettings(std::string path)
+    MotionLimits ExternalConfigsHelper::getOrCreateMotionLimits(std::string path)
+    {
+        MotionLimits limits;
+        nlohmann::json settingsJson = fileExists(path) ? readJson(path) : nlohmann::json::object();
+        if(!settingsJson.contains("motion"))
+        {
+            settingsJson["motion"] = {
+                {"tickHz", limits.tickHz},
+                {"maxVelocity", limits.maxVelocity},
+                {"maxAcceleration", limits.maxAcceleration},
+                {"tolerance", limits.tolerance},
+                {"settleMs", limits.settleMs}
+            };
+            writeJson(settingsJson, path);
+        }
+
+        const nlohmann::json& motionJson = settingsJson.at("motion");
+        limits.tickHz = motionJson.value("tickHz", limits.tickHz);
+        limits.maxVelocity = motionJson.value("maxVelocity", limits.maxVelocity);
+        limits.maxAcceleration = motionJson.value("maxAcceleration", limits.maxAcceleration);
+        limits.tolerance = motionJson.value("tolerance", limits.tolerance);
+        limits.settleMs = motionJson.value("settleMs", limits.settleMs);
+        return limits;
+    }
+
+    PulseSettings ExternalConfigsHelper::getOrCreatePulseSettings(std::string path)
+    {
+        PulseSettings settings;
+        nlohmann::json settingsJson = fileExists(path) ? readJson(path) : nlohmann::json::object();
+        if(!settingsJson.contains("pulse"))
+        {
+            settingsJson["pulse"] = {
+                {"engage", settings.engage},
+                {"onUs", settings.train.onTime.count()},
+                {"periodUs", settings.train.period.count()},
+                {"count", settings.train.count},
+                {"priority", settings.priority},
+                {"wakeAheadUs", settings.wakeAhead.count()}
+            };
+            writeJson(settingsJson, path);
+        }
+
+        const nlohmann::json& pulseJson = settingsJson.at("pulse");
+        settings.engage = pulseJson.value("engage", settings.engage);
+        settings.train.onTime = std::chrono::microseconds(pulseJson.value("onUs", settings.train.onTime.count()));
+        settings.train.period = std::chrono::microseconds(pulseJson.value("periodUs", settings.train.period.count()));
+        settings.train.count = pulseJson.value("count", settings.train.count);
+        settings.priority = pulseJson.value("priority", settings.priority);
+        settings.wakeAhead = std::chrono::microseconds(pulseJson.value("wakeAheadUs", settings.wakeAhead.count()));
+        return settings;
+    }
+
+    SafetyTraceSettings ExternalConfigsHelper::getOrCreateSafetyTraceSettings(std::string path)
+    {
+        SafetyTraceSettings settings;
+        nlohmann::json settingsJson = fileExists(path) ? readJson(path) : nlohmann::json::object();
+        if(!settingsJson.contains("safety"))
+        {
+            settingsJson["safety"] = {
+                {"visionBudgetMs", settings.visionBudgetMs},
+                {"directBudgetMs", settings.directBudgetMs}
+            };
+            writeJson(settingsJson, path);
+        }
+
+        const nlohmann::json& safetyJson = settingsJson.at("safety");
+        settings.visionBudgetMs = safetyJson.value("visionBudgetMs", settings.visionBudgetMs);
+        settings.directBudgetMs = safetyJson.value("directBudgetMs", settings.directBudgetMs);
+        return settings;
+    }
+
+    WatchdogSettings ExternalConfigsHelper::getOrCreateWatchdogSettings(std::string path)
     {
-        setCalibrationSettings(defaultCalibrationSettings, path);
+        WatchdogSettings settings;
+        nlohmann::json settingsJson = fileExists(path) ? readJson(path) : nlohmann::json::object();
+        if(!settingsJson.contains("watchdog"))
+        {
+            settingsJson["watchdog"] = {
+                {"enabled", settings.enabled},
+                {"checkPeriodMs", settings.checkPeriodMs},
+                {"captureDeadlineMs", settings.captureDeadlineMs},
+                {"inferenceDeadlineMs", settings.inferenceDeadlineMs},
+                {"controlDeadlineMs", settings.controlDeadlineMs}
+            };
+            writeJson(settingsJson, path);
+        }
+
+        const nlohmann::json& watchdogJson = settingsJson.at("watchdog");
+        settings.enabled = watchdogJson.value("enabled", settings.enabled);
+        settings.checkPeriodMs = watchdogJson.value("checkPeriodMs", settings.checkPeriodMs);
+        settings.captureDeadlineMs = watchdogJson.value("captureDeadlineMs", settings.captureDeadlineMs);
+        settings.inferenceDeadlineMs = watchdogJson.value("inferenceDeadlineMs", settings.inferenceDeadlineMs);
+        settings.controlDeadlineMs = watchdogJson.value("controlDeadlineMs", settings.controlDeadlineMs);
+        return settings;
+    }
+
+    HardwareSettings ExternalConfigsHelper::getOrCreateHardwareSettings(std::string path)
+    {
+        HardwareSettings settings;
+        nlohmann::json settingsJson = fileExists(path) ? readJson(path) : nlohmann::json::object();
+        if(!settingsJson.contains("hardware"))
+        {
+            settingsJson["hardware"] = {
+                {"backend", settings.simulated ? "simulated" : "gpiod"},
+                {"chip", settings.chipName},
+                {"pwmRoot", settings.pwmRoot},
+                {"simulationRoot", settings.simulationRoot},
+                {"pullUps", settings.pullUps},
+                {"servoMaxVelocity", settings.servoMaxVelocity},
+                {"servoTimeConstantMs", settings.servoTimeConstantMs},
+                {"journal", settings.journalPath}
+            };
+            writeJson(settingsJson, path);
+        }
+
+        const nlohmann::json& hardwareJson = settingsJson.at("hardware");
+        std::string backend = hardwareJson.value("backend", std::string("gpiod"));
+        if(backend != "gpiod" && backend != "simulated")
+        {
+            throw std::runtime_error("Unknown hardware backend [" + backend + "], expected gpiod or simulated");
+        }
+        settings.simulated = backend == "simulated";
+        settings.chipName = hardwareJson.value("chip", settings.chipName);
+        settings.pwmRoot = hardwareJson.value("pwmRoot", settings.pwmRoot);
+        settings.simulationRoot = hardwareJson.value("simulationRoot", settings.simulationRoot);
+        settings.pullUps = hardwareJson.value("pullUps", settings.pullUps);
+        settings.servoMaxVelocity = hardwareJson.value("servoMaxVelocity", settings.servoMaxVelocity);
+        settings.servoTimeConstantMs = hardwareJson.value("servoTimeConstantMs", settings.servoTimeConstantMs);
+        settings.journalPath = hardwareJson.value("journal", settings.journalPath);
+        return settings;
     }
 
     CalibrationSettings ExternalConfigsHelper::defaultCalibrationSettings = CalibrationSettings{
         {31.0, 52.0},
         {31.0, 53.0},
-        {42.0, 42.0}
+        {42.0, 42.0},
+        {}
     };
     std::unordered_map<std::string, CalibrationSettings> ExternalConfigsHelper::settingsMap;
+    std::unordered_map<std::string, RegionSettings> ExternalConfigsHelper::regionSettingsMap;
 }
\ No newline at end of file
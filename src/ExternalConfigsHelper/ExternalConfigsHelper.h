@@ -2,21 +2,43 @@
 #include <string>
 #include <unordered_map>
 #include "../ThirdParties/nlohmann/json.hpp"  // nlohmann::json
+#include "../RegionMask/RegionMask.h"
 namespace DebuggerInfrastructure
 {
     class CalibrationSettings;
+    struct TurretSettings;
+    struct CameraSettings;
+    struct VerifierSettings;
+    struct MotionLimits;
+    struct PulseSettings;
+    struct HardwareSettings;
+    struct SafetyTraceSettings;
+    struct WatchdogSettings;
 
     class ExternalConfigsHelper
     {
     public:
-        static CalibrationSettings getCalibrationSettings(std::string path = "config.json");
-        static CalibrationSettings getOrCreateCalibrationSettings(std::string path = "config.json");
-        static void setCalibrationSettings(CalibrationSettings settings, std::string path = "config.json");
-        static void setDefaultCalibrationSettings(std::string path = "config.json");
+        static CalibrationSettings getCalibrationSettings(std::string path = "config.json", size_t turret = 0);
+        static CalibrationSettings getOrCreateCalibrationSettings(std::string path = "config.json", size_t turret = 0);
+        static void setCalibrationSettings(CalibrationSettings settings, std::string path = "config.json", size_t turret = 0);
+        static void setDefaultCalibrationSettings(std::string path = "config.json", size_t turret = 0);
+        static std::vector<TurretSettings> getOrCreateTurretSettings(std::string path = "config.json");
+        static RegionSettings getRegionSettings(std::string path = "config.json");
+        static RegionSettings getOrCreateRegionSettings(std::string path = "config.json");
+        static void setRegionSettings(RegionSettings settings, std::string path = "config.json");
+        static std::vector<CameraSettings> getOrCreateCameraSettings(std::string path = "config.json");
+        static VerifierSettings getOrCreateVerifierSettings(std::string path = "config.json");
+        static MotionLimits getOrCreateMotionLimits(std::string path = "config.json");
+        static PulseSettings getOrCreatePulseSettings(std::string path = "config.json");
+        static SafetyTraceSettings getOrCreateSafetyTraceSettings(std::string path = "config.json");
+        static WatchdogSettings getOrCreateWatchdogSettings(std::string path = "config.json");
+        static HardwareSettings getOrCreateHardwareSettings(std::string path = "config.json");
     private:
         static void writeJson(nlohmann::json value, std::string path);
         static nlohmann::json readJson(std::string path);
         static std::unordered_map<std::string, CalibrationSettings> settingsMap;
         static CalibrationSettings defaultCalibrationSettings;
+        static std::unordered_map<std::string, RegionSettings> regionSettingsMap;
+        static std::string defaultCameraSource;
     };
 }
\ No newline at end of file
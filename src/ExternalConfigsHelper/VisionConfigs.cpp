@@ -0,0 +1,82 @@
+// The camera and verifier sections of the config. They need the vision headers (ncnn, OpenCV), so they are
+// built into the executable only and the core stays free of them.
+#include "../NeuralNetworkHandler/NeuralNetworkHandler.h"
+#include "../TargetVerifier/TargetVerifier.h"
+#include "ExternalConfigsHelper.h"
+namespace DebuggerInfrastructure
+{
+    bool fileExists(std::string filename);
+
+    std::vector<CameraSettings> ExternalConfigsHelper::getOrCreateCameraSettings(std::string path)
+    {
+        nlohmann::json settingsJson = fileExists(path) ? readJson(path) : nlohmann::json::object();
+        if(!settingsJson.contains("cameras"))
+        {
+            settingsJson["cameras"] = nlohmann::json::array({ nlohmann::json{{"source", defaultCameraSource}} });
+            writeJson(settingsJson, path);
+        }
+
+        std::vector<CameraSettings> cameras;
+        for(const auto& cameraJson : settingsJson.at("cameras"))
+        {
+            CameraSettings camera;
+            camera.source = cameraJson.at("source").get<std::string>();
+            if(cameraJson.contains("turrets"))
+            {
+                camera.turrets = cameraJson.at("turrets").get<std::vector<size_t>>();
+            }
+            else if(cameraJson.contains("turret"))
+            {
+                camera.turrets = {cameraJson.at("turret").get<size_t>()};
+            }
+            camera.flip = cameraJson.value("flip", camera.flip);
+            camera.maxLatencyMs = cameraJson.value("maxLatencyMs", camera.maxLatencyMs);
+            camera.protectedScanEvery = cameraJson.value("protectedScanEvery", camera.protectedScanEvery);
+            camera.protectedScanInput = cameraJson.value("protectedScanInput", camera.protectedScanInput);
+            if(cameraJson.contains("regionsOfInterest") || cameraJson.contains("exclusionZones"))
+            {
+                RegionSettings regions;
+                regions.regionsOfInterest = cameraJson.value("regionsOfInterest", std::vector<Polygon>{});
+                regions.exclusionZones = cameraJson.value("exclusionZones", std::vector<Polygon>{});
+                camera.regions = regions;
+            }
+            cameras.push_back(camera);
+        }
+        return cameras;
+    }
+
+    VerifierSettings ExternalConfigsHelper::getOrCreateVerifierSettings(std::string path)
+    {
+        VerifierSettings settings;
+        nlohmann::json settingsJson = fileExists(path) ? readJson(path) : nlohmann::json::object();
+        if(!settingsJson.contains("verifier"))
+        {
+            settingsJson["verifier"] = {
+                {"enabled", settings.enabled},
+                {"param", settings.paramPath},
+                {"bin", settings.binPath},
+                {"inputSize", settings.inputSize},
+                {"insectClass", settings.insectClass},
+                {"threshold", settings.threshold},
+                {"maxBatch", settings.maxBatch},
+                {"cropPadding", settings.cropPadding}
+            };
+            writeJson(settingsJson, path);
+        }
+
+        const nlohmann::json& verifierJson = settingsJson.at("verifier");
+        settings.enabled = verifierJson.value("enabled", settings.enabled);
+        settings.paramPath = verifierJson.value("param", settings.paramPath);
+        settings.binPath = verifierJson.value("bin", settings.binPath);
+        settings.inputSize = verifierJson.value("inputSize", settings.inputSize);
+        settings.insectClass = verifierJson.value("insectClass", settings.insectClass);
+        settings.threshold = verifierJson.value("threshold", settings.threshold);
+        settings.maxBatch = verifierJson.value("maxBatch", settings.maxBatch);
+        settings.cropPadding = verifierJson.value("cropPadding", settings.cropPadding);
+        return settings;
+    }
+
+    std::string ExternalConfigsHelper::defaultCameraSource =
+        "libcamerasrc af-mode=continuous ! video/x-raw,width=1024,height=1024,framerate=30/1,format=NV12 ! "
+        "videoconvert ! appsink";
+}
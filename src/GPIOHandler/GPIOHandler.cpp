@@ -1,25 +1,28 @@
 #include "GPIOHandler.h"
+#include "SimulatedGpioChip.h"
+#ifdef WITH_LIBGPIOD
+#include "LibgpiodBackend.h"
+#endif
 #include "../Logger/Logger.h"
-#include <gpiod.h>
 #include <stdexcept>
 #include <iostream>
-#include <thread>
 
 
 namespace DebuggerInfrastructure
 {
     // Static member definitions
-    gpiod_chip*    GPIOHandler::chip        = nullptr;
-    bool           GPIOHandler::initialized = false;
-    std::string    GPIOHandler::chipName    = "";
+    std::unique_ptr<GpioBackend>    GPIOHandler::backend;
+    std::unique_ptr<GpioEventLoop>  GPIOHandler::eventLoop;
+    bool                            GPIOHandler::initialized = false;
+    std::string                     GPIOHandler::chipName    = "";
     /**
-     * @brief Initializes the GPIO chip if not already initialized.
+     * @brief Opens the GPIO chip through libgpiod if not already initialized.
      */
     void GPIOHandler::Initialize(const std::string &chipName)
     {
         // If already initialized, check if the requested name matches the existing one.
         if (initialized) {
-            if (chipName != chipName) {
+            if (chipName != GPIOHandler::chipName) {
                 throw std::runtime_error(
                     "GPIOHandler is already initialized with a different chip name: " +
                     GPIOHandler::chipName + " vs. " + chipName);
@@ -28,23 +31,42 @@ namespace DebuggerInfrastructure
             return;
         }
 
-        // Attempt to open the GPIO chip
-        gpiod_chip *chip = gpiod_chip_open_by_name(chipName.c_str());
-        if (!chip) {
-            throw std::runtime_error("Failed to open GPIO chip: " + chipName);
+#ifdef WITH_LIBGPIOD
+        Initialize(std::make_unique<LibgpiodBackend>(chipName));
+#else
+        throw std::runtime_error("Built without libgpiod, cannot open GPIO chip " + chipName + ", use the simulated backend");
+#endif
+    }
+
+    void GPIOHandler::Initialize(std::unique_ptr<GpioBackend> newBackend)
+    {
+        if (initialized) {
+            throw std::runtime_error("GPIOHandler is already initialized with " + GPIOHandler::chipName);
+        }
+        if (!newBackend) {
+            throw std::runtime_error("GPIOHandler::Initialize() called with a null backend.");
         }
 
         // Store into static members
-        GPIOHandler::chip           = chip;
-        GPIOHandler::chipName       = chipName;
+        GPIOHandler::chipName       = newBackend->Name();
+        GPIOHandler::backend        = std::move(newBackend);
+        GPIOHandler::eventLoop      = std::make_unique<GpioEventLoop>(*GPIOHandler::backend);
         GPIOHandler::initialized    = true;
 
-        // Simple log message for demonstration
-        Logger::Info("GPIOHandler Chip \"{}\" initialized.",chipName);
+        Logger::Info("GPIOHandler Chip \"{}\" initialized.", GPIOHandler::chipName);
+    }
+
+    void GPIOHandler::Initialize(const HardwareSettings &settings)
+    {
+        if (settings.simulated) {
+            Initialize(std::make_unique<SimulatedGpioChip>(settings.pullUps));
+        } else {
+            Initialize(settings.chipName);
+        }
     }
 
     /**
-     * @brief Closes and disposes of the GPIO chip if initialized.
+     * @brief Closes and disposes of the backend if initialized.
      */
     void GPIOHandler::Dispose()
     {
@@ -53,85 +75,142 @@ namespace DebuggerInfrastructure
             return;
         }
 
-        // Close the chip
-        if (chip) {
-            gpiod_chip_close(chip);
-            chip = nullptr;
-        }
-
+        // The loop reads from the backend, it goes first
+        eventLoop.reset();
+        backend.reset();
         chipName.clear();
         initialized = false;
 
         Logger::Info("Disposed of GPIOHandler.");
     }
 
-    /**
-     * @brief Gets the specified line offset from the static chip pointer.
-     */
-    gpiod_line* GPIOHandler::GetLine(unsigned int lineOffset)
+    GpioBackend& GPIOHandler::Backend()
     {
-        if (!initialized || !chip) {
-            throw std::runtime_error("GPIOHandler::GetLine() called but chip is not initialized.");
-        }
-
-        gpiod_line *line = gpiod_chip_get_line(chip, lineOffset);
-        if (!line) {
-            throw std::runtime_error(
-                "Failed to get GPIO line " + std::to_string(lineOffset));
+        if (!initialized || !backend) {
+            throw std::runtime_error("GPIOHandler::Backend() called but chip is not initialized.");
         }
-        return line;
+        return *backend;
     }
 
     /**
-     * @brief Requests the line as output using libgpiod.
+     * @brief Requests the line as output.
      */
-    void GPIOHandler::RequestLineOutput(gpiod_line *line,
+    void GPIOHandler::RequestLineOutput(unsigned int line,
                                         const std::string &consumer,
                                         int defaultVal /*=0*/)
     {
-        if (!initialized || !chip) {
+        if (!initialized || !backend) {
             throw std::runtime_error("GPIOHandler::RequestLineOutput() called but chip is not initialized.");
         }
-        if (!line) {
-            throw std::runtime_error("GPIOHandler::RequestLineOutput() called with null line pointer.");
-        }
+        backend->RequestOutput(line, consumer, defaultVal);
+    }
 
-        if (gpiod_line_request_output(line, consumer.c_str(), defaultVal) < 0) {
-            throw std::runtime_error("Failed to request line as output. Consumer: " + consumer);
+    void GPIOHandler::RequestLineInput(unsigned int line,
+                                        const std::string &consumer)
+    {
+        if (!initialized || !backend) {
+            throw std::runtime_error("GPIOHandler::RequestLineInput() called but chip is not initialized.");
         }
+        backend->RequestInput(line, consumer);
     }
 
-    void GPIOHandler::RequestLineInput(gpiod_line *line,
+    void GPIOHandler::RequestLineEvents(unsigned int line,
                                         const std::string &consumer)
     {
-        if (!initialized || !chip) {
-            throw std::runtime_error("GPIOHandler::RequestLineInput() called but chip is not initialized.");
+        if (!initialized || !backend) {
+            throw std::runtime_error("GPIOHandler::RequestLineEvents() called but chip is not initialized.");
         }
-        if (!line) {
-            throw std::runtime_error("GPIOHandler::RequestLineInput() called with null line pointer.");
+        backend->RequestEvents(line, consumer);
+    }
+
+    void GPIOHandler::RequestLinesOutput(const std::vector<unsigned int> &lines,
+                                         const std::string &consumer,
+                                         const std::vector<int> &defaultVals)
+    {
+        if (!initialized || !backend) {
+            throw std::runtime_error("GPIOHandler::RequestLinesOutput() called but chip is not initialized.");
+        }
+        backend->RequestOutputs(lines, consumer, defaultVals);
+    }
+
+    void GPIOHandler::RequestLinesInput(const std::vector<unsigned int> &lines,
+                                        const std::string &consumer)
+    {
+        if (!initialized || !backend) {
+            throw std::runtime_error("GPIOHandler::RequestLinesInput() called but chip is not initialized.");
         }
+        backend->RequestInputs(lines, consumer);
+    }
 
-        if (gpiod_line_request_input(line, consumer.c_str()) < 0) {
-            throw std::runtime_error("Failed to request line as Input. Consumer: " + consumer);
+    void GPIOHandler::RequestLinesEvents(const std::vector<unsigned int> &lines,
+                                         const std::string &consumer)
+    {
+        if (!initialized || !backend) {
+            throw std::runtime_error("GPIOHandler::RequestLinesEvents() called but chip is not initialized.");
+        }
+        // The kernel gives every event line its own fd, there is nothing to gain from one request
+        for (unsigned int line : lines) {
+            backend->RequestEvents(line, consumer);
         }
     }
 
     /**
-     * @brief Releases a gpiod_line and sets it to nullptr.
+     * @brief Releases a line, does nothing when uninitialized.
      */
-    void GPIOHandler::ReleaseLine(gpiod_line *&line)
+    void GPIOHandler::ReleaseLine(unsigned int line)
+    {
+        if (initialized && backend) {
+            backend->Release(line);
+        }
+    }
+
+    int GPIOHandler::GetValue(unsigned int line)
+    {
+        return initialized && backend ? backend->GetValue(line) : -1;
+    }
+
+    int GPIOHandler::SetValue(unsigned int line, int value)
+    {
+        return initialized && backend ? backend->SetValue(line, value) : -1;
+    }
+
+    int GPIOHandler::SetValues(const std::vector<unsigned int> &lines, const std::vector<int> &values)
     {
-        if (line) {
-            gpiod_line_release(line);
-            line = nullptr;
+        return initialized && backend ? backend->SetValues(lines, values) : -1;
+    }
+
+    void GPIOHandler::Watch(unsigned int line, GpioEventLoop::Callback callback)
+    {
+        if (!initialized || !eventLoop) {
+            throw std::runtime_error("GPIOHandler::Watch() called but chip is not initialized.");
+        }
+        eventLoop->Watch(line, std::move(callback));
+    }
+
+    void GPIOHandler::Unwatch(unsigned int line)
+    {
+        if (initialized && eventLoop) {
+            eventLoop->Unwatch(line);
         }
     }
 
-    void GPIOHandler::WaitForValue(gpiod_line *line, int value, std::atomic<bool>& cycle)
+    GpioEventLoop::SamplerId GPIOHandler::Sample(std::chrono::nanoseconds period, std::function<void()> sampler)
     {
-        while (gpiod_line_get_value(line)!=value && cycle.load())
-        {
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        if (!initialized || !eventLoop) {
+            throw std::runtime_error("GPIOHandler::Sample() called but chip is not initialized.");
         }
+        return eventLoop->Sample(period, std::move(sampler));
+    }
+
+    void GPIOHandler::Unsample(GpioEventLoop::SamplerId id)
+    {
+        if (initialized && eventLoop) {
+            eventLoop->Unsample(id);
+        }
+    }
+
+    uint64_t GPIOHandler::DispatchedEvents()
+    {
+        return initialized && eventLoop ? eventLoop->Dispatched() : 0;
     }
-}
\ No newline at end of file
+}
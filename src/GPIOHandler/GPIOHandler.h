@@ -2,24 +2,40 @@
 
 #include <string>
 #include <atomic>
-
-// Forward declarations to avoid pulling in <gpiod.h> here
-struct gpiod_chip;
-struct gpiod_line;
+#include <memory>
+#include <vector>
+#include "GpioBackend.h"
+#include "GpioEventLoop.h"
 
 namespace DebuggerInfrastructure
 {
     /**
-     * @brief A static helper class that provides basic GPIO handling via libgpiod.
+     * @brief Where the GPIO lines and the servo PWM come from, the "hardware" config.
+     */
+    struct HardwareSettings
+    {
+        bool simulated = false;                             ///< "backend": "gpiod" or "simulated"
+        std::string chipName = "gpiochip0";
+        std::string pwmRoot = "/sys/class/pwm";
+        std::string simulationRoot = "/tmp/DebuggerInfrastructure-sim";   ///< Fake PWM tree when simulated.
+        std::vector<unsigned int> pullUps = {22};           ///< Simulated inputs idling high (the emergency button).
+        double servoMaxVelocity = 600.0;                    ///< deg/s of the simulated servo
+        double servoTimeConstantMs = 25.0;                  ///< first-order lag of the simulated servo
+        std::string journalPath = "state.journal";          ///< StateJournal of the actuator and lock state.
+    };
+
+    /**
+     * @brief A static helper class that provides basic GPIO handling over a GpioBackend.
      *
-     * This version stores a static pointer to a gpiod_chip, created during
-     * Initialize() and released by Dispose(). Other methods access that static pointer.
+     * The backend is created during Initialize() and released by Dispose(): libgpiod on the
+     * device, or a SimulatedGpioChip. Lines are addressed by their offset on the chip.
+     * Edges of every watched input are delivered by one GpioEventLoop, see @ref Watch().
      */
     class GPIOHandler
     {
     public:
         /**
-         * @brief Initializes the GPIOHandler by opening a chip with the given name.
+         * @brief Initializes the GPIOHandler by opening a chip with the given name through libgpiod.
          *        May be called only once; subsequent calls with the same chip name do nothing.
          *        If a different name is passed, it throws std::runtime_error.
          * @param chipName The name of the GPIO chip, e.g. "gpiochip0".
@@ -27,42 +43,116 @@ namespace DebuggerInfrastructure
         static void Initialize(const std::string &chipName);
 
         /**
-         * @brief Closes the opened GPIO chip and resets the internal state.
+         * @brief Initializes the GPIOHandler with the given backend, e.g. a SimulatedGpioChip.
+         */
+        static void Initialize(std::unique_ptr<GpioBackend> backend);
+
+        /**
+         * @brief Initializes the backend selected by the settings.
+         */
+        static void Initialize(const HardwareSettings &settings);
+
+        /**
+         * @brief Closes the backend and resets the internal state.
          *        Safe to call multiple times; calling it when uninitialized does nothing.
          */
         static void Dispose();
 
         /**
-         * @brief Retrieves a GPIO line from the internally stored gpiod_chip.
-         * @param lineOffset The GPIO line offset (pin).
-         * @return A pointer to the requested gpiod_line (throws std::runtime_error on failure).
+         * @brief The backend in use, throws std::runtime_error when uninitialized.
          */
-        static gpiod_line* GetLine(unsigned int lineOffset);
+        static GpioBackend& Backend();
 
         /**
-         * @brief Requests the specified gpiod_line as output with an initial value.
-         * @param line        The gpiod_line pointer (must not be null).
+         * @brief Requests the line as output with an initial value.
+         * @param line        The GPIO line offset (pin).
          * @param consumer    A name for the consumer (e.g., "SERVO_gpio").
          * @param defaultVal  The initial GPIO output value (0 = LOW, 1 = HIGH).
          * @throws std::runtime_error on failure.
          */
-        static void RequestLineOutput(gpiod_line *line, const std::string &consumer, int defaultVal = 0);
+        static void RequestLineOutput(unsigned int line, const std::string &consumer, int defaultVal = 0);
 
         /**
-         * @brief Requests the specified gpiod_line as input.
-         * @param line        The gpiod_line pointer (must not be null).
+         * @brief Requests the line as input.
+         * @param line        The GPIO line offset (pin).
          * @param consumer    A name for the consumer (e.g., "SERVO_gpio").
          * @throws std::runtime_error on failure.
          */
-        static void RequestLineInput(gpiod_line *line, const std::string &consumer);
+        static void RequestLineInput(unsigned int line, const std::string &consumer);
+
+        /**
+         * @brief Requests the line as input reporting both edges, see @ref Watch().
+         * @throws std::runtime_error on failure.
+         */
+        static void RequestLineEvents(unsigned int line, const std::string &consumer);
+
+        /**
+         * @brief Requests the lines as outputs in one request, all or nothing.
+         *        @ref SetValues() writes them with one call and releasing one line releases all of them.
+         * @param defaultVals One initial value per line.
+         * @throws std::runtime_error on failure.
+         */
+        static void RequestLinesOutput(const std::vector<unsigned int> &lines, const std::string &consumer,
+                                       const std::vector<int> &defaultVals);
+
+        /**
+         * @brief Requests the lines as inputs in one request, all or nothing.
+         * @throws std::runtime_error on failure.
+         */
+        static void RequestLinesInput(const std::vector<unsigned int> &lines, const std::string &consumer);
+
+        /**
+         * @brief Requests each line as input reporting both edges. Lines requested before a failure stay requested.
+         * @throws std::runtime_error on failure.
+         */
+        static void RequestLinesEvents(const std::vector<unsigned int> &lines, const std::string &consumer);
 
         /**
-         * @brief Releases a gpiod_line (sets it to nullptr afterwards).
-         * @param line Reference to the pointer to gpiod_line. After this call, line becomes nullptr.
+         * @brief Releases a requested line.
          */
-        static void ReleaseLine(gpiod_line *&line);
-        
-        static void WaitForValue(gpiod_line *line, int value, std::atomic<bool>& cycle);
+        static void ReleaseLine(unsigned int line);
+
+        /**
+         * @brief Value of a requested line, -1 on error.
+         */
+        static int GetValue(unsigned int line);
+
+        /**
+         * @brief Sets a requested output line, -1 on error.
+         */
+        static int SetValue(unsigned int line, int value);
+
+        /**
+         * @brief Sets requested output lines, one write per request they belong to. -1 on error.
+         */
+        static int SetValues(const std::vector<unsigned int> &lines, const std::vector<int> &values);
+
+        /**
+         * @brief Calls the callback on the event loop thread for every edge of a line requested for events.
+         * @throws std::runtime_error if uninitialized, the line is not requested for events or already watched.
+         */
+        static void Watch(unsigned int line, GpioEventLoop::Callback callback);
+
+        /**
+         * @brief Stops the callbacks of the line, see @ref GpioEventLoop::Unwatch(). Call before releasing the line.
+         */
+        static void Unwatch(unsigned int line);
+
+        /**
+         * @brief Calls the sampler on the event loop thread every period, see @ref GpioEventLoop::Sample().
+         * @throws std::runtime_error if uninitialized or the timer cannot be created.
+         */
+        static GpioEventLoop::SamplerId Sample(std::chrono::nanoseconds period, std::function<void()> sampler);
+
+        /**
+         * @brief Stops a sampler, see @ref GpioEventLoop::Unsample().
+         */
+        static void Unsample(GpioEventLoop::SamplerId id);
+
+        /**
+         * @brief Edges the event loop has delivered and its callbacks have returned from so far.
+         */
+        static uint64_t DispatchedEvents();
 
     private:
         // Delete all constructors and operators to enforce static-only usage.
@@ -72,12 +162,17 @@ namespace DebuggerInfrastructure
         GPIOHandler& operator=(const GPIOHandler&) = delete;
 
         /**
-         * @brief A static pointer to the opened gpiod_chip.
+         * @brief The backend created in Initialize().
+         */
+        static std::unique_ptr<GpioBackend> backend;
+
+        /**
+         * @brief Delivers the edges of the watched lines, created with the backend.
          */
-        static gpiod_chip *chip;
+        static std::unique_ptr<GpioEventLoop> eventLoop;
 
         /**
-         * @brief Whether the static chip has been successfully initialized.
+         * @brief Whether the backend has been successfully initialized.
          */
         static bool initialized;
 
@@ -86,4 +181,4 @@ namespace DebuggerInfrastructure
          */
         static std::string chipName;
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace DebuggerInfrastructure
+{
+    struct GpioEvent
+    {
+        bool rising = false;
+        int64_t timestampNs = 0;    ///< CLOCK_MONOTONIC, taken by the kernel (or the simulated chip) at the edge
+    };
+
+    /**
+     * @brief One GPIO chip as seen by GPIOHandler: lines are addressed by their offset.
+     *
+     * Implemented by LibgpiodBackend for the real chip and by SimulatedGpioChip for development
+     * machines and CI, where there is no gpiochip. Value calls follow libgpiod: -1 on error.
+     *
+     * Lines requested together by RequestOutputs or RequestInputs form one request, as in the kernel:
+     * SetValues writes each request with a single call, and releasing one of its lines releases all of them.
+     */
+    class GpioBackend
+    {
+    public:
+        virtual ~GpioBackend() = default;
+
+        virtual std::string Name() const = 0;
+        // The requests throw std::runtime_error when the line cannot be requested
+        virtual void RequestOutput(unsigned int line, const std::string& consumer, int defaultVal) = 0;
+        virtual void RequestInput(unsigned int line, const std::string& consumer) = 0;
+        // All or nothing, defaults holds one value per line
+        virtual void RequestOutputs(const std::vector<unsigned int>& lines, const std::string& consumer,
+                                    const std::vector<int>& defaults) = 0;
+        virtual void RequestInputs(const std::vector<unsigned int>& lines, const std::string& consumer) = 0;
+        // Input reporting both edges, the value can still be read
+        virtual void RequestEvents(unsigned int line, const std::string& consumer) = 0;
+        virtual void Release(unsigned int line) = 0;
+        virtual int GetValue(unsigned int line) = 0;
+        virtual int SetValue(unsigned int line, int value) = 0;
+        // One write per request the lines belong to, -1 if any of them failed
+        virtual int SetValues(const std::vector<unsigned int>& lines, const std::vector<int>& values) = 0;
+        // Readable when an event is queued, -1 if the line was not requested for events
+        virtual int EventFd(unsigned int line) = 0;
+        // Takes the oldest queued event, false if there is none
+        virtual bool ReadEvent(unsigned int line, GpioEvent& event) = 0;
+    };
+}
@@ -0,0 +1,228 @@
+#include "GpioEventLoop.h"
+#include "../Logger/Logger.h"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+namespace DebuggerInfrastructure
+{
+    namespace
+    {
+        // epoll data of the wake-up eventfd, never a line offset
+        constexpr uint64_t wakeTag = ~uint64_t(0);
+        // Sampler tags have this bit set, line offsets never reach it
+        constexpr uint64_t samplerTag = uint64_t(1) << 32;
+        constexpr int maxEventsPerWait = 16;
+    }
+
+    GpioEventLoop::GpioEventLoop(GpioBackend& backend)
+        : m_backend(backend)
+        , m_epollFd(epoll_create1(EPOLL_CLOEXEC))
+        , m_wakeFd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK))
+        , m_nextSampler(0)
+        , m_running(true)
+        , m_dispatched(0)
+    {
+        if (m_epollFd < 0 || m_wakeFd < 0) {
+            if (m_epollFd >= 0) close(m_epollFd);
+            if (m_wakeFd >= 0) close(m_wakeFd);
+            throw std::runtime_error(std::string("GpioEventLoop could not create its fds: ") + strerror(errno));
+        }
+        epoll_event wake{};
+        wake.events = EPOLLIN;
+        wake.data.u64 = wakeTag;
+        if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_wakeFd, &wake) < 0) {
+            close(m_epollFd);
+            close(m_wakeFd);
+            throw std::runtime_error(std::string("GpioEventLoop could not watch its wake-up fd: ") + strerror(errno));
+        }
+        m_thread = std::thread(&GpioEventLoop::ThreadFunc, this);
+    }
+
+    GpioEventLoop::~GpioEventLoop()
+    {
+        m_running.store(false);
+        Wake();
+        if (m_thread.joinable()) m_thread.join();
+        for (auto& [id, sampler] : m_samplers) close(sampler.timerFd);
+        close(m_epollFd);
+        close(m_wakeFd);
+    }
+
+    void GpioEventLoop::Watch(unsigned int line, Callback callback)
+    {
+        int fd = m_backend.EventFd(line);
+        if (fd < 0) {
+            throw std::runtime_error("GPIO line " + std::to_string(line) + " is not requested for events");
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_callbacks.contains(line)) {
+            throw std::runtime_error("GPIO line " + std::to_string(line) + " is already watched");
+        }
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = line;
+        if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            throw std::runtime_error("Could not watch GPIO line " + std::to_string(line) + ": " + strerror(errno));
+        }
+        m_callbacks[line] = std::make_shared<Callback>(std::move(callback));
+        m_fds[line] = fd;
+    }
+
+    void GpioEventLoop::Unwatch(unsigned int line)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        auto fd = m_fds.find(line);
+        if (fd == m_fds.end()) return;
+        epoll_ctl(m_epollFd, EPOLL_CTL_DEL, fd->second, nullptr);
+        m_fds.erase(fd);
+        m_callbacks.erase(line);
+        WaitIdle(lock, line);
+    }
+
+    GpioEventLoop::SamplerId GpioEventLoop::Sample(std::chrono::nanoseconds period, std::function<void()> sampler)
+    {
+        if (period.count() <= 0) {
+            throw std::runtime_error("GpioEventLoop sampler period must be positive");
+        }
+        int fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+        if (fd < 0) {
+            throw std::runtime_error(std::string("GpioEventLoop could not create a sampler timer: ") + strerror(errno));
+        }
+        itimerspec spec{};
+        spec.it_interval.tv_sec = period.count() / 1000000000;
+        spec.it_interval.tv_nsec = period.count() % 1000000000;
+        spec.it_value = spec.it_interval;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        SamplerId id = m_nextSampler++;
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = samplerTag | id;
+        if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event) < 0 || timerfd_settime(fd, 0, &spec, nullptr) < 0) {
+            std::string error = strerror(errno);
+            epoll_ctl(m_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+            close(fd);
+            throw std::runtime_error("GpioEventLoop could not start a sampler: " + error);
+        }
+        m_samplers[id] = Sampler{fd, std::make_shared<std::function<void()>>(std::move(sampler))};
+        return id;
+    }
+
+    void GpioEventLoop::Unsample(SamplerId id)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        auto it = m_samplers.find(id);
+        if (it == m_samplers.end()) return;
+        epoll_ctl(m_epollFd, EPOLL_CTL_DEL, it->second.timerFd, nullptr);
+        close(it->second.timerFd);
+        m_samplers.erase(it);
+        WaitIdle(lock, samplerTag | id);
+    }
+
+    void GpioEventLoop::WaitIdle(std::unique_lock<std::mutex>& lock, uint64_t tag)
+    {
+        // On the loop thread the callback asking is the one running
+        if (std::this_thread::get_id() != m_thread.get_id()) {
+            m_idle.wait(lock, [&] { return m_dispatching != tag; });
+        }
+    }
+
+    uint64_t GpioEventLoop::Dispatched() const
+    {
+        return m_dispatched.load();
+    }
+
+    void GpioEventLoop::Wake()
+    {
+        uint64_t one = 1;
+        if (write(m_wakeFd, &one, sizeof(one)) != sizeof(one)) {
+            Logger::Warning("GpioEventLoop could not wake its thread");
+        }
+    }
+
+    void GpioEventLoop::ThreadFunc()
+    {
+        epoll_event ready[maxEventsPerWait];
+        while (m_running.load()) {
+            int count = epoll_wait(m_epollFd, ready, maxEventsPerWait, -1);
+            if (count < 0) {
+                if (errno == EINTR) continue;
+                Logger::Critical("GpioEventLoop stopped, epoll_wait failed: {}", strerror(errno));
+                return;
+            }
+            for (int i = 0; i < count && m_running.load(); i++) {
+                if (ready[i].data.u64 == wakeTag) {
+                    uint64_t value;
+                    if (read(m_wakeFd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+                        Logger::Warning("GpioEventLoop could not drain its wake-up fd");
+                    }
+                    continue;
+                }
+                if (ready[i].data.u64 & samplerTag) {
+                    RunSampler(static_cast<SamplerId>(ready[i].data.u64 & ~samplerTag));
+                    continue;
+                }
+
+                unsigned int line = static_cast<unsigned int>(ready[i].data.u64);
+                std::shared_ptr<Callback> callback;
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    auto it = m_callbacks.find(line);
+                    // Unwatched after epoll_wait returned
+                    if (it == m_callbacks.end()) continue;
+                    callback = it->second;
+                    m_dispatching = line;
+                }
+
+                // One event per wake-up, the fd stays readable while more are queued (level-triggered),
+                // so a read never blocks
+                GpioEvent event;
+                if (m_backend.ReadEvent(line, event)) {
+                    try {
+                        (*callback)(line, event);
+                    } catch (const std::exception& ex) {
+                        Logger::Error("GPIO line {} callback failed: {}", line, ex.what());
+                    }
+                    // Counted once handled, a caller waiting for the count sees the callback's effects
+                    m_dispatched.fetch_add(1, std::memory_order_release);
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_dispatching.reset();
+                }
+                m_idle.notify_all();
+            }
+        }
+    }
+
+    void GpioEventLoop::RunSampler(SamplerId id)
+    {
+        std::shared_ptr<std::function<void()>> callback;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_samplers.find(id);
+            if (it == m_samplers.end()) return;
+            // Expirations missed while the loop was busy are dropped, the sampler runs once
+            uint64_t expirations;
+            if (read(it->second.timerFd, &expirations, sizeof(expirations)) < 0) return;
+            callback = it->second.callback;
+            m_dispatching = samplerTag | id;
+        }
+        try {
+            (*callback)();
+        } catch (const std::exception& ex) {
+            Logger::Error("GPIO sampler {} failed: {}", id, ex.what());
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_dispatching.reset();
+        }
+        m_idle.notify_all();
+    }
+}
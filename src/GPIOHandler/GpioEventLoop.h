@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include "GpioBackend.h"
+
+namespace DebuggerInfrastructure
+{
+    /**
+     * @brief One thread that waits on the event fds of every watched line with epoll and hands each edge
+     *        to the callback registered for its line.
+     *
+     * Another button, limit switch or sensor is one more fd in the epoll set, not one more thread.
+     * Inputs without edges (an ADC, an encoder) are read by samplers, a timerfd each in the same set.
+     * Callbacks run on the loop thread one at a time and should only record the edge or hand it over,
+     * a slow callback delays the edges of every other line.
+     */
+    class GpioEventLoop
+    {
+    public:
+        using Callback = std::function<void(unsigned int line, const GpioEvent& event)>;
+        using SamplerId = uint32_t;
+
+        explicit GpioEventLoop(GpioBackend& backend);
+        // Stops and joins the loop thread
+        ~GpioEventLoop();
+
+        GpioEventLoop(const GpioEventLoop&) = delete;
+        GpioEventLoop& operator=(const GpioEventLoop&) = delete;
+
+        /**
+         * @brief Delivers the edges of a line requested for events. Throws std::runtime_error if the line
+         *        has no event fd or is already watched.
+         */
+        void Watch(unsigned int line, Callback callback);
+
+        /**
+         * @brief Stops the delivery. When called from another thread it returns only after a running
+         *        callback of the line has finished, so the callback's state may be torn down afterwards.
+         */
+        void Unwatch(unsigned int line);
+
+        /**
+         * @brief Calls the sampler on the loop thread every period, until @ref Unsample().
+         *        Throws std::runtime_error if the timer cannot be created.
+         */
+        SamplerId Sample(std::chrono::nanoseconds period, std::function<void()> sampler);
+
+        /**
+         * @brief Stops the sampler, with the same guarantee as @ref Unwatch().
+         */
+        void Unsample(SamplerId id);
+
+        uint64_t Dispatched() const;
+
+    private:
+        struct Sampler
+        {
+            int timerFd;
+            std::shared_ptr<std::function<void()>> callback;
+        };
+
+        void ThreadFunc();
+        void Wake();
+        void RunSampler(SamplerId id);
+        // Caller holds m_mutex
+        void WaitIdle(std::unique_lock<std::mutex>& lock, uint64_t tag);
+
+        GpioBackend& m_backend;
+        int m_epollFd;
+        int m_wakeFd;
+        std::mutex m_mutex;
+        std::condition_variable m_idle;
+        std::unordered_map<unsigned int, std::shared_ptr<Callback>> m_callbacks;
+        std::unordered_map<unsigned int, int> m_fds;
+        std::unordered_map<SamplerId, Sampler> m_samplers;
+        SamplerId m_nextSampler;
+        std::optional<uint64_t> m_dispatching;         ///< epoll tag whose callback is running
+        std::atomic<bool> m_running;
+        std::atomic<uint64_t> m_dispatched;
+        std::thread m_thread;
+    };
+}
@@ -0,0 +1,243 @@
+#include "LibgpiodBackend.h"
+#include <gpiod.h>
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+#include <time.h>
+
+namespace DebuggerInfrastructure
+{
+    LibgpiodBackend::LibgpiodBackend(const std::string& chipName)
+        : m_chipName(chipName)
+        , m_chip(gpiod_chip_open_by_name(chipName.c_str()))
+    {
+        if (!m_chip) {
+            throw std::runtime_error("Failed to open GPIO chip: " + chipName);
+        }
+    }
+
+    LibgpiodBackend::~LibgpiodBackend()
+    {
+        for (auto& [offset, request] : m_lines) {
+            // Every line of a request is in the map, release each line once
+            gpiod_line_release(request->lines[IndexOf(*request, offset)]);
+        }
+        m_lines.clear();
+        gpiod_chip_close(m_chip);
+    }
+
+    std::string LibgpiodBackend::Name() const
+    {
+        return m_chipName;
+    }
+
+    gpiod_line* LibgpiodBackend::GetLine(unsigned int line)
+    {
+        gpiod_line* gpioLine = gpiod_chip_get_line(m_chip, line);
+        if (!gpioLine) {
+            throw std::runtime_error("Failed to get GPIO line " + std::to_string(line));
+        }
+        return gpioLine;
+    }
+
+    void LibgpiodBackend::CheckFree(const std::vector<unsigned int>& lines)
+    {
+        for (unsigned int line : lines) {
+            if (m_lines.contains(line)) {
+                throw std::runtime_error("GPIO line " + std::to_string(line) + " is already requested");
+            }
+        }
+    }
+
+    void LibgpiodBackend::Add(std::shared_ptr<Request> request)
+    {
+        for (unsigned int offset : request->offsets) {
+            m_lines[offset] = request;
+        }
+    }
+
+    std::shared_ptr<LibgpiodBackend::Request> LibgpiodBackend::Requested(unsigned int line)
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        auto it = m_lines.find(line);
+        return it == m_lines.end() ? nullptr : it->second;
+    }
+
+    size_t LibgpiodBackend::IndexOf(const Request& request, unsigned int line)
+    {
+        for (size_t i = 0; i < request.offsets.size(); i++) {
+            if (request.offsets[i] == line) return i;
+        }
+        throw std::runtime_error("GPIO line " + std::to_string(line) + " is not part of its request");
+    }
+
+    void LibgpiodBackend::RequestOutput(unsigned int line, const std::string& consumer, int defaultVal)
+    {
+        RequestOutputs({line}, consumer, {defaultVal});
+    }
+
+    void LibgpiodBackend::RequestInput(unsigned int line, const std::string& consumer)
+    {
+        RequestInputs({line}, consumer);
+    }
+
+    void LibgpiodBackend::RequestOutputs(const std::vector<unsigned int>& lines, const std::string& consumer,
+                                         const std::vector<int>& defaults)
+    {
+        if (lines.empty() || lines.size() != defaults.size() || lines.size() > GPIOD_LINE_BULK_MAX_LINES) {
+            throw std::runtime_error("Invalid bulk output request. Consumer: " + consumer);
+        }
+        std::lock_guard<std::mutex> guard(m_mutex);
+        CheckFree(lines);
+        auto request = std::make_shared<Request>();
+        gpiod_line_bulk bulk;
+        gpiod_line_bulk_init(&bulk);
+        for (unsigned int line : lines) {
+            gpiod_line* gpioLine = GetLine(line);
+            gpiod_line_bulk_add(&bulk, gpioLine);
+            request->offsets.push_back(line);
+            request->lines.push_back(gpioLine);
+        }
+        if (gpiod_line_request_bulk_output(&bulk, consumer.c_str(), defaults.data()) < 0) {
+            throw std::runtime_error("Failed to request lines as output. Consumer: " + consumer);
+        }
+        request->values = defaults;
+        Add(std::move(request));
+    }
+
+    void LibgpiodBackend::RequestInputs(const std::vector<unsigned int>& lines, const std::string& consumer)
+    {
+        if (lines.empty() || lines.size() > GPIOD_LINE_BULK_MAX_LINES) {
+            throw std::runtime_error("Invalid bulk input request. Consumer: " + consumer);
+        }
+        std::lock_guard<std::mutex> guard(m_mutex);
+        CheckFree(lines);
+        auto request = std::make_shared<Request>();
+        gpiod_line_bulk bulk;
+        gpiod_line_bulk_init(&bulk);
+        for (unsigned int line : lines) {
+            gpiod_line* gpioLine = GetLine(line);
+            gpiod_line_bulk_add(&bulk, gpioLine);
+            request->offsets.push_back(line);
+            request->lines.push_back(gpioLine);
+        }
+        if (gpiod_line_request_bulk_input(&bulk, consumer.c_str()) < 0) {
+            throw std::runtime_error("Failed to request lines as Input. Consumer: " + consumer);
+        }
+        request->values.assign(lines.size(), 0);
+        Add(std::move(request));
+    }
+
+    void LibgpiodBackend::RequestEvents(unsigned int line, const std::string& consumer)
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        CheckFree({line});
+        gpiod_line* gpioLine = GetLine(line);
+        // Event lines get a file descriptor each, also when requested in bulk, so they stay single-line requests
+        if (gpiod_line_request_both_edges_events(gpioLine, consumer.c_str()) < 0) {
+            throw std::runtime_error("Failed to request line for edge events. Consumer: " + consumer);
+        }
+        Add(std::make_shared<Request>(Request{{line}, {gpioLine}, {0}}));
+    }
+
+    void LibgpiodBackend::Release(unsigned int line)
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        auto it = m_lines.find(line);
+        if (it == m_lines.end()) return;
+        std::shared_ptr<Request> request = it->second;
+        for (size_t i = 0; i < request->offsets.size(); i++) {
+            gpiod_line_release(request->lines[i]);
+            m_lines.erase(request->offsets[i]);
+        }
+    }
+
+    int LibgpiodBackend::GetValue(unsigned int line)
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        auto it = m_lines.find(line);
+        if (it == m_lines.end()) return -1;
+        Request& request = *it->second;
+        if (request.lines.size() == 1) return gpiod_line_get_value(request.lines[0]);
+
+        gpiod_line_bulk bulk;
+        gpiod_line_bulk_init(&bulk);
+        for (gpiod_line* gpioLine : request.lines) gpiod_line_bulk_add(&bulk, gpioLine);
+        std::vector<int> values(request.lines.size());
+        if (gpiod_line_get_value_bulk(&bulk, values.data()) < 0) return -1;
+        return values[IndexOf(request, line)];
+    }
+
+    int LibgpiodBackend::SetValue(unsigned int line, int value)
+    {
+        return SetValues({line}, {value});
+    }
+
+    int LibgpiodBackend::SetValues(const std::vector<unsigned int>& lines, const std::vector<int>& values)
+    {
+        if (lines.size() != values.size()) return -1;
+        std::lock_guard<std::mutex> guard(m_mutex);
+        // Group by request, in the order the requests first appear
+        std::vector<std::pair<Request*, std::vector<int>>> writes;
+        for (size_t i = 0; i < lines.size(); i++) {
+            auto it = m_lines.find(lines[i]);
+            if (it == m_lines.end()) return -1;
+            Request* request = it->second.get();
+            auto write = std::find_if(writes.begin(), writes.end(), [&](const auto& w) { return w.first == request; });
+            if (write == writes.end()) {
+                writes.emplace_back(request, request->values);
+                write = writes.end() - 1;
+            }
+            write->second[IndexOf(*request, lines[i])] = values[i] ? 1 : 0;
+        }
+
+        int result = 0;
+        for (auto& [request, requestValues] : writes) {
+            std::swap(request->values, requestValues);
+            if (Write(*request) < 0) {
+                // Keep the cache at what the lines hold
+                std::swap(request->values, requestValues);
+                result = -1;
+            }
+        }
+        return result;
+    }
+
+    int LibgpiodBackend::Write(Request& request)
+    {
+        if (request.lines.size() == 1) return gpiod_line_set_value(request.lines[0], request.values[0]);
+        gpiod_line_bulk bulk;
+        gpiod_line_bulk_init(&bulk);
+        for (gpiod_line* gpioLine : request.lines) gpiod_line_bulk_add(&bulk, gpioLine);
+        return gpiod_line_set_value_bulk(&bulk, request.values.data());
+    }
+
+    int LibgpiodBackend::EventFd(unsigned int line)
+    {
+        std::shared_ptr<Request> request = Requested(line);
+        return request ? gpiod_line_event_get_fd(request->lines[0]) : -1;
+    }
+
+    bool LibgpiodBackend::ReadEvent(unsigned int line, GpioEvent& event)
+    {
+        std::shared_ptr<Request> request = Requested(line);
+        gpiod_line_event gpioEvent;
+        // Blocks when nothing is queued, callers wait for the event fd first
+        if (!request || gpiod_line_event_read(request->lines[0], &gpioEvent) < 0) {
+            return false;
+        }
+        event.rising = gpioEvent.event_type == GPIOD_LINE_EVENT_RISING_EDGE;
+        event.timestampNs = int64_t(gpioEvent.ts.tv_sec) * 1000000000 + gpioEvent.ts.tv_nsec;
+
+        // Kernels before 5.7 stamp v1 events with CLOCK_REALTIME, move those onto the monotonic clock
+        timespec monotonic, realtime;
+        clock_gettime(CLOCK_MONOTONIC, &monotonic);
+        clock_gettime(CLOCK_REALTIME, &realtime);
+        int64_t monotonicNs = int64_t(monotonic.tv_sec) * 1000000000 + monotonic.tv_nsec;
+        int64_t realtimeNs = int64_t(realtime.tv_sec) * 1000000000 + realtime.tv_nsec;
+        if (std::llabs(event.timestampNs - realtimeNs) < std::llabs(event.timestampNs - monotonicNs)) {
+            event.timestampNs += monotonicNs - realtimeNs;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "GpioBackend.h"
+
+// Forward declarations to avoid pulling in <gpiod.h> here
+struct gpiod_chip;
+struct gpiod_line;
+
+namespace DebuggerInfrastructure
+{
+    /**
+     * @brief GpioBackend on a real chip through libgpiod (v1 API).
+     *
+     * A v1 request shares one kernel handle between its lines, and the value ioctls address the
+     * handle's lines by position. Single-line gpiod calls on a line of a bulk request would hit the
+     * request's first line, so every value call goes through the whole request of the line.
+     */
+    class LibgpiodBackend : public GpioBackend
+    {
+    public:
+        // Throws std::runtime_error if the chip cannot be opened
+        explicit LibgpiodBackend(const std::string& chipName);
+        ~LibgpiodBackend() override;
+
+        std::string Name() const override;
+        void RequestOutput(unsigned int line, const std::string& consumer, int defaultVal) override;
+        void RequestInput(unsigned int line, const std::string& consumer) override;
+        void RequestOutputs(const std::vector<unsigned int>& lines, const std::string& consumer,
+                            const std::vector<int>& defaults) override;
+        void RequestInputs(const std::vector<unsigned int>& lines, const std::string& consumer) override;
+        void RequestEvents(unsigned int line, const std::string& consumer) override;
+        void Release(unsigned int line) override;
+        int GetValue(unsigned int line) override;
+        int SetValue(unsigned int line, int value) override;
+        int SetValues(const std::vector<unsigned int>& lines, const std::vector<int>& values) override;
+        int EventFd(unsigned int line) override;
+        bool ReadEvent(unsigned int line, GpioEvent& event) override;
+
+    private:
+        struct Request
+        {
+            std::vector<unsigned int> offsets;
+            std::vector<gpiod_line*> lines;
+            std::vector<int> values;            ///< Last written, a write sets every line of the request
+        };
+
+        gpiod_line* GetLine(unsigned int line);
+        // Throws if any of the lines is already requested, the caller holds m_mutex
+        void CheckFree(const std::vector<unsigned int>& lines);
+        void Add(std::shared_ptr<Request> request);
+        // Requested lines only, the value calls must not request implicitly
+        std::shared_ptr<Request> Requested(unsigned int line);
+        static size_t IndexOf(const Request& request, unsigned int line);
+        int Write(Request& request);
+
+        std::string m_chipName;
+        gpiod_chip* m_chip;
+        std::mutex m_mutex;
+        std::unordered_map<unsigned int, std::shared_ptr<Request>> m_lines;
+    };
+}
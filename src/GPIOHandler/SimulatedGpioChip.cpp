@@ -0,0 +1,248 @@
+#include "SimulatedGpioChip.h"
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace DebuggerInfrastructure
+{
+    SimulatedGpioChip::SimulatedGpioChip(std::vector<unsigned int> pullUps)
+        : m_running(true)
+    {
+        for (unsigned int line : pullUps) {
+            m_lines[line].value = 1;
+        }
+        m_thread = std::thread(&SimulatedGpioChip::ThreadFunc, this);
+    }
+
+    SimulatedGpioChip::~SimulatedGpioChip()
+    {
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            m_running = false;
+        }
+        m_cv.notify_all();
+        if (m_thread.joinable()) m_thread.join();
+        for (auto& [offset, line] : m_lines) {
+            if (line.eventFd >= 0) close(line.eventFd);
+        }
+    }
+
+    std::string SimulatedGpioChip::Name() const
+    {
+        return "simulated";
+    }
+
+    void SimulatedGpioChip::CheckFree(const std::vector<unsigned int>& lines, const std::string& what)
+    {
+        for (unsigned int line : lines) {
+            auto it = m_lines.find(line);
+            if (it != m_lines.end() && it->second.requested) {
+                throw std::runtime_error("Failed to request line " + std::to_string(line) + " " + what +
+                                         ", it is used by " + it->second.consumer);
+            }
+        }
+    }
+
+    void SimulatedGpioChip::RequestOutput(unsigned int line, const std::string& consumer, int defaultVal)
+    {
+        RequestOutputs({line}, consumer, {defaultVal});
+    }
+
+    void SimulatedGpioChip::RequestInput(unsigned int line, const std::string& consumer)
+    {
+        RequestInputs({line}, consumer);
+    }
+
+    void SimulatedGpioChip::RequestOutputs(const std::vector<unsigned int>& lines, const std::string& consumer,
+                                           const std::vector<int>& defaults)
+    {
+        if (lines.size() != defaults.size()) {
+            throw std::runtime_error("Every requested output line needs a default value. Consumer: " + consumer);
+        }
+        std::lock_guard<std::mutex> guard(m_mutex);
+        CheckFree(lines, "as output");
+        for (size_t i = 0; i < lines.size(); i++) {
+            Line& simLine = m_lines[lines[i]];
+            simLine.requested = true;
+            simLine.output = true;
+            simLine.consumer = consumer;
+            simLine.request = lines;
+            Set(simLine, defaults[i] ? 1 : 0);
+        }
+    }
+
+    void SimulatedGpioChip::RequestInputs(const std::vector<unsigned int>& lines, const std::string& consumer)
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        CheckFree(lines, "as Input");
+        for (unsigned int line : lines) {
+            Line& simLine = m_lines[line];
+            simLine.requested = true;
+            simLine.output = false;
+            simLine.consumer = consumer;
+            simLine.request = lines;
+        }
+    }
+
+    void SimulatedGpioChip::RequestEvents(unsigned int line, const std::string& consumer)
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        Line& simLine = m_lines[line];
+        if (simLine.requested) {
+            throw std::runtime_error("Failed to request line for edge events, it is used by " + simLine.consumer);
+        }
+        simLine.eventFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK | EFD_SEMAPHORE);
+        if (simLine.eventFd < 0) {
+            throw std::runtime_error("Failed to create the event fd of simulated line " + std::to_string(line));
+        }
+        simLine.requested = true;
+        simLine.output = false;
+        simLine.consumer = consumer;
+        simLine.request = {line};
+    }
+
+    void SimulatedGpioChip::Release(unsigned int line)
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        auto it = m_lines.find(line);
+        if (it == m_lines.end() || !it->second.requested) return;
+        // Like the kernel, the whole request goes
+        std::vector<unsigned int> request = it->second.request;
+        for (unsigned int offset : request) {
+            Line& simLine = m_lines[offset];
+            simLine.requested = false;
+            simLine.consumer.clear();
+            simLine.request.clear();
+            if (simLine.eventFd >= 0) close(simLine.eventFd);
+            simLine.eventFd = -1;
+            simLine.events.clear();
+        }
+    }
+
+    int SimulatedGpioChip::GetValue(unsigned int line)
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        auto it = m_lines.find(line);
+        if (it == m_lines.end() || !it->second.requested) return -1;
+        return it->second.value;
+    }
+
+    int SimulatedGpioChip::SetValue(unsigned int line, int value)
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        auto it = m_lines.find(line);
+        if (it == m_lines.end() || !it->second.requested || !it->second.output) return -1;
+        Set(it->second, value ? 1 : 0);
+        return 0;
+    }
+
+    int SimulatedGpioChip::SetValues(const std::vector<unsigned int>& lines, const std::vector<int>& values)
+    {
+        if (lines.size() != values.size()) return -1;
+        std::lock_guard<std::mutex> guard(m_mutex);
+        for (unsigned int line : lines) {
+            auto it = m_lines.find(line);
+            if (it == m_lines.end() || !it->second.requested || !it->second.output) return -1;
+        }
+        // Under one lock, no reader sees half of the write
+        for (size_t i = 0; i < lines.size(); i++) {
+            Set(m_lines[lines[i]], values[i] ? 1 : 0);
+        }
+        return 0;
+    }
+
+    int SimulatedGpioChip::EventFd(unsigned int line)
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        auto it = m_lines.find(line);
+        return it == m_lines.end() ? -1 : it->second.eventFd;
+    }
+
+    bool SimulatedGpioChip::ReadEvent(unsigned int line, GpioEvent& event)
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        auto it = m_lines.find(line);
+        if (it == m_lines.end() || it->second.events.empty()) return false;
+        uint64_t count;
+        if (read(it->second.eventFd, &count, sizeof(count)) != sizeof(count)) return false;
+        event = it->second.events.front();
+        it->second.events.pop_front();
+        return true;
+    }
+
+    void SimulatedGpioChip::Drive(unsigned int line, int value)
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        Set(m_lines[line], value ? 1 : 0);
+    }
+
+    void SimulatedGpioChip::Drive(unsigned int line, int value, int64_t timestampNs)
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        Set(m_lines[line], value ? 1 : 0, timestampNs);
+    }
+
+    void SimulatedGpioChip::Script(unsigned int line, std::vector<GpioStep> steps)
+    {
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            auto at = std::chrono::steady_clock::now();
+            for (const GpioStep& step : steps) {
+                at += step.delay;
+                m_pending.emplace(at, PendingStep{line, step.value ? 1 : 0});
+            }
+        }
+        m_cv.notify_all();
+    }
+
+    void SimulatedGpioChip::Press(unsigned int line, std::chrono::milliseconds hold)
+    {
+        Script(line, {GpioStep{std::chrono::milliseconds(0), 0}, GpioStep{hold, 1}});
+    }
+
+    std::vector<GpioTransition> SimulatedGpioChip::Transitions(unsigned int line)
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        auto it = m_lines.find(line);
+        if (it == m_lines.end()) return {};
+        return std::vector<GpioTransition>(it->second.transitions.begin(), it->second.transitions.end());
+    }
+
+    void SimulatedGpioChip::Set(Line& line, int value, std::optional<int64_t> timestampNs)
+    {
+        if (line.value == value) return;
+        line.value = value;
+        if (!timestampNs) {
+            timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            timestampNs = int64_t(now.tv_sec) * 1000000000 + now.tv_nsec;
+        }
+        // steady_clock is CLOCK_MONOTONIC
+        line.transitions.push_back(GpioTransition{std::chrono::steady_clock::time_point(std::chrono::nanoseconds(*timestampNs)), value});
+        if (line.transitions.size() > maxTransitions) line.transitions.pop_front();
+        if (line.eventFd >= 0) {
+            line.events.push_back(GpioEvent{value == 1, *timestampNs});
+            uint64_t one = 1;
+            if (write(line.eventFd, &one, sizeof(one)) != sizeof(one)) line.events.pop_back();
+        }
+    }
+
+    void SimulatedGpioChip::ThreadFunc()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (m_running) {
+            if (m_pending.empty()) {
+                m_cv.wait(lock);
+                continue;
+            }
+            auto next = m_pending.begin();
+            if (next->first > std::chrono::steady_clock::now()) {
+                m_cv.wait_until(lock, next->first);
+                continue;
+            }
+            Set(m_lines[next->second.line], next->second.value);
+            m_pending.erase(next);
+        }
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "GpioBackend.h"
+
+namespace DebuggerInfrastructure
+{
+    struct GpioStep
+    {
+        std::chrono::milliseconds delay;    ///< After the previous step of the same script.
+        int value;
+    };
+
+    struct GpioTransition
+    {
+        std::chrono::steady_clock::time_point time;
+        int value;
+    };
+
+    /**
+     * @brief In-memory GpioBackend for machines without a gpiochip.
+     *
+     * Inputs are driven from outside, directly through Drive or from a script played on the chip's own
+     * thread (e.g. an emergency button press). Every level change of every line is recorded with its time,
+     * so the reaction of the outputs to a scripted input can be measured.
+     */
+    class SimulatedGpioChip : public GpioBackend
+    {
+    public:
+        // Lines listed in pullUps idle high, like a button wired to ground
+        explicit SimulatedGpioChip(std::vector<unsigned int> pullUps = {});
+        ~SimulatedGpioChip() override;
+
+        std::string Name() const override;
+        void RequestOutput(unsigned int line, const std::string& consumer, int defaultVal) override;
+        void RequestInput(unsigned int line, const std::string& consumer) override;
+        void RequestOutputs(const std::vector<unsigned int>& lines, const std::string& consumer,
+                            const std::vector<int>& defaults) override;
+        void RequestInputs(const std::vector<unsigned int>& lines, const std::string& consumer) override;
+        void RequestEvents(unsigned int line, const std::string& consumer) override;
+        void Release(unsigned int line) override;
+        int GetValue(unsigned int line) override;
+        int SetValue(unsigned int line, int value) override;
+        int SetValues(const std::vector<unsigned int>& lines, const std::vector<int>& values) override;
+        int EventFd(unsigned int line) override;
+        bool ReadEvent(unsigned int line, GpioEvent& event) override;
+
+        /**
+         * @brief Sets the level of an input line, as the outside world would.
+         */
+        void Drive(unsigned int line, int value);
+
+        /**
+         * @brief Like @ref Drive(), with the CLOCK_MONOTONIC timestamp of the edge given, e.g. a virtual time.
+         */
+        void Drive(unsigned int line, int value, int64_t timestampNs);
+
+        /**
+         * @brief Plays the steps on the chip thread. Scripts of different lines run concurrently.
+         */
+        void Script(unsigned int line, std::vector<GpioStep> steps);
+
+        /**
+         * @brief Pulls the line low for the given time and releases it, an active-low button press.
+         */
+        void Press(unsigned int line, std::chrono::milliseconds hold);
+
+        /**
+         * @brief Recorded level changes of the line, oldest first, at most the last maxTransitions.
+         */
+        std::vector<GpioTransition> Transitions(unsigned int line);
+
+        static constexpr size_t maxTransitions = 256;
+
+    private:
+        struct Line
+        {
+            bool requested = false;
+            bool output = false;
+            int value = 0;
+            std::string consumer;
+            std::vector<unsigned int> request;  ///< Every line requested together with this one, itself included
+            std::deque<GpioTransition> transitions;
+            int eventFd = -1;                   ///< eventfd counting the queued events
+            std::deque<GpioEvent> events;
+        };
+
+        struct PendingStep
+        {
+            unsigned int line;
+            int value;
+        };
+
+        // Timestamps the edge now when timestampNs is empty
+        void Set(Line& line, int value, std::optional<int64_t> timestampNs = std::nullopt);
+        // Throws if any of the lines is already requested, the caller holds m_mutex
+        void CheckFree(const std::vector<unsigned int>& lines, const std::string& what);
+        void ThreadFunc();
+
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::map<unsigned int, Line> m_lines;
+        std::multimap<std::chrono::steady_clock::time_point, PendingStep> m_pending;
+        bool m_running;
+        std::thread m_thread;
+    };
+}
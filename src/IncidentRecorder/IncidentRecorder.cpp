@@ -0,0 +1,204 @@
+#include "IncidentRecorder.h"
+#include "../Logger/Logger.h"
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace DebuggerInfrastructure
+{
+    IncidentRecorderSettings                            IncidentRecorder::settings_;
+    IncidentRecorder::FrameSource                       IncidentRecorder::source_;
+    std::vector<IncidentRecorder::EncodedFrame>         IncidentRecorder::ring_;
+    size_t                                              IncidentRecorder::ringHead_ = 0;
+    size_t                                              IncidentRecorder::ringCount_ = 0;
+    std::unique_ptr<IncidentRecorder::Incident>         IncidentRecorder::collecting_;
+    std::deque<IncidentRecorder::Incident>              IncidentRecorder::pending_;
+    uint64_t                                            IncidentRecorder::clipCounter_ = 0;
+    std::mutex                                          IncidentRecorder::mtx_;
+    std::condition_variable                             IncidentRecorder::writerCv_;
+    std::thread                                         IncidentRecorder::captureThread_;
+    std::thread                                         IncidentRecorder::writerThread_;
+    std::atomic<bool>                                   IncidentRecorder::running_{false};
+
+    void IncidentRecorder::Initialize(FrameSource source, IncidentRecorderSettings settings)
+    {
+        if (running_.load()) {
+            Logger::Info("IncidentRecorder already initialized");
+            return;
+        }
+        if (settings.framesPerSecond <= 0.0) {
+            throw std::invalid_argument("IncidentRecorder frame rate must be positive");
+        }
+
+        std::filesystem::create_directories(settings.directory);
+        settings_ = std::move(settings);
+        source_ = std::move(source);
+
+        size_t ringSize = std::max<size_t>(1, size_t(std::ceil(settings_.preEventSeconds * settings_.framesPerSecond)));
+        ring_.assign(ringSize, nullptr);
+        ringHead_ = ringCount_ = 0;
+
+        running_.store(true);
+        captureThread_ = std::thread(&IncidentRecorder::CaptureFunc);
+        writerThread_ = std::thread(&IncidentRecorder::WriterFunc);
+        Logger::Info("IncidentRecorder initialized: {} pre-event frames at {} fps into {}",
+                     ringSize, settings_.framesPerSecond, settings_.directory.generic_string());
+    }
+
+    void IncidentRecorder::Dispose()
+    {
+        if (!running_.exchange(false)) return;
+        if (captureThread_.joinable()) captureThread_.join();
+        {
+            // Whatever was collected for an open incident is still worth keeping
+            std::lock_guard<std::mutex> lock(mtx_);
+            if (collecting_) {
+                pending_.push_back(std::move(*collecting_));
+                collecting_.reset();
+            }
+        }
+        writerCv_.notify_one();
+        if (writerThread_.joinable()) writerThread_.join();
+
+        ring_.clear();
+        source_ = nullptr;
+        Logger::Info("Disposed of IncidentRecorder.");
+    }
+
+    std::string IncidentRecorder::Trigger(const std::string& reason)
+    {
+        if (!running_.load()) return "";
+
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (collecting_) {
+            return collecting_->path.generic_string();
+        }
+        if (pending_.size() >= settings_.maxPendingClips) {
+            Logger::Warning("Incident clip for \"{}\" dropped: {} clips are still waiting for disk", reason, pending_.size());
+            return "";
+        }
+
+        auto incident = std::make_unique<Incident>();
+        incident->path = NextClipPath();
+        incident->postFramesRemaining = std::max<size_t>(1, size_t(std::ceil(settings_.postEventSeconds * settings_.framesPerSecond)));
+        incident->frames.reserve(ringCount_ + incident->postFramesRemaining);
+        for (size_t i = 0; i < ringCount_; i++) {
+            incident->frames.push_back(ring_[(ringHead_ + ring_.size() - ringCount_ + i) % ring_.size()]);
+        }
+        collecting_ = std::move(incident);
+
+        Logger::Info("Recording incident clip {} ({})", collecting_->path.generic_string(), reason);
+        return collecting_->path.generic_string();
+    }
+
+    void IncidentRecorder::CaptureFunc()
+    {
+        const auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(1.0 / settings_.framesPerSecond));
+        const std::vector<int> encodeParams = {cv::IMWRITE_JPEG_QUALITY, settings_.jpegQuality};
+        std::vector<uchar> encoded;
+        encoded.reserve(settings_.maxFrameBytes);
+        auto next = std::chrono::steady_clock::now();
+
+        while (running_.load()) {
+            next += interval;
+            auto now = std::chrono::steady_clock::now();
+            if (next < now) next = now;
+            std::this_thread::sleep_until(next);
+
+            cv::Mat frame = source_();
+            if (frame.empty() || !cv::imencode(".jpg", frame, encoded, encodeParams)) continue;
+            if (encoded.size() > settings_.maxFrameBytes) {
+                Logger::Verbose("Incident frame of {} bytes exceeds the {} byte limit, skipped", encoded.size(), settings_.maxFrameBytes);
+                continue;
+            }
+
+            std::lock_guard<std::mutex> lock(mtx_);
+            EncodedFrame& slot = ring_[ringHead_];
+            // Slots still referenced by a clip are left to it, everything else is reused in place
+            if (!slot || slot.use_count() > 1) {
+                slot = std::make_shared<std::vector<uchar>>();
+                slot->reserve(settings_.maxFrameBytes);
+            }
+            slot->assign(encoded.begin(), encoded.end());
+            ringHead_ = (ringHead_ + 1) % ring_.size();
+            ringCount_ = std::min(ringCount_ + 1, ring_.size());
+
+            if (collecting_) {
+                collecting_->frames.push_back(slot);
+                if (--collecting_->postFramesRemaining == 0) {
+                    pending_.push_back(std::move(*collecting_));
+                    collecting_.reset();
+                    writerCv_.notify_one();
+                }
+            }
+        }
+    }
+
+    void IncidentRecorder::WriterFunc()
+    {
+        // Disk writes must never compete with the vision thread
+        setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 10);
+
+        while (true) {
+            Incident incident;
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                writerCv_.wait(lock, [] { return !pending_.empty() || !running_.load(); });
+                if (pending_.empty()) return;
+                incident = std::move(pending_.front());
+                pending_.pop_front();
+            }
+            try {
+                WriteClip(incident);
+            } catch (const std::exception& ex) {
+                Logger::Error("Could not write incident clip {}: {}", incident.path.generic_string(), ex.what());
+            }
+        }
+    }
+
+    void IncidentRecorder::WriteClip(const Incident& incident)
+    {
+        std::ofstream stream(incident.path, std::ios::out | std::ios::binary);
+        if (!stream.good()) {
+            throw std::runtime_error("Could not open stream to write the clip");
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        size_t written = 0;
+        for (const auto& frame : incident.frames) {
+            stream.write(reinterpret_cast<const char*>(frame->data()), std::streamsize(frame->size()));
+            written += frame->size();
+
+            // Throttle to the configured bandwidth, unless we are shutting down
+            if (running_.load() && settings_.maxWriteBytesPerSecond > 0) {
+                auto budget = std::chrono::duration<double>(double(written) / double(settings_.maxWriteBytesPerSecond));
+                std::this_thread::sleep_until(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(budget));
+            }
+        }
+        stream.flush();
+        if (!stream.good()) {
+            throw std::runtime_error("Write failed");
+        }
+
+        Logger::Info("Incident clip {} written: {} frames, {} KB in {} ms", incident.path.generic_string(),
+                     incident.frames.size(), written / 1024,
+                     std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    std::filesystem::path IncidentRecorder::NextClipPath()
+    {
+        std::time_t now = std::time(nullptr);
+        std::tm localTime {};
+        localtime_r(&now, &localTime);
+
+        std::ostringstream name;
+        name << "incident-" << std::put_time(&localTime, "%Y-%m-%d-%H-%M-%S") << "-" << clipCounter_++ << ".mjpeg";
+        return settings_.directory / name.str();
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace DebuggerInfrastructure
+{
+    struct IncidentRecorderSettings
+    {
+        std::filesystem::path directory = "clips";
+        double framesPerSecond = 10.0;
+        double preEventSeconds = 5.0;
+        double postEventSeconds = 3.0;
+        int jpegQuality = 70;
+        size_t maxFrameBytes = 256 * 1024;          ///< Encoded frames above this size are dropped.
+        size_t maxPendingClips = 2;                 ///< Triggers beyond this are dropped, not queued.
+        size_t maxWriteBytesPerSecond = 4 * 1024 * 1024;
+    };
+
+    /**
+     * @brief Keeps the last seconds of compressed frames in a fixed ring and dumps incident clips to disk.
+     *
+     * A capture thread samples frames from the frame source at a fixed rate and JPEG-encodes them into the ring,
+     * so the vision thread pays nothing. A trigger snapshots the ring, collects the post-event frames and hands the
+     * clip to a low-priority writer thread that throttles its disk bandwidth. Clips are written as concatenated
+     * JPEGs (.mjpeg, playable with e.g. "ffplay -f mjpeg").
+     */
+    class IncidentRecorder
+    {
+    public:
+        using FrameSource = std::function<cv::Mat()>;
+
+        static void Initialize(FrameSource source, IncidentRecorderSettings settings = {});
+        static void Dispose();
+
+        /**
+         * @brief Starts a clip around the current moment.
+         * @return Path of the clip that will be written, or an empty string if recording is unavailable or the
+         *         writer is saturated. Triggers while a clip is still collecting post-event frames share its path.
+         */
+        static std::string Trigger(const std::string& reason);
+
+    private:
+        using EncodedFrame = std::shared_ptr<std::vector<uchar>>;
+
+        struct Incident
+        {
+            std::filesystem::path path;
+            std::vector<EncodedFrame> frames;
+            size_t postFramesRemaining;
+        };
+
+        static void CaptureFunc();
+        static void WriterFunc();
+        static void WriteClip(const Incident& incident);
+        static std::filesystem::path NextClipPath();
+
+        static IncidentRecorderSettings settings_;
+        static FrameSource source_;
+        static std::vector<EncodedFrame> ring_;
+        static size_t ringHead_;
+        static size_t ringCount_;
+        static std::unique_ptr<Incident> collecting_;
+        static std::deque<Incident> pending_;
+        static uint64_t clipCounter_;
+        static std::mutex mtx_;
+        static std::condition_variable writerCv_;
+        static std::thread captureThread_;
+        static std::thread writerThread_;
+        static std::atomic<bool> running_;
+    };
+}
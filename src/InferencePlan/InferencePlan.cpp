@@ -0,0 +1,61 @@
+#include "InferencePlan.h"
+#include <algorithm>
+#include <stdexcept>
+#include <fmt/format.h>
+
+namespace DebuggerInfrastructure
+{
+    uint64_t FramePlan::Pixels() const
+    {
+        uint64_t pixels = uint64_t(cropInput) * uint64_t(cropInput);
+        if (scan) pixels += uint64_t(scanInput) * uint64_t(scanInput);
+        return pixels;
+    }
+
+    InferencePlan::InferencePlan(int fullInput, int scanInput, size_t scanEvery)
+        : fullInput_(fullInput), scanInput_(scanInput), scanEvery_(scanEvery)
+    {
+        if (fullInput_ < stride || fullInput_ % stride != 0) {
+            throw std::invalid_argument(fmt::format("Net input {} is not a positive multiple of {}", fullInput_, stride));
+        }
+        if (scanInput_ < stride || scanInput_ > fullInput_ || scanInput_ % stride != 0) {
+            throw std::invalid_argument(fmt::format("Protected scan input {} must be a multiple of {} up to {}", scanInput_, stride, fullInput_));
+        }
+        if (scanEvery_ == 0) {
+            throw std::invalid_argument("Protected scan interval must be at least 1 frame");
+        }
+    }
+
+    FramePlan InferencePlan::Next(const cv::Size& frame, const cv::Rect& crop)
+    {
+        FramePlan plan;
+        if (crop.width >= frame.width && crop.height >= frame.height) {
+            plan.cropInput = fullInput_;
+        } else {
+            plan.cropInput = CropInput(std::max(crop.width, crop.height), std::max(frame.width, frame.height));
+            // The crop misses whoever stands outside the regions
+            if (scanCountdown_ == 0) {
+                plan.scan = true;
+                plan.scanInput = scanInput_;
+                scanCountdown_ = scanEvery_;
+            }
+            scanCountdown_--;
+        }
+        frames_++;
+        pixels_ += plan.Pixels();
+        return plan;
+    }
+
+    int InferencePlan::CropInput(int cropLength, int frameLength) const
+    {
+        // Rounded up, the crop never gets fewer pixels than the whole frame would give it
+        long long scaled = (static_cast<long long>(fullInput_) * cropLength + frameLength - 1) / std::max(frameLength, 1);
+        int input = int((scaled + stride - 1) / stride * stride);
+        return std::clamp(input, stride, fullInput_);
+    }
+
+    double InferencePlan::AveragePixels() const
+    {
+        return frames_ == 0 ? 0.0 : double(pixels_) / double(frames_);
+    }
+}
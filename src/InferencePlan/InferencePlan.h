@@ -0,0 +1,52 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+#include <cstdint>
+
+namespace DebuggerInfrastructure
+{
+    // What the vision thread infers on one frame.
+    struct FramePlan
+    {
+        int cropInput = 0;          ///< Side of the square net input the crop is resized to.
+        bool scan = false;          ///< Whether the whole frame is inferred for protected entities as well.
+        int scanInput = 0;          ///< Side of the net input of that scan.
+
+        // Net input pixels of the frame, what the convolutions of the net scale with.
+        uint64_t Pixels() const;
+    };
+
+    /**
+     * @brief Sizes the inferences of one camera's frames.
+     *
+     * The crop to the regions of interest keeps the pixel density the whole frame gets at the full input, so the
+     * net input shrinks with the crop and an insect stays as many input pixels wide. Protected entities outside
+     * the crop are looked for on the whole frame every scanEvery frames, at the smaller scanInput: people and pets
+     * are large enough for it. Inputs are multiples of the net stride.
+     */
+    class InferencePlan
+    {
+    public:
+        static constexpr int stride = 32;
+        static constexpr int defaultScanInput = 320;
+        static constexpr size_t defaultScanEvery = 3;
+
+        InferencePlan(int fullInput, int scanInput, size_t scanEvery);
+
+        // The plan of the next frame. A crop covering the whole frame is one pass at the full input.
+        FramePlan Next(const cv::Size& frame, const cv::Rect& crop);
+        // Input side for a crop whose longer side is cropLength, in a frame whose longer side is frameLength.
+        int CropInput(int cropLength, int frameLength) const;
+        // Mean of FramePlan::Pixels over the frames planned so far.
+        double AveragePixels() const;
+
+    private:
+        int fullInput_;
+        int scanInput_;
+        size_t scanEvery_;
+        size_t scanCountdown_ = 0;      ///< Frames to the next full-frame scan.
+        uint64_t frames_ = 0;
+        uint64_t pixels_ = 0;
+    };
+}
@@ -2,56 +2,93 @@
 #include "../Logger/Logger.h"
 #include "../GPIOHandler/GPIOHandler.h"
 #include "../DeadLocker/DeadLocker.h"
+#include "../SafetyTrace/SafetyTrace.h"
+#include "../StateJournal/StateJournal.h"
 #include "../ExceptionExtensions/ExceptionExtensions.h"
-#include <gpiod.h>
 #include <stdexcept>
 #include <string>
 namespace DebuggerInfrastructure
 {
     // Define the static member variables
     std::mutex LaserHandler::mtx;
-    bool LaserHandler::lock = true;
-    gpiod_line* LaserHandler::line = nullptr;
-    bool LaserHandler::initialized = false;
+    std::atomic<bool> LaserHandler::lock{true};
+    std::atomic<uint64_t> LaserHandler::enabledMask{0};
+    std::vector<unsigned int> LaserHandler::lines;
+    std::vector<size_t> LaserHandler::lineIds;
+    std::atomic<bool> LaserHandler::initialized{false};
 
-    void LaserHandler::Initialize(size_t lineId)
+    void LaserHandler::Initialize(const std::vector<size_t>& requestedLineIds)
     {
         // Protect shared data/state
         std::lock_guard<std::mutex> guard(mtx);
         if (initialized)
         {
             Logger::Info("LaserHandler is already initialized.");
-            // Ensure the requested pin matches the already-initialized pin
-            if (line != LaserHandler::line)
+            // Ensure the requested pins match the already-initialized pins
+            if (requestedLineIds != LaserHandler::lineIds)
             {
                 std::runtime_error ex(
-                    "Initialization requested for laser handler with different GPIO pin, cannot proceed.");
+                    "Initialization requested for laser handler with different GPIO pins, cannot proceed.");
                 Logger::Critical(ex.what());
                 throw ex;
             }
             return;
         }
-        line = GPIOHandler::GetLine(lineId);
-        GPIOHandler::RequestLineOutput(line, "LaserGPIOpin");
+        if (requestedLineIds.empty())
+        {
+            throw std::runtime_error("LaserHandler needs at least one GPIO pin.");
+        }
+        if (requestedLineIds.size() > MaxLasers)
+        {
+            throw std::runtime_error("LaserHandler supports at most " + std::to_string(MaxLasers) + " lasers.");
+        }
+        std::vector<unsigned int> requested;
+        for (size_t lineId : requestedLineIds)
+        {
+            requested.push_back(static_cast<unsigned int>(lineId));
+        }
+        // One request for every laser, so the emergency cut is a single write
+        GPIOHandler::RequestLinesOutput(requested, "LaserGPIO", std::vector<int>(requested.size(), 0));
+        lines = std::move(requested);
+        lineIds = requestedLineIds;
+        enabledMask = 0;
+        StateJournal::RecordLaserLines(lines);
+        StateJournal::RecordLasers(0);
 
-        // Unlock and disable the laser initially
+        // Unlock, the lasers start disabled
         LaserHandler::lock = false;
-        gpiod_line_set_value(line, 0);
 
         LaserHandler::initialized = true;
-        Logger::Info("LaserHandler initialized successfully.");
+        Logger::Info("LaserHandler initialized successfully with {} laser(s).", lines.size());
     }
 
     void LaserHandler::EmergencyDisableAndLock()
     {
-        // Disable laser and lock it
-        try
+        std::lock_guard<std::mutex> guard(mtx);
+        // Lock first, then drive every line low whatever the cached state says
+        LaserHandler::lock = true;
+        uint64_t stillOn = 0;
+        if (GPIOHandler::SetValues(lines, std::vector<int>(lines.size(), 0)) < 0)
         {
-            LaserHandler::Disable();
+            // Try line by line, as many lasers as possible go low. Like Disable, a laser whose line was not
+            // written stays reported and journaled as it was
+            for (size_t turret = 0; turret < lines.size(); turret++)
+            {
+                if (GPIOHandler::SetValue(lines[turret], 0) < 0)
+                {
+                    stillOn |= enabledMask.load() & (uint64_t{1} << turret);
+                }
+            }
         }
-        catch(...){ /*IGNORED*/ }
-        LaserHandler::lock = true;
-        Logger::Info("Laser is disabled and locked.");
+        enabledMask = stillOn;
+        StateJournal::RecordLasers(stillOn);
+        if (stillOn != 0)
+        {
+            Logger::Error("Lasers are locked, but the lines of lasers 0x{:x} could not be driven low.", stillOn);
+            return;
+        }
+        SafetyTrace::Mark(TraceHop::LaserCut);
+        Logger::Info("Lasers are disabled and locked.");
     }
 
     void LaserHandler::Unlock()
@@ -62,88 +99,158 @@ namespace DebuggerInfrastructure
         Logger::Info("Laser is unlocked.");
     }
 
-    std::string LaserHandler::Enable()
+    unsigned int LaserHandler::LineFor(size_t turret)
     {
-        std::lock_guard<std::mutex> guard(mtx);
-        int laserValue = gpiod_line_get_value(line);
-        if(laserValue == 0)
+        if (turret >= lines.size())
         {
-            if (!lock)
-            {
-                gpiod_line_set_value(line, 1);
-                return "Laser enabled.";
-            }
-            throw BadRequestException("Laser is locked due to emergency => cannot enable.");   
+            throw std::runtime_error("There is no laser for turret " + std::to_string(turret));
         }
-        else if(laserValue == 1)
+        return lines[turret];
+    }
+
+    std::string LaserHandler::Enable(size_t turret)
+    {
+        std::lock_guard<std::mutex> guard(mtx);
+        unsigned int line = LineFor(turret);
+        uint64_t bit = uint64_t{1} << turret;
+        if(enabledMask.load() & bit)
         {
             throw BadRequestException("Laser is enabled already.");
         }
-        throw std::runtime_error("Laser is not initialized properly");
+        if (lock)
+        {
+            throw BadRequestException("Laser is locked due to emergency => cannot enable.");
+        }
+        // Journaled before the line goes high, a crash in between still counts as an engagement
+        StateJournal::RecordLasers(enabledMask.load() | bit);
+        if (GPIOHandler::SetValue(line, 1) < 0)
+        {
+            StateJournal::RecordLasers(enabledMask.load());
+            throw std::runtime_error("Laser is not initialized properly");
+        }
+        enabledMask.fetch_or(bit);
+        return "Laser enabled.";
     }
 
-    std::string LaserHandler::Disable()
+    std::string LaserHandler::Disable(size_t turret)
     {
         std::lock_guard<std::mutex> guard(mtx);
-        int laserValue = gpiod_line_get_value(line);
-        if(laserValue == 1)
+        unsigned int line = LineFor(turret);
+        uint64_t bit = uint64_t{1} << turret;
+        if(!(enabledMask.load() & bit))
         {
-            gpiod_line_set_value(line, 0);
-            if (!lock)
-            {
-                return "Laser disabled.";
-            }
-            throw BadRequestException("Laser is locked due to emergency, but was disabled anyway for safety");   
+            throw BadRequestException("Laser is disabled already.");
         }
-        else if(laserValue == 0)
+        // Cleared once the line is low. A failed write may have left the laser on, so it is still reported and
+        // journaled as on
+        if (GPIOHandler::SetValue(line, 0) < 0)
         {
-            throw BadRequestException("Laser is disabled already.");
+            throw std::runtime_error("Laser is not initialized properly");
+        }
+        enabledMask.fetch_and(~bit);
+        StateJournal::RecordLasers(enabledMask.load());
+        if (lock)
+        {
+            throw BadRequestException("Laser is locked due to emergency, but was disabled anyway for safety");
         }
-        throw std::runtime_error("Laser is not initialized properly");
+        return "Laser disabled.";
     }
 
-    std::string LaserHandler::GetStatus()
+    bool LaserHandler::SetOutput(size_t turret, bool on)
+    {
+        std::lock_guard<std::mutex> guard(mtx);
+        if (turret >= lines.size() || (on && lock))
+        {
+            return false;
+        }
+        uint64_t bit = uint64_t{1} << turret;
+        // Like Enable and Disable: journaled as on before the line goes high, the cache follows a successful write
+        if (on)
+        {
+            StateJournal::RecordLasers(enabledMask.load() | bit);
+        }
+        if (GPIOHandler::SetValue(lines[turret], on ? 1 : 0) < 0)
+        {
+            StateJournal::RecordLasers(enabledMask.load());
+            return false;
+        }
+        if (on)
+        {
+            enabledMask.fetch_or(bit);
+        }
+        else
+        {
+            enabledMask.fetch_and(~bit);
+            StateJournal::RecordLasers(enabledMask.load());
+        }
+        return true;
+    }
+
+    std::string LaserHandler::GetStatus(size_t turret)
     {
         std::string response;
-        int laserValue = gpiod_line_get_value(line);
         if(!initialized)
         {
             return "Uninitialized";
         }
-        switch (laserValue)
+        LaserState state = GetState(turret);
+        int laserValue = GPIOHandler::GetValue(LineFor(turret));
+        if (laserValue != (state == LaserState::Enabled ? 1 : 0))
         {
-        case 1:
-            response = "Enabled";
-            break;
-        case 0:
-            response = "Disabled";
-            break;
-        default:
+            // The line does not hold what the handler wrote last
             response = "Error";
-            break;
         }
-        std::string reasons;
-        for(std::string el : DeadLocker::lockReasons)
+        else
         {
-            reasons += " " + el + " ";
+            response = state == LaserState::Enabled ? "Enabled" : "Disabled";
         }
-        response = lock? response + ". Locked due to an emergency (Reasons:" + reasons + ")" : response;
+        response = lock? response + ". Locked due to an emergency (Reasons:" + DeadLocker::DescribeReasons() + ")" : response;
         return response;
     }
 
+    LaserState LaserHandler::GetState(size_t turret)
+    {
+        if (!initialized)
+        {
+            return LaserState::Uninitialized;
+        }
+        return IsEnabled(turret) ? LaserState::Enabled : LaserState::Disabled;
+    }
+
+    bool LaserHandler::IsEnabled(size_t turret)
+    {
+        return turret < MaxLasers && (enabledMask.load(std::memory_order_acquire) >> turret) & 1;
+    }
+
+    uint64_t LaserHandler::GetEnabledMask()
+    {
+        return enabledMask.load(std::memory_order_acquire);
+    }
+
+    bool LaserHandler::IsLocked()
+    {
+        return lock.load();
+    }
+
+    size_t LaserHandler::Count()
+    {
+        return lines.size();
+    }
+
     void LaserHandler::Dispose()
     {
         // Disable and lock for safety
         LaserHandler::EmergencyDisableAndLock();
 
         // Close chip resources
-        if (line != nullptr)
+        for (unsigned int line : lines)
         {
             GPIOHandler::ReleaseLine(line);
         }
-        line = nullptr;
+        lines.clear();
+        lineIds.clear();
 
         initialized = false;
         Logger::Info("Disposed of LaserHandler resources.");
     }
-}
\ No newline at end of file
+}
@@ -1,16 +1,30 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <mutex>
-#include <gpiod.hpp>
+#include <string>
+#include <vector>
 namespace DebuggerInfrastructure
 {
+    /**
+     * @brief Output state of one laser, as last written by the handler.
+     */
+    enum class LaserState : uint8_t
+    {
+        Uninitialized,
+        Disabled,
+        Enabled
+    };
+
     /**
      * @class LaserHandler
      * @brief This class controls a laser connected via a GPIO pin on the host device.
      *
      * The LaserHandler manages initialization, enabling/disabling, and locking/unlocking
-     * of the laser. It uses static methods and shared static data protected by a mutex to
-     * ensure thread safety when accessed by multiple threads.
+     * of the lasers, one GPIO line per turret. It uses static methods and shared static data
+     * protected by a mutex to ensure thread safety when accessed by multiple threads.
+     * The lock is shared: an emergency disables and locks every laser.
      */
     class LaserHandler
     {
@@ -25,34 +39,56 @@ namespace DebuggerInfrastructure
          *
          * When locked, @ref Enable() does nothing (the laser remains disabled).
          */
-        static bool lock;
+        static std::atomic<bool> lock;
+
+        /**
+         * @brief Output state of every laser, bit N is set while the laser of turret N is on.
+         *
+         * Changed under @ref mtx once the GPIO write succeeded, read without a lock by @ref IsEnabled().
+         */
+        static std::atomic<uint64_t> enabledMask;
+
+        /**
+         * @brief The GPIO lines controlling the laser pins, indexed by turret.
+         */
+        static std::vector<unsigned int> lines;
 
         /**
-         * @brief Pointer to the gpiod line object controlling the laser pin.
+         * @brief The line offsets requested in @ref Initialize(), indexed by turret.
          */
-        static gpiod_line* line;
+        static std::vector<size_t> lineIds;
 
         /**
          * @brief Flag indicating whether the handler has been initialized.
          */
-        static bool initialized;
+        static std::atomic<bool> initialized;
+
+        /**
+         * @brief Line of the turret, throws if there is none.
+         */
+        static unsigned int LineFor(size_t turret);
 
     public:
         /**
-         * @brief Initializes the LaserHandler with the specified GPIO pin.
+         * @brief Upper bound on the number of lasers, one bit each in @ref enabledMask.
+         */
+        static constexpr size_t MaxLasers = 64;
+
+        /**
+         * @brief Initializes the LaserHandler with one GPIO pin per turret.
          *
-         * Opens the GPIO chip, requests the given pin for output, and sets
-         * the laser to a disabled and unlocked state.
+         * Requests the given pins for output, and sets the lasers to a disabled and unlocked state.
          *
-         * @param GPIOpin The pin number on the GPIO chip to be used for laser control.
-         * @throw std::runtime_error If the chip or line fails to open, or if line request fails.
+         * @param lineIds The pin numbers on the GPIO chip, the index is the turret id.
+         * @throw std::runtime_error If a line fails to open, or if line request fails.
          */
-        static void Initialize(size_t lineId);
+        static void Initialize(const std::vector<size_t>& lineIds);
 
         /**
-         * @brief Disables the laser immediately and locks it (cannot be enabled until unlocked).
+         * @brief Disables every laser immediately and locks them (cannot be enabled until unlocked).
          *
-         * Calls @ref Disable() internally, then sets @ref lock to true.
+         * Sets @ref lock first, then drives every line low in one write, line by line if that fails. A laser
+         * whose line could not be written keeps its bit in @ref enabledMask and in the journal.
          */
         static void EmergencyDisableAndLock();
 
@@ -62,21 +98,59 @@ namespace DebuggerInfrastructure
         static void Unlock();
 
         /**
-         * @brief Enables the laser if it is unlocked.
+         * @brief Enables the laser of the turret if it is unlocked.
          *
          * If @ref lock is true, enabling is ignored.
          */
-        static std::string Enable();
+        static std::string Enable(size_t turret = 0);
+
+        /**
+         * @brief Disables the laser of the turret (regardless of the lock state).
+         */
+        static std::string Disable(size_t turret = 0);
+
+        /**
+         * @brief Drives the laser of the turret without the checks and messages of Enable/Disable.
+         *
+         * Used by the pulse engine for timed edges. Switching on is refused while locked, so no edge
+         * can turn a laser back on after @ref EmergencyDisableAndLock().
+         *
+         * @return False if the laser was not switched, because of the lock or a GPIO error.
+         */
+        static bool SetOutput(size_t turret, bool on);
+
+        /**
+         * @brief Human readable status of the laser of the turret, with the lock reasons.
+         *
+         * Builds a string and reads the GPIO line, meant for REST. Use @ref GetState() or
+         * @ref IsEnabled() on hot paths.
+         */
+        static std::string GetStatus(size_t turret = 0);
+
+        /**
+         * @brief Cached output state of the laser of the turret, lock-free.
+         */
+        static LaserState GetState(size_t turret = 0);
+
+        /**
+         * @brief True while the laser of the turret is on, lock-free and allocation-free.
+         */
+        static bool IsEnabled(size_t turret = 0);
+
+        /**
+         * @brief Bitmask of the lasers that are on, bit N for turret N.
+         */
+        static uint64_t GetEnabledMask();
 
         /**
-         * @brief Disables the laser (regardless of the lock state).
+         * @brief True while the lasers are locked by an emergency.
          */
-        static std::string Disable();
+        static bool IsLocked();
 
         /**
-         * @brief Gets the status of the laser (regardless of the lock state).
+         * @brief Number of lasers, one per turret.
          */
-        static std::string GetStatus();
+        static size_t Count();
 
         /**
          * @brief Disposes of the laser resources safely, disabling and locking the laser.
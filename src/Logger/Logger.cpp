@@ -46,11 +46,13 @@ namespace DebuggerInfrastructure
     std::string Logger::getCurrentTime()
     {
         std::time_t now = std::time(nullptr);
-        std::tm* localTime = std::localtime(&now);
+        // localtime_r, the RecordQueue thread logs while the others do
+        std::tm localTime {};
+        localtime_r(&now, &localTime);
 
         std::ostringstream oss;
         // Example: 2024-12-28-10-22-30
-        oss << std::put_time(localTime, "%Y-%m-%d-%H-%M-%S");
+        oss << std::put_time(&localTime, "%Y-%m-%d-%H-%M-%S");
         return oss.str();
     }
 }
\ No newline at end of file
@@ -0,0 +1,297 @@
+#include "MotionController.h"
+#include "../ServoHandler/ServoHandler.h"
+#include "../Logger/Logger.h"
+#include "../Watchdog/Watchdog.h"
+#include "../ServoFeedback/ServoFeedback.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+
+namespace DebuggerInfrastructure
+{
+    namespace
+    {
+        // Two NaNs, never equal to a posted target
+        constexpr uint64_t notSettled = ~uint64_t(0);
+    }
+
+    MotionController::MotionController(ServoHandler& xServo, ServoHandler& yServo, MotionLimits limits,
+                                       std::pair<double, double> position, std::function<void()> onArrival,
+                                       const std::string& name, ServoFeedback* feedback)
+        : xServo_(xServo)
+        , yServo_(yServo)
+        , limits_(limits)
+        , onArrival_(std::move(onArrival))
+        , feedback_(feedback)
+        , mailbox_(Pack(position))
+        , resetMailbox_(Pack(position))
+        , resetPending_(false)
+        , armed_(false)
+        , armedFor_(Pack(position))
+        , position_(Pack(position))
+        , settledFor_(Pack(position))
+        , arrivalNs_(std::chrono::steady_clock::now().time_since_epoch().count())
+        , settleEstimateMs_(limits.settleMs)
+        , watchdog_(SIZE_MAX)
+        , running_(true)
+    {
+        if (limits_.tickHz <= 0.0 || limits_.maxVelocity <= 0.0 || limits_.maxAcceleration <= 0.0) {
+            throw std::invalid_argument("Motion limits must be positive");
+        }
+        watchdog_ = Watchdog::Register(name, WatchdogStage::Control);
+        thread_ = std::thread(&MotionController::ThreadFunc, this);
+        Logger::Info("MotionController started at {} Hz, {} deg/s, {} deg/s^2", limits_.tickHz, limits_.maxVelocity, limits_.maxAcceleration);
+    }
+
+    MotionController::~MotionController()
+    {
+        running_.store(false);
+        if (thread_.joinable()) thread_.join();
+        Watchdog::Unregister(watchdog_);
+    }
+
+    void MotionController::SetTarget(std::pair<double, double> target)
+    {
+        mailbox_.store(Pack(target), std::memory_order_release);
+    }
+
+    void MotionController::Reset(std::pair<double, double> position)
+    {
+        armed_.store(false);
+        mailbox_.store(Pack(position), std::memory_order_release);
+        resetMailbox_.store(Pack(position), std::memory_order_release);
+        resetPending_.store(true, std::memory_order_release);
+    }
+
+    void MotionController::Arm()
+    {
+        armedFor_.store(mailbox_.load(std::memory_order_acquire), std::memory_order_release);
+        armed_.store(true, std::memory_order_release);
+    }
+
+    void MotionController::Disarm()
+    {
+        armed_.store(false);
+    }
+
+    bool MotionController::IsArmed() const
+    {
+        return armed_.load(std::memory_order_acquire);
+    }
+
+    std::pair<double, double> MotionController::GetPosition() const
+    {
+        return Unpack(position_.load(std::memory_order_acquire));
+    }
+
+    std::pair<double, double> MotionController::GetTarget() const
+    {
+        return Unpack(mailbox_.load(std::memory_order_acquire));
+    }
+
+    bool MotionController::IsOnTarget() const
+    {
+        return settledFor_.load(std::memory_order_acquire) == mailbox_.load(std::memory_order_acquire);
+    }
+
+    bool MotionController::IsWithinTolerance(std::pair<double, double> target) const
+    {
+        auto position = GetPosition();
+        return std::abs(position.first - target.first) <= limits_.tolerance &&
+               std::abs(position.second - target.second) <= limits_.tolerance;
+    }
+
+    std::chrono::steady_clock::time_point MotionController::EstimatedArrival() const
+    {
+        return std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(arrivalNs_.load(std::memory_order_acquire)));
+    }
+
+    double MotionController::EstimateTravelMs(std::pair<double, double> target) const
+    {
+        auto position = GetPosition();
+        double seconds = std::max(TimeToReach(Axis{position.first, 0.0}, target.first),
+                                  TimeToReach(Axis{position.second, 0.0}, target.second));
+        return seconds * 1000.0 + settleEstimateMs_.load(std::memory_order_relaxed);
+    }
+
+    void MotionController::ThreadFunc()
+    {
+        const double dt = 1.0 / limits_.tickHz;
+        const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(dt));
+        const auto settle = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double, std::milli>(limits_.settleMs));
+
+        auto start = GetPosition();
+        Axis x{start.first, 0.0};
+        Axis y{start.second, 0.0};
+        uint64_t lastTarget = mailbox_.load(std::memory_order_acquire);
+        bool reached = true;
+        auto reachedAt = std::chrono::steady_clock::now();
+        auto next = reachedAt;
+        // Per target: posted, confirmed by the feedback, reported as not settling, stopped by a limit switch
+        auto commandedAt = reachedAt;
+        bool confirmed = false;
+        std::chrono::steady_clock::time_point confirmedAt {};
+        bool timedOut = false;
+        bool limitStopped = false;
+        const auto feedbackTimeout = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double, std::milli>(feedback_ ? feedback_->GetSettings().timeoutMs : 0.0));
+
+        while (running_.load()) {
+            next += period;
+            auto now = std::chrono::steady_clock::now();
+            if (next < now) next = now;
+            std::this_thread::sleep_until(next);
+
+            if (resetPending_.exchange(false, std::memory_order_acq_rel)) {
+                auto position = Unpack(resetMailbox_.load(std::memory_order_acquire));
+                x = Axis{position.first, 0.0};
+                y = Axis{position.second, 0.0};
+                // The servos jumped, they have to settle again even on the same target
+                reached = false;
+                confirmed = false;
+            }
+
+            uint64_t packedTarget = mailbox_.load(std::memory_order_acquire);
+            if (packedTarget != lastTarget) {
+                lastTarget = packedTarget;
+                reached = false;
+                commandedAt = std::chrono::steady_clock::now();
+                confirmed = false;
+                timedOut = false;
+                limitStopped = false;
+            }
+            auto target = Unpack(packedTarget);
+
+            bool blockedX = feedback_ && Blocked(x, target.first, FeedbackAxis::X);
+            bool blockedY = feedback_ && Blocked(y, target.second, FeedbackAxis::Y);
+            if (!blockedX) Step(x, target.first, dt);
+            if (!blockedY) Step(y, target.second, dt);
+            if ((blockedX || blockedY) && !limitStopped) {
+                limitStopped = true;
+                feedback_->RecordLimitStop();
+                Logger::Warning("MotionController stopped at X({:.1f}) Y({:.1f}), a limit switch is closed", x.position, y.position);
+            }
+            try {
+                xServo_.SetAngle(x.position);
+                yServo_.SetAngle(y.position);
+            } catch (const std::exception& ex) {
+                Logger::Error("MotionController could not move the servos: {}", ex.what());
+            }
+            position_.store(Pack({x.position, y.position}), std::memory_order_release);
+            Watchdog::Heartbeat(watchdog_);
+
+            now = std::chrono::steady_clock::now();
+            bool atTarget = x.position == target.first && y.position == target.second;
+            if (atTarget && !reached) {
+                reached = true;
+                reachedAt = now;
+            }
+
+            // Measured settle: a sample taken after the last step with both axes within tolerance
+            std::optional<std::pair<double, double>> measured;
+            std::chrono::steady_clock::time_point sampledAt {};
+            if (feedback_ && feedback_->HasAngleSensor()) measured = feedback_->Angle(&sampledAt);
+            if (reached && measured && !confirmed && sampledAt >= reachedAt) {
+                double error = std::max(std::abs(measured->first - target.first), std::abs(measured->second - target.second));
+                if (error <= feedback_->GetSettings().toleranceDeg) {
+                    confirmed = true;
+                    confirmedAt = now;
+                    double settleMs = std::chrono::duration<double, std::milli>(now - reachedAt).count();
+                    feedback_->RecordResponse(std::chrono::duration<double, std::milli>(now - commandedAt).count(), settleMs, error);
+                    settleEstimateMs_.store(feedback_->GetStats().meanSettleMs, std::memory_order_relaxed);
+                } else if (!timedOut && now - reachedAt > feedbackTimeout) {
+                    timedOut = true;
+                    feedback_->RecordTimeout();
+                    Logger::Warning("MotionController target X({:.1f}) Y({:.1f}) not settled, measured X({:.1f}) Y({:.1f})",
+                                    target.first, target.second, measured->first, measured->second);
+                }
+            }
+
+            std::chrono::steady_clock::time_point arrival;
+            if (confirmed) {
+                arrival = confirmedAt;
+            } else if (reached) {
+                arrival = reachedAt + settle;
+            } else {
+                double remaining = std::max(TimeToReach(x, target.first), TimeToReach(y, target.second));
+                arrival = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(remaining)) + settle;
+            }
+            arrivalNs_.store(arrival.time_since_epoch().count(), std::memory_order_release);
+
+            // Without a fresh sample the fixed settle delay decides, a sensor that disagrees blocks the arrival
+            bool settled = confirmed || (reached && !measured && now >= reachedAt + settle);
+            settledFor_.store(settled ? packedTarget : notSettled, std::memory_order_release);
+            // Only fire for the target we were armed for, never for one that was replaced meanwhile
+            if (settled && armed_.load(std::memory_order_acquire) &&
+                armedFor_.load(std::memory_order_acquire) == packedTarget && armed_.exchange(false)) {
+                try {
+                    onArrival_();
+                } catch (const std::exception& ex) {
+                    Logger::Warning("MotionController arrival action failed: {}", ex.what());
+                }
+            }
+        }
+    }
+
+    void MotionController::Step(Axis& axis, double target, double dt) const
+    {
+        const double a = limits_.maxAcceleration;
+        double error = target - axis.position;
+        if (std::abs(error) < 1e-3 && std::abs(axis.velocity) <= a * dt) {
+            axis.position = target;
+            axis.velocity = 0.0;
+            return;
+        }
+
+        // Fastest velocity from which we can still brake to a stop at the target
+        double direction = error > 0.0 ? 1.0 : -1.0;
+        double desired = direction * std::min(limits_.maxVelocity, std::sqrt(2.0 * a * std::abs(error)));
+        axis.velocity += std::clamp(desired - axis.velocity, -a * dt, a * dt);
+
+        double step = axis.velocity * dt;
+        if ((error > 0.0 && step >= error) || (error < 0.0 && step <= error)) {
+            axis.position = target;
+            axis.velocity = 0.0;
+        } else {
+            axis.position += step;
+        }
+    }
+
+    bool MotionController::Blocked(Axis& axis, double target, FeedbackAxis feedbackAxis) const
+    {
+        if (!feedback_->LimitClosed(feedbackAxis, target - axis.position)) return false;
+        axis.velocity = 0.0;
+        return true;
+    }
+
+    double MotionController::TimeToReach(const Axis& axis, double target) const
+    {
+        // Trapezoidal profile from rest, good enough as an estimate
+        double distance = std::abs(target - axis.position);
+        if (distance < 1e-3) return 0.0;
+        double vmax = limits_.maxVelocity;
+        double a = limits_.maxAcceleration;
+        if (distance >= vmax * vmax / a) {
+            return distance / vmax + vmax / a;
+        }
+        return 2.0 * std::sqrt(distance / a);
+    }
+
+    uint64_t MotionController::Pack(std::pair<double, double> value)
+    {
+        float parts[2] = {float(value.first), float(value.second)};
+        uint64_t packed;
+        std::memcpy(&packed, parts, sizeof(packed));
+        return packed;
+    }
+
+    std::pair<double, double> MotionController::Unpack(uint64_t value)
+    {
+        float parts[2];
+        std::memcpy(parts, &value, sizeof(parts));
+        return {parts[0], parts[1]};
+    }
+}
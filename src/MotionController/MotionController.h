@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <string>
+#include <utility>
+#include "../Watchdog/Watchdog.h"
+
+namespace DebuggerInfrastructure
+{
+    class ServoHandler;
+    class ServoFeedback;
+    enum class FeedbackAxis : uint8_t;
+
+    struct MotionLimits
+    {
+        double tickHz = 100.0;
+        double maxVelocity = 300.0;         ///< deg/s
+        double maxAcceleration = 2500.0;    ///< deg/s^2
+        double tolerance = 0.5;             ///< deg, a target this close counts as reached
+        double settleMs = 60.0;             ///< time the servo horn needs after the last step
+    };
+
+    /**
+     * @brief Drives one X/Y servo pair from a dedicated thread at a fixed tick rate.
+     *
+     * Callers post setpoints through a lock-free single-slot mailbox where only the latest target counts, and
+     * return immediately. Every tick each axis moves along a velocity- and acceleration-limited profile towards the
+     * target, so the mount receives small steps instead of jumps. The estimated time of arrival is published for
+     * readers, and an armed arrival callback fires once on the controller thread when the turret has settled.
+     * Every tick beats the controller's watchdog channel, registered under the given name.
+     *
+     * With a ServoFeedback that has angle sensors the turret counts as settled once the measured angles are
+     * within tolerance of the target, instead of settleMs after the last step, and the measured response
+     * times are reported to it. Without a fresh sample it falls back to settleMs. A closed limit switch
+     * stops the axis moving further towards it, the target is then never reached.
+     */
+    class MotionController
+    {
+    public:
+        MotionController(ServoHandler& xServo, ServoHandler& yServo, MotionLimits limits,
+                         std::pair<double, double> position, std::function<void()> onArrival,
+                         const std::string& name = "control", ServoFeedback* feedback = nullptr);
+        ~MotionController();
+
+        MotionController(const MotionController&) = delete;
+        MotionController& operator=(const MotionController&) = delete;
+
+        void SetTarget(std::pair<double, double> target);
+
+        /**
+         * @brief Drops the current motion and takes the given pose as the actual position (e.g. after an emergency park).
+         */
+        void Reset(std::pair<double, double> position);
+
+        /**
+         * @brief Requests the arrival callback for the current target. A later target cancels it.
+         */
+        void Arm();
+        void Disarm();
+        bool IsArmed() const;
+
+        std::pair<double, double> GetPosition() const;
+        std::pair<double, double> GetTarget() const;
+        bool IsOnTarget() const;
+        bool IsWithinTolerance(std::pair<double, double> target) const;
+        std::chrono::steady_clock::time_point EstimatedArrival() const;
+        /**
+         * @brief Travel and settle time from the current position to the given target, assuming the turret is at rest.
+         *        The settle time is the measured one once the feedback confirmed a target.
+         */
+        double EstimateTravelMs(std::pair<double, double> target) const;
+
+    private:
+        struct Axis
+        {
+            double position;
+            double velocity;
+        };
+
+        void ThreadFunc();
+        void Step(Axis& axis, double target, double dt) const;
+        // Holds the axis when the limit switch it is moving towards is closed
+        bool Blocked(Axis& axis, double target, FeedbackAxis feedbackAxis) const;
+        double TimeToReach(const Axis& axis, double target) const;
+
+        static uint64_t Pack(std::pair<double, double> value);
+        static std::pair<double, double> Unpack(uint64_t value);
+
+        ServoHandler& xServo_;
+        ServoHandler& yServo_;
+        MotionLimits limits_;
+        std::function<void()> onArrival_;
+        ServoFeedback* feedback_;
+
+        std::atomic<uint64_t> mailbox_;
+        std::atomic<uint64_t> resetMailbox_;
+        std::atomic<bool> resetPending_;
+        std::atomic<bool> armed_;
+        std::atomic<uint64_t> armedFor_;
+
+        std::atomic<uint64_t> position_;
+        std::atomic<uint64_t> settledFor_;      ///< Target the turret settled on, compared against the mailbox
+        std::atomic<int64_t> arrivalNs_;
+        std::atomic<double> settleEstimateMs_;  ///< limits_.settleMs until the feedback measured one
+
+        WatchdogChannel watchdog_;
+        std::atomic<bool> running_;
+        std::thread thread_;
+    };
+}
@@ -3,6 +3,19 @@
 #include "../AimHandler/AimHandler.h"
 #include "../Logger/Logger.h"
 #include "../DbHandler/DbHandler.h"
+#include "../ExternalConfigsHelper/ExternalConfigsHelper.h"
+#include "../IncidentRecorder/IncidentRecorder.h"
+#include "../TargetVerifier/TargetVerifier.h"
+#include "../SafetyTrace/SafetyTrace.h"
+#include "../ExceptionExtensions/ExceptionExtensions.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <filesystem>
+#include <cmath>
+#include <limits>
+#include <fmt/ranges.h>
 namespace DebuggerInfrastructure
 {
     std::string NeuralNetworkHandler::names[3] = {"Person", "Pet", "Insect"};
@@ -10,156 +23,635 @@ namespace DebuggerInfrastructure
     std::thread                                     NeuralNetworkHandler::worker_;
     std::atomic<bool>                               NeuralNetworkHandler::running_{false};
     ncnn::Net                                       NeuralNetworkHandler::yolo_;
-    cv::VideoCapture                                NeuralNetworkHandler::cap_;
-    std::mutex                                      NeuralNetworkHandler::frameMutex_;
-    cv::Mat                                         NeuralNetworkHandler::latestFrame_;
+    std::shared_future<void>                        NeuralNetworkHandler::modelReady_;
+    int                                             NeuralNetworkHandler::inputIndex_ = -1;
+    int                                             NeuralNetworkHandler::outputIndex_ = -1;
+    void*                                           NeuralNetworkHandler::weights_ = nullptr;
+    size_t                                          NeuralNetworkHandler::weightsSize_ = 0;
+    std::vector<std::unique_ptr<NeuralNetworkHandler::Camera>> NeuralNetworkHandler::cameras_;
+    std::mutex                                      NeuralNetworkHandler::queueMutex_;
+    std::condition_variable                         NeuralNetworkHandler::queueCv_;
+    bool                                            NeuralNetworkHandler::needsResolving_ = false;
+    WatchdogChannel                                 NeuralNetworkHandler::inferenceWatchdog_ = SIZE_MAX;
     const std::chrono::duration                     shootingSustain = std::chrono::nanoseconds(1000*1000*1000);
+    constexpr int                                   inputSize = 512;
+
+    namespace
+    {
+        // Counts events and turns them into a rate once per second
+        struct RateMeter
+        {
+            std::chrono::steady_clock::time_point windowStart = std::chrono::steady_clock::now();
+            uint64_t count = 0;
+
+            void Tick(std::atomic<double>& rate)
+            {
+                count++;
+                auto now = std::chrono::steady_clock::now();
+                double elapsed = std::chrono::duration<double>(now - windowStart).count();
+                if (elapsed >= 1.0) {
+                    rate.store(double(count) / elapsed);
+                    count = 0;
+                    windowStart = now;
+                }
+            }
+        };
+    }
+
+    void NeuralNetworkHandler::Preload(const char* paramPath, const char* binPath) {
+        if (modelReady_.valid()) {
+            Logger::Info("NeuralNetworkHandler model is already loading or loaded.");
+            return;
+        }
+        modelReady_ = std::async(std::launch::async, &NeuralNetworkHandler::LoadModel,
+                                 std::string(paramPath), std::string(binPath)).share();
+    }
 
     void NeuralNetworkHandler::Initialize(const char* paramPath, const char* binPath) {
-        cap_.open("libcamerasrc af-mode=continuous ! video/x-raw,width=1024,height=1024,framerate=30/1,format=NV12 ! "
-                "videoconvert ! appsink", cv::CAP_GSTREAMER);
-        yolo_.opt.num_threads = 4;
-        yolo_.load_param(paramPath);
-        yolo_.load_model(binPath);
+        Preload(paramPath, binPath);
+        TargetVerifier::Initialize(ExternalConfigsHelper::getOrCreateVerifierSettings());
+
+        RegionSettings defaultRegions = ExternalConfigsHelper::getOrCreateRegionSettings();
+        std::vector<CameraSettings> settings = ExternalConfigsHelper::getOrCreateCameraSettings();
+        // A turret aims in the frame of the camera it serves, its fire zone is that camera's regions
+        std::unordered_map<size_t, size_t> zoneOwners;
+        for (size_t i = 0; i < settings.size(); i++) {
+            auto camera = std::make_unique<Camera>();
+            camera->id = i;
+            camera->settings = settings[i];
+            RegionSettings regions = settings[i].regions.value_or(defaultRegions);
+            camera->regionMask = RegionMask(regions);
+            try {
+                camera->plan.emplace(inputSize, camera->settings.protectedScanInput, camera->settings.protectedScanEvery);
+            } catch (const std::invalid_argument& ex) {
+                throw std::runtime_error(fmt::format("Camera {}: {}", i, ex.what()));
+            }
+            if (!camera->regionMask.IsFullFrame()) {
+                Logger::Info("Camera {} infers its regions of interest, protected entities outside them are looked for at {}x{} "
+                             "every {} frame(s) and lock the lasers up to that much later", i, camera->settings.protectedScanInput,
+                             camera->settings.protectedScanInput, camera->settings.protectedScanEvery);
+            }
+            if (camera->settings.turrets.empty()) {
+                throw std::runtime_error(fmt::format("Camera {} is not mapped to any turret", i));
+            }
+            for (size_t turret : camera->settings.turrets) {
+                if (turret >= AimHandler::Count()) {
+                    throw std::runtime_error(fmt::format("Camera {} is mapped to turret {}, which does not exist", i, turret));
+                }
+                auto [owner, first] = zoneOwners.emplace(turret, i);
+                if (!first && settings[owner->second].regions.value_or(defaultRegions) != regions) {
+                    throw std::runtime_error(fmt::format("Turret {} is shared by cameras {} and {}, which have different regions",
+                                                         turret, owner->second, i));
+                }
+                AimHandler::Get(turret).SetFireZone(camera->regionMask);
+            }
+            camera->engagements.resize(camera->settings.turrets.size());
+            camera->assigned.resize(camera->settings.turrets.size());
+            OpenCamera(*camera);
+            camera->watchdog = Watchdog::Register(fmt::format("capture {}", i), WatchdogStage::Capture);
+            cameras_.push_back(std::move(camera));
+        }
+        inferenceWatchdog_ = Watchdog::Register("inference", WatchdogStage::Inference);
+
         running_ = true;
+        for (auto& camera : cameras_) {
+            camera->thread = std::thread(&NeuralNetworkHandler::CaptureFunc, std::ref(*camera));
+        }
         worker_ = std::thread(&NeuralNetworkHandler::ThreadFunc);
     }
 
     void NeuralNetworkHandler::Dispose() {
         running_ = false;
+        queueCv_.notify_all();
         if (worker_.joinable()) worker_.join();
-        cap_.release();
+        for (auto& camera : cameras_) {
+            if (camera->thread.joinable()) camera->thread.join();
+            camera->cap.release();
+            Watchdog::Unregister(camera->watchdog);
+        }
+        cameras_.clear();
+        Watchdog::Unregister(inferenceWatchdog_);
+        inferenceWatchdog_ = SIZE_MAX;
+        TargetVerifier::Dispose();
+        if (modelReady_.valid()) {
+            modelReady_.wait();
+            modelReady_ = {};
+        }
+        yolo_.clear();
+        UnmapWeights();
     }
 
-    void NeuralNetworkHandler::ThreadFunc() {
-        const float mean_vals[3] = {0.f, 0.f, 0.f};
-        const float norm_vals[3] = {1 / 255.f, 1 / 255.f, 1 / 255.f};
-        const float score_threshold = 0.40f;
-        bool needsResolving = false;
-        cv::Scalar boxColor(0, 255, 0);
-        cv::Scalar textColor(0, 0, 255);
-        int fontFace = cv::FONT_HERSHEY_SIMPLEX;
-        double fontScale = 0.5;
-        int thickness = 1;
-        int clsId = -1;
+    cv::Mat NeuralNetworkHandler::GetLatestFrame(size_t cameraId) {
+        if (cameraId >= cameras_.size()) return cv::Mat();
+        Camera& camera = *cameras_[cameraId];
+        std::lock_guard<std::mutex> lock(camera.frameMutex);
+        return camera.latestFrame.clone();
+    }
 
-        cv::Mat frame;
+    cv::Mat NeuralNetworkHandler::GetLatestRawFrame(size_t cameraId, uint64_t& sequence) {
+        sequence = 0;
+        if (cameraId >= cameras_.size()) return cv::Mat();
+        Camera& camera = *cameras_[cameraId];
+        std::lock_guard<std::mutex> lock(camera.frameMutex);
+        sequence = camera.rawSequence;
+        return camera.rawFrame;
+    }
 
-        while (running_) {
-            if (!cap_.read(frame) || frame.empty()) continue;
-            cv::flip(frame, frame, -1);
+    size_t NeuralNetworkHandler::GetCameraCount() {
+        return cameras_.size();
+    }
 
-            int ih = frame.rows, iw = frame.cols;
-            int len = std::max(ih, iw);
-            float scale = float(len) / 512.f;
+    std::vector<CameraStats> NeuralNetworkHandler::GetCameraStats() {
+        std::vector<CameraStats> stats;
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        for (const auto& camera : cameras_) {
+            stats.push_back(CameraStats{
+                camera->id,
+                camera->settings.turrets,
+                camera->captureFps.load(),
+                camera->inferenceFps.load(),
+                camera->queue.size(),
+                camera->droppedFrames.load(),
+                camera->staleFrames.load(),
+                camera->lastLatencyMs.load(),
+                camera->engagedTargets.load(),
+                camera->lostTargets.load(),
+                camera->engagedPerMinute.load(),
+                camera->inputPixelsPerFrame.load()
+            });
+        }
+        return stats;
+    }
 
-            cv::Mat square(len, len, CV_8UC3, cv::Scalar(0, 0, 0));
-            frame.copyTo(square(cv::Rect(0, 0, iw, ih)));
+    void NeuralNetworkHandler::OpenCamera(Camera& camera) {
+        const std::string& source = camera.settings.source;
+        bool opened;
+        if (source.find('!') != std::string::npos) {
+            opened = camera.cap.open(source, cv::CAP_GSTREAMER);
+        } else if (!source.empty() && std::all_of(source.begin(), source.end(), ::isdigit)) {
+            opened = camera.cap.open(std::stoi(source), cv::CAP_V4L2);
+        } else {
+            // Anything else is a recording, replayed at its own frame rate
+            opened = camera.cap.open(source, cv::CAP_ANY);
+            camera.replay = true;
+        }
+        if (!opened) {
+            Logger::Error("Camera {} could not be opened from \"{}\"", camera.id, source);
+        } else {
+            Logger::Info("Camera {} opened from \"{}\" for turret(s) {}", camera.id, source, fmt::join(camera.settings.turrets, ", "));
+        }
+    }
+
+    void NeuralNetworkHandler::LoadModel(std::string paramPath, std::string binPath) {
+        auto start = std::chrono::steady_clock::now();
+        yolo_.opt.num_threads = 4;
+
+        // The binary blob skips text parsing, but carries no blob names, so blobs are addressed by index below.
+        std::string paramBinPath = paramPath + ".bin";
+        if (std::filesystem::exists(paramBinPath)) {
+            if (yolo_.load_param_bin(paramBinPath.c_str()) != 0)
+                throw std::runtime_error("Failed to load binary model params from " + paramBinPath);
+        } else {
+            Logger::Warning("Binary params {} not found, falling back to text params {}", paramBinPath, paramPath);
+            if (yolo_.load_param(paramPath.c_str()) != 0)
+                throw std::runtime_error("Failed to load model params from " + paramPath);
+        }
+
+        MapWeights(binPath);
+        if (yolo_.load_model(static_cast<const unsigned char*>(weights_)) == 0)
+            throw std::runtime_error("Failed to load model weights from " + binPath);
 
-            cv::Mat rgb;
-            cv::cvtColor(square, rgb, cv::COLOR_BGR2RGB);
+        if (yolo_.input_indexes().empty() || yolo_.output_indexes().empty())
+            throw std::runtime_error("Model has no input or output blobs");
+        inputIndex_ = yolo_.input_indexes()[0];
+        outputIndex_ = yolo_.output_indexes()[0];
 
-            ncnn::Mat in = ncnn::Mat::from_pixels_resize(
-                rgb.data, ncnn::Mat::PIXEL_RGB, len, len, 512, 512);
-            in.substract_mean_normalize(mean_vals, norm_vals);
+        auto loaded = std::chrono::steady_clock::now();
+        Logger::Info("Model loaded in {} ms", std::chrono::duration<double, std::milli>(loaded - start).count());
 
-            ncnn::Extractor ex = yolo_.create_extractor();
-            if (ex.input("in0", in) != 0) continue;
+        WarmUp();
+        Logger::Info("Model warm-up inference took {} ms",
+                     std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loaded).count());
+    }
+
+    void NeuralNetworkHandler::MapWeights(const std::string& binPath) {
+        int fd = open(binPath.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) throw std::runtime_error("Failed to open model weights " + binPath);
+
+        struct stat st {};
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            close(fd);
+            throw std::runtime_error("Failed to stat model weights " + binPath);
+        }
 
-            ncnn::Mat out;
-            if (ex.extract("out0", out) != 0) continue;
+        // ncnn references the weights in place, so the mapping has to live until Dispose.
+        void* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+        close(fd);
+        if (mapped == MAP_FAILED) throw std::runtime_error("Failed to mmap model weights " + binPath);
+        madvise(mapped, st.st_size, MADV_WILLNEED);
 
-            int num_channels = out.h;
-            int num_boxes = out.w;
+        weights_ = mapped;
+        weightsSize_ = st.st_size;
+    }
 
-            bool emergency = false;
-            bool aim = false;
-            float aimX = 0.f, aimY = 0.f;
+    void NeuralNetworkHandler::UnmapWeights() {
+        if (weights_ != nullptr) {
+            munmap(weights_, weightsSize_);
+            weights_ = nullptr;
+            weightsSize_ = 0;
+        }
+    }
 
-            std::vector<std::tuple<cv::Rect, std::string>> drawnBoxes;
+    void NeuralNetworkHandler::WarmUp() {
+        // Runs one inference on a blank frame so the first real frame does not pay for lazy allocations.
+        ncnn::Mat in(inputSize, inputSize, 3);
+        in.fill(0.f);
+        ncnn::Extractor ex = yolo_.create_extractor();
+        ncnn::Mat out;
+        if (ex.input(inputIndex_, in) != 0 || ex.extract(outputIndex_, out) != 0)
+            throw std::runtime_error("Model warm-up inference failed");
+    }
 
-            for (int j = 0; j < num_boxes; j++) {
-                const float* r0 = out.row(0);
-                const float* r1 = out.row(1);
-                const float* r2 = out.row(2);
-                const float* r3 = out.row(3);
-                float cx = r0[j], cy = r1[j], w = r2[j], h = r3[j];
+    cv::Rect NeuralNetworkHandler::CropRect(const RegionMask& regionMask, int width, int height) {
+        NormalizedRect bounds = regionMask.BoundingBox();
+        int x0 = std::clamp(int(bounds.x0 * width), 0, width - 1);
+        int y0 = std::clamp(int(bounds.y0 * height), 0, height - 1);
+        int x1 = std::clamp(int(std::ceil(bounds.x1 * width)), x0 + 1, width);
+        int y1 = std::clamp(int(std::ceil(bounds.y1 * height)), y0 + 1, height);
+        return cv::Rect(x0, y0, x1 - x0, y1 - y0);
+    }
+
+    void NeuralNetworkHandler::CaptureFunc(Camera& camera) {
+        RateMeter rate;
+        double replayFps = camera.replay ? camera.cap.get(cv::CAP_PROP_FPS) : 0.0;
+        auto replayInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(replayFps > 0.0 ? 1.0 / replayFps : 0.0));
+        auto nextReplay = std::chrono::steady_clock::now();
+
+        while (running_) {
+            cv::Mat frame;
+            if (!camera.cap.read(frame) || frame.empty()) {
+                if (camera.replay) {
+                    camera.cap.set(cv::CAP_PROP_POS_FRAMES, 0);
+                } else {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                }
+                continue;
+            }
+            auto captured = std::chrono::steady_clock::now();
+            Watchdog::Heartbeat(camera.watchdog);
+            if (camera.settings.flip) cv::flip(frame, frame, -1);
+            {
+                std::lock_guard<std::mutex> lock(camera.frameMutex);
+                camera.rawFrame = frame;
+                camera.rawSequence++;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(queueMutex_);
+                if (camera.queue.size() >= maxQueueDepth) {
+                    camera.queue.pop_front();
+                    camera.droppedFrames++;
+                }
+                camera.queue.push_back(QueuedFrame{std::move(frame), captured});
+            }
+            queueCv_.notify_one();
+            rate.Tick(camera.captureFps);
+
+            if (camera.replay && replayFps > 0.0) {
+                nextReplay += replayInterval;
+                nextReplay = std::max(nextReplay, std::chrono::steady_clock::now());
+                std::this_thread::sleep_until(nextReplay);
+            }
+        }
+    }
 
-                int best_cls = -1;
-                float best_score = 0.f;
-                for (int c = 4; c < num_channels; c++) {
-                    float s = out.row(c)[j];
-                    if (s > best_score) {
-                        best_score = s;
-                        best_cls = c - 4;
+    bool NeuralNetworkHandler::NextFrame(size_t& cursor, Camera*& camera, QueuedFrame& frame) {
+        // Round robin over the cameras, starting after the one served last, so a fast camera cannot starve the others
+        std::unique_lock<std::mutex> lock(queueMutex_);
+        while (running_) {
+            auto now = std::chrono::steady_clock::now();
+            for (size_t k = 0; k < cameras_.size(); k++) {
+                Camera& candidate = *cameras_[(cursor + k) % cameras_.size()];
+                while (!candidate.queue.empty()) {
+                    QueuedFrame queued = std::move(candidate.queue.front());
+                    candidate.queue.pop_front();
+                    // A late frame is skipped only when a fresher one is waiting behind it
+                    auto age = std::chrono::duration<double, std::milli>(now - queued.captured).count();
+                    if (age > candidate.settings.maxLatencyMs && !candidate.queue.empty()) {
+                        candidate.staleFrames++;
+                        continue;
                     }
+                    cursor = (candidate.id + 1) % cameras_.size();
+                    camera = &candidate;
+                    frame = std::move(queued);
+                    return true;
                 }
-                if (best_score < score_threshold) continue;
+            }
+            queueCv_.wait_for(lock, std::chrono::milliseconds(100));
+        }
+        return false;
+    }
 
-                float x0 = (cx - w * 0.5f) * scale;
-                float y0 = (cy - h * 0.5f) * scale;
-                float x1 = (cx + w * 0.5f) * scale;
-                float y1 = (cy + h * 0.5f) * scale;
+    void NeuralNetworkHandler::ThreadFunc() {
+        try {
+            modelReady_.get();
+        } catch (const std::exception& ex) {
+            Logger::Critical("Model could not be loaded, vision thread is not started: {}", ex.what());
+            running_ = false;
+            return;
+        }
+        if (cameras_.empty()) {
+            Logger::Critical("No cameras configured, vision thread is not started");
+            return;
+        }
 
-                aimX = cx / 512.f;
-                aimY = cy / 512.f;
+        std::vector<RateMeter> rates(cameras_.size());
+        bool firstInference = true;
+        size_t cursor = 0;
+        Camera* camera = nullptr;
+        QueuedFrame queued;
 
-                if (best_cls >= 0 && best_cls < 3) {
-                    cv::Rect box = cv::Rect(cv::Point(int(x0), int(y0)), cv::Point(int(x1), int(y1)));
-                    drawnBoxes.emplace_back(box, names[best_cls]);
+        while (NextFrame(cursor, camera, queued)) {
+            // A frame that fails is dropped, the vision thread goes on with the next one. If they all fail the
+            // inference heartbeat stops and the watchdog locks the lasers
+            try {
+                const cv::Mat& frame = queued.frame;
+                cv::Rect crop = CropRect(camera->regionMask, frame.cols, frame.rows);
 
-                    if (best_cls <= 1) {
-                        emergency = true;
-                        aim = false;
-                        clsId = best_cls;
-                        break;
+                auto inferenceStart = std::chrono::steady_clock::now();
+                FramePlan plan = camera->plan->Next(frame.size(), crop);
+                Detections detections;
+                if (!Detect(*camera, frame, crop, plan.cropInput, detections)) continue;
+                if (crop.size() != frame.size()) {
+                    // The crop misses whoever stands outside the regions
+                    if (plan.scan) {
+                        Detections outside;
+                        if (!Detect(*camera, frame, cv::Rect(0, 0, frame.cols, frame.rows), plan.scanInput, outside, true)) continue;
+                        camera->outsideCrop = std::move(outside);
                     }
+                    const Detections& outside = camera->outsideCrop;
+                    if (outside.emergency && !detections.emergency) {
+                        detections.emergency = true;
+                        detections.aim = false;
+                        detections.clsId = outside.clsId;
+                        detections.aimX = outside.aimX;
+                        detections.aimY = outside.aimY;
+                        detections.boxes.insert(detections.boxes.end(), outside.boxes.begin(), outside.boxes.end());
+                    }
+                }
+                auto inferenceEnd = std::chrono::steady_clock::now();
+                if (firstInference) {
+                    Logger::Info("First inference took {} ms",
+                        std::chrono::duration<double, std::milli>(inferenceEnd - inferenceStart).count());
+                    firstInference = false;
+                }
+                camera->lastLatencyMs.store(std::chrono::duration<double, std::milli>(inferenceEnd - queued.captured).count());
+                camera->inputPixelsPerFrame.store(camera->plan->AveragePixels());
+                rates[camera->id].Tick(camera->inferenceFps);
+
+                camera->tracker.Update(detections.insects, inferenceEnd);
+                TargetVerifier::VerifyPending(frame, camera->tracker.Tracks());
+
+                Decide(*camera, detections, queued.captured, inferenceEnd);
+                Watchdog::Heartbeat(inferenceWatchdog_);
+                Publish(*camera, frame, crop, detections, inferenceEnd);
+            } catch (const std::exception& ex) {
+                Logger::Error("Camera {} frame dropped: {}", camera->id, ex.what());
+            }
+        }
+    }
 
-                    aim = true;
-                    clsId = best_cls;
+    bool NeuralNetworkHandler::Detect(Camera& camera, const cv::Mat& frame, const cv::Rect& crop, int netInput, Detections& detections,
+                                      bool protectedOnly) {
+        const float mean_vals[3] = {0.f, 0.f, 0.f};
+        const float norm_vals[3] = {1 / 255.f, 1 / 255.f, 1 / 255.f};
+        const float score_threshold = 0.40f;
+
+        // Only the crop is fed to the net, the bounding box of the regions of interest or the whole frame,
+        // letterboxed to a square of netInput
+        int ih = frame.rows, iw = frame.cols;
+        int len = std::max(crop.width, crop.height);
+        float scale = float(len) / float(netInput);
+
+        cv::Mat square(len, len, CV_8UC3, cv::Scalar(0, 0, 0));
+        frame(crop).copyTo(square(cv::Rect(0, 0, crop.width, crop.height)));
+
+        cv::Mat rgb;
+        cv::cvtColor(square, rgb, cv::COLOR_BGR2RGB);
+
+        ncnn::Mat in = ncnn::Mat::from_pixels_resize(
+            rgb.data, ncnn::Mat::PIXEL_RGB, len, len, netInput, netInput);
+        in.substract_mean_normalize(mean_vals, norm_vals);
+
+        ncnn::Extractor ex = yolo_.create_extractor();
+        if (ex.input(inputIndex_, in) != 0) return false;
+
+        ncnn::Mat out;
+        if (ex.extract(outputIndex_, out) != 0) return false;
+
+        int num_channels = out.h;
+        int num_boxes = out.w;
+
+        for (int j = 0; j < num_boxes; j++) {
+            const float* r0 = out.row(0);
+            const float* r1 = out.row(1);
+            const float* r2 = out.row(2);
+            const float* r3 = out.row(3);
+            float cx = r0[j], cy = r1[j], w = r2[j], h = r3[j];
+
+            int best_cls = -1;
+            float best_score = 0.f;
+            for (int c = 4; c < num_channels; c++) {
+                float s = out.row(c)[j];
+                if (s > best_score) {
+                    best_score = s;
+                    best_cls = c - 4;
                 }
             }
+            if (best_score < score_threshold) continue;
+
+            float x0 = crop.x + (cx - w * 0.5f) * scale;
+            float y0 = crop.y + (cy - h * 0.5f) * scale;
+            float x1 = crop.x + (cx + w * 0.5f) * scale;
+            float y1 = crop.y + (cy + h * 0.5f) * scale;
+
+            float pointX = (crop.x + cx * scale) / float(iw);
+            float pointY = (crop.y + cy * scale) / float(ih);
+
+            // Insects outside the regions are not engaged. Protected entities are kept anywhere in the crop,
+            // ThreadFunc looks for them in the rest of the frame
+            if (best_cls == 2 && (protectedOnly || !camera.regionMask.IsAllowed(pointX, pointY))) continue;
+
+            detections.aimX = pointX;
+            detections.aimY = pointY;
 
-            std::string name = clsId >= 0 && clsId <3? names[clsId] : "UNKNOWN";
-            
-            if (emergency) {
-                std::string msg = fmt::format("Protected entity was detected: {}: X({}) Y({})", name, aimX, aimY);
-                Logger::Info(msg);
-                if(!DeadLocker::lockReasons.contains(NAMEOF(NeuralNetworkHandler)))
-                {
-                    DbHandler::InsertDataNow(EMERGENCYADDLOCKREASON, NAMEOF(NeuralNetworkHandler), msg);
-                    DeadLocker::EmergencyInitiate(NAMEOF(NeuralNetworkHandler));
-                    needsResolving = true;
+            if (best_cls >= 0 && best_cls < 3) {
+                cv::Rect box = cv::Rect(cv::Point(int(x0), int(y0)), cv::Point(int(x1), int(y1)));
+
+                if (best_cls <= 1) {
+                    detections.boxes.emplace_back(box, names[best_cls]);
+                    detections.emergency = true;
+                    detections.aim = false;
+                    detections.clsId = best_cls;
+                    break;
                 }
-            } else if(!AimHandler::IsCalibrationEnabled()) {
-                if (DeadLocker::IsLocked() && DeadLocker::lockReasons.contains(NAMEOF(NeuralNetworkHandler)) && needsResolving) {
+
+                detections.insects.push_back(Observation{pointX, pointY, box, best_score});
+                detections.aim = true;
+                detections.clsId = best_cls;
+            }
+        }
+        return true;
+    }
+
+    void NeuralNetworkHandler::Decide(Camera& camera, const Detections& detections, std::chrono::steady_clock::time_point captured,
+                                      std::chrono::steady_clock::time_point now) {
+        int clsId = detections.clsId;
+        float aimX = detections.aimX, aimY = detections.aimY;
+
+        std::vector<const Track*> targets = Assign(camera, now);
+        bool aim = detections.aim && std::any_of(targets.begin(), targets.end(), [](const Track* t) { return t != nullptr; });
+        std::string name = clsId >= 0 && clsId <3? names[clsId] : "UNKNOWN";
+        camera.protectedVisible = detections.emergency;
+
+        if (detections.emergency) {
+            // A reason that is already recovering counts as new, or its countdown unlocks with the entity in view
+            bool newReason = !DeadLocker::HasReason(LockReason::NeuralNetworkHandler) || !needsResolving_;
+            if(newReason)
+            {
+                // Cut first, the message, the clip and the records come after the laser is off
+                SafetyTrace::Scope trace(LockReason::NeuralNetworkHandler, captured);
+                SafetyTrace::Mark(TraceHop::Detected, now);
+                DeadLocker::EmergencyInitiate(LockReason::NeuralNetworkHandler);
+                needsResolving_ = true;
+            }
+            std::string msg = fmt::format("Protected entity was detected by camera {}: {}: X({}) Y({})", camera.id, name, aimX, aimY);
+            Logger::Info(msg);
+            if(newReason)
+            {
+                std::string clip = IncidentRecorder::Trigger(msg);
+                DbHandler::InsertDataNow(EMERGENCYADDLOCKREASON, NAMEOF(NeuralNetworkHandler), msg, clip);
+            }
+        } else if(!AimHandler::IsCalibrationEnabled()) {
+            bool anyProtectedVisible = std::any_of(cameras_.begin(), cameras_.end(),
+                                                   [](const auto& c) { return c->protectedVisible; });
+            if (DeadLocker::IsLocked() && DeadLocker::HasReason(LockReason::NeuralNetworkHandler) && needsResolving_) {
+                if (!anyProtectedVisible) {
                     DbHandler::InsertDataNow(EMERGENCYREMOVELOCKREASON, NAMEOF(NeuralNetworkHandler), "All protected entities exited the camera view");
-                    DeadLocker::Recover(NAMEOF(NeuralNetworkHandler));
-                    needsResolving = false;
-                } else if (aim && !DeadLocker::IsLocked()) {
-                    std::string msg = fmt::format("An {} was detected at X({}) Y({}). Eliminating.", name, aimX, aimY);
-                    if(std::chrono::_V2::system_clock::now() - AimHandler::GetLastShoot() > shootingSustain)
-                    {
-                        DbHandler::InsertDataNow(ELIMINATION, NAMEOF(NeuralNetworkHandler), msg);
+                    DeadLocker::Recover(LockReason::NeuralNetworkHandler);
+                    needsResolving_ = false;
+                }
+            } else {
+                for (size_t slot = 0; slot < targets.size(); slot++) {
+                    AimHandler& turret = AimHandler::Get(camera.settings.turrets[slot]);
+                    const Track* target = aim ? targets[slot] : nullptr;
+                    // A refusal (outside the fire zone, servos locked since the check above) only skips this turret
+                    try {
+                        if (target != nullptr && !DeadLocker::IsLocked()) {
+                            std::string msg = fmt::format("An {} was detected by camera {} at X({}) Y({}). Turret {} is eliminating it.",
+                                                          names[2], camera.id, target->x, target->y, turret.Id());
+                            if(std::chrono::_V2::system_clock::now() - turret.GetLastShoot() > shootingSustain)
+                            {
+                                std::string clip = IncidentRecorder::Trigger(msg);
+                                DbHandler::InsertDataNow(ELIMINATION, NAMEOF(NeuralNetworkHandler), msg, clip);
+                            }
+                            std::string response = turret.ShootAt({target->x, target->y});
+                            Logger::Info(response);
+                        } else if(std::chrono::_V2::system_clock::now() - turret.GetLastShoot() > shootingSustain && turret.IsEngaged()) {
+                            std::string response = turret.Disarm();
+                            Logger::Info(response);
+                        }
+                    } catch (const BadRequestException& ex) {
+                        Logger::Warning("Turret {} did not engage: {}", turret.Id(), ex.what());
                     }
-                    std::string response = AimHandler::ShootAt({aimX, aimY});
-                    Logger::Info(response);
-                } else if(std::chrono::_V2::system_clock::now() - AimHandler::GetLastShoot() > shootingSustain && AimHandler::IsLaserEnabled()) {
-                    std::string response = AimHandler::Disarm();
-                    Logger::Info(response);
                 }
             }
+        }
+    }
 
-            cv::Mat drawn = frame.clone();
-            for (const auto& [box, label] : drawnBoxes) {
-                cv::rectangle(drawn, box, boxColor, 2);
-                cv::putText(drawn, label, box.tl(), fontFace, fontScale, textColor, thickness);
-            }
+    std::vector<const Track*> NeuralNetworkHandler::Assign(Camera& camera, std::chrono::steady_clock::time_point now) {
+        const auto& tracks = camera.tracker.Tracks();
+        const size_t slots = camera.engagements.size();
+        std::erase_if(camera.assignments, [&](const auto& entry) {
+            return std::none_of(tracks.begin(), tracks.end(), [&](const Track& track) { return track.id == entry.first; });
+        });
 
-            {
-                std::lock_guard<std::mutex> lock(frameMutex_);
-                latestFrame_ = std::move(drawn);
+        // A new confirmed track goes to the turret that reaches it first, counting the targets already queued there.
+        // Once assigned it stays with that turret, so two turrets never chase the same insect.
+        std::vector<size_t> backlog(slots, 0);
+        for (const auto& [id, slot] : camera.assignments) {
+            if (!camera.engagements[slot].IsRetired(id)) backlog[slot]++;
+        }
+        for (const auto& track : tracks) {
+            if (track.verification != Verification::Confirmed || camera.assignments.contains(track.id)) continue;
+            size_t best = 0;
+            double bestEta = std::numeric_limits<double>::max();
+            for (size_t slot = 0; slot < slots; slot++) {
+                double dwellMs = double(camera.engagements[slot].Dwell().count());
+                double eta = double(backlog[slot]) * dwellMs +
+                             AimHandler::Get(camera.settings.turrets[slot]).EstimateTravelMs({track.x, track.y});
+                if (eta < bestEta) {
+                    bestEta = eta;
+                    best = slot;
+                }
             }
+            camera.assignments[track.id] = best;
+            backlog[best]++;
+        }
+
+        for (auto& assigned : camera.assigned) assigned.clear();
+        for (const auto& track : tracks) {
+            auto it = camera.assignments.find(track.id);
+            if (it != camera.assignments.end()) camera.assigned[it->second].push_back(track);
+        }
+
+        std::vector<const Track*> targets(slots, nullptr);
+        EngagementStats total;
+        for (size_t slot = 0; slot < slots; slot++) {
+            bool firing = AimHandler::Get(camera.settings.turrets[slot]).IsLaserEnabled();
+            targets[slot] = camera.engagements[slot].Next(camera.assigned[slot], firing, now);
+            EngagementStats stats = camera.engagements[slot].Stats(now);
+            total.engaged += stats.engaged;
+            total.lost += stats.lost;
+            total.engagedPerMinute += stats.engagedPerMinute;
+        }
+        camera.engagedTargets.store(total.engaged);
+        camera.lostTargets.store(total.lost);
+        camera.engagedPerMinute.store(total.engagedPerMinute);
+        return targets;
+    }
+
+    void NeuralNetworkHandler::Publish(Camera& camera, const cv::Mat& frame, const cv::Rect& crop, const Detections& detections,
+                                       std::chrono::steady_clock::time_point now) {
+        const cv::Scalar boxColor(0, 255, 0);
+        const cv::Scalar pendingColor(0, 255, 255);
+        const cv::Scalar rejectedColor(128, 128, 128);
+        const cv::Scalar textColor(0, 0, 255);
+        const cv::Scalar regionColor(255, 0, 0);
+        const int fontFace = cv::FONT_HERSHEY_SIMPLEX;
+        const double fontScale = 0.5;
+        const int thickness = 1;
+
+        cv::Mat drawn = frame.clone();
+        if (!camera.regionMask.IsFullFrame()) {
+            cv::rectangle(drawn, crop, regionColor, 1);
+        }
+        for (const auto& [box, label] : detections.boxes) {
+            cv::rectangle(drawn, box, boxColor, 2);
+            cv::putText(drawn, label, box.tl(), fontFace, fontScale, textColor, thickness);
+        }
+        for (const auto& track : camera.tracker.Tracks()) {
+            if (track.lastSeen != now) continue;
+            const cv::Scalar& color = track.verification == Verification::Confirmed ? boxColor
+                                    : track.verification == Verification::Pending ? pendingColor : rejectedColor;
+            cv::rectangle(drawn, track.box, color, 2);
+            cv::putText(drawn, fmt::format("{} #{}", names[2], track.id), track.box.tl(), fontFace, fontScale, textColor, thickness);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(camera.frameMutex);
+            camera.latestFrame = std::move(drawn);
         }
     }
-}
\ No newline at end of file
+}
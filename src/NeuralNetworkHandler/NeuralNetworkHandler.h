@@ -5,32 +5,161 @@
 #include <thread>
 #include <atomic>
 #include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <optional>
 #include <string>
+#include <vector>
+#include <unordered_map>
 #include <chrono>
+#include <future>
+#include "../RegionMask/RegionMask.h"
+#include "../TargetTracker/TargetTracker.h"
+#include "../EngagementScheduler/EngagementScheduler.h"
+#include "../InferencePlan/InferencePlan.h"
+#include "../Watchdog/Watchdog.h"
 namespace DebuggerInfrastructure
 {
     class DbHandler;
 
+    struct CameraSettings
+    {
+        // GStreamer pipeline (contains '!'), V4L2 device index, or a video file/URL which is replayed in a loop.
+        std::string source;
+        // Turrets calibrated to this camera's view, each target is handed to the one that reaches it first.
+        std::vector<size_t> turrets = {0};
+        bool flip = true;
+        // Frames older than this when the scheduler reaches them are dropped instead of inferred.
+        double maxLatencyMs = 150.0;
+        // Falls back to the top-level regions of interest when not set.
+        std::optional<RegionSettings> regions;
+        // Inference is cropped to the regions of interest, at a net input that shrinks with the crop, which hides
+        // protected entities standing outside them. The whole frame is inferred for them every this many frames at
+        // protectedScanInput: 1 costs a second inference per frame, more delays the lockout by someone outside the
+        // crop by up to that many frames (100 ms at 30 fps with the default).
+        size_t protectedScanEvery = InferencePlan::defaultScanEvery;
+        // Net input side of that scan, a multiple of 32. People and pets stay large enough at a low resolution.
+        int protectedScanInput = InferencePlan::defaultScanInput;
+    };
+
+    struct CameraStats
+    {
+        size_t id;
+        std::vector<size_t> turrets;
+        double captureFps;
+        double inferenceFps;
+        size_t queueDepth;
+        uint64_t droppedFrames;     ///< Overwritten in the queue before the scheduler reached them.
+        uint64_t staleFrames;       ///< Reached the scheduler after the latency target.
+        double lastLatencyMs;       ///< Capture to end of inference of the last processed frame.
+        uint64_t engagedTargets;    ///< Targets that received their full dwell.
+        uint64_t lostTargets;       ///< Targets lost before their dwell completed.
+        double engagedPerMinute;
+        double inputPixelsPerFrame;     ///< Net input pixels per processed frame, crop and protected scans together.
+    };
+
     class NeuralNetworkHandler {
     public:
+        // Starts loading the model in the background, so the rest of the core can initialize meanwhile.
+        // Prefers the binary param blob (<paramPath>.bin, generated by ncnn2mem at build time) and memory-maps the weights.
+        static void Preload(const char* paramPath, const char* binPath);
+        // Opens every camera from the config and starts the capture threads and the inference scheduler.
+        // Calls Preload itself if it was not called before.
         static void Initialize(const char* paramPath, const char* binPath);
         static void Dispose();
 
-        static inline cv::Mat GetLatestFrame()
-        {
-            std::lock_guard<std::mutex> lock(frameMutex_);
-            return latestFrame_.clone();
-        }
+        static cv::Mat GetLatestFrame(size_t cameraId = 0);
+        // Last captured frame without overlays (shared, do not draw on it) and its capture sequence number.
+        static cv::Mat GetLatestRawFrame(size_t cameraId, uint64_t& sequence);
+        static size_t GetCameraCount();
+        static std::vector<CameraStats> GetCameraStats();
 
     private:
+        struct QueuedFrame
+        {
+            cv::Mat frame;
+            std::chrono::steady_clock::time_point captured;
+        };
+
+        struct Detections
+        {
+            bool emergency = false;
+            bool aim = false;
+            int clsId = -1;
+            float aimX = 0.f;
+            float aimY = 0.f;
+            std::vector<std::tuple<cv::Rect, std::string>> boxes;  ///< Protected entities, insects are drawn from tracks.
+            std::vector<Observation> insects;
+        };
+
+        struct Camera
+        {
+            size_t id;
+            CameraSettings settings;
+            RegionMask regionMask;
+            cv::VideoCapture cap;
+            bool replay = false;
+            std::thread thread;
+            WatchdogChannel watchdog = SIZE_MAX;    ///< Capture heartbeat.
+
+            std::deque<QueuedFrame> queue;          ///< Guarded by queueMutex_, at most maxQueueDepth frames.
+            std::mutex frameMutex;
+            cv::Mat latestFrame;
+            cv::Mat rawFrame;
+            uint64_t rawSequence = 0;
+
+            bool protectedVisible = false;          ///< Only touched by the scheduler thread.
+            std::optional<InferencePlan> plan;      ///< Net inputs and full-frame looks for protected entities, scheduler thread only.
+            Detections outsideCrop;                 ///< Result of that look, scheduler thread only.
+            TargetTracker tracker;                  ///< Only touched by the scheduler thread.
+            std::vector<EngagementScheduler> engagements;           ///< One per entry of settings.turrets, scheduler thread only.
+            std::unordered_map<uint64_t, size_t> assignments;       ///< Track id to turret slot, scheduler thread only.
+            std::vector<std::vector<Track>> assigned;               ///< Per-slot scratch, scheduler thread only.
+            std::atomic<double> captureFps{0.0};
+            std::atomic<double> inferenceFps{0.0};
+            std::atomic<uint64_t> droppedFrames{0};
+            std::atomic<uint64_t> staleFrames{0};
+            std::atomic<double> lastLatencyMs{0.0};
+            std::atomic<uint64_t> engagedTargets{0};
+            std::atomic<uint64_t> lostTargets{0};
+            std::atomic<double> engagedPerMinute{0.0};
+            std::atomic<double> inputPixelsPerFrame{0.0};
+        };
+
+        static void CaptureFunc(Camera& camera);
         static void ThreadFunc();
+        static bool NextFrame(size_t& cursor, Camera*& camera, QueuedFrame& frame);
+        // protectedOnly - keeps the protected entities and drops the insects, for the full-frame look outside the crop
+        static bool Detect(Camera& camera, const cv::Mat& frame, const cv::Rect& crop, int netInput, Detections& detections,
+                           bool protectedOnly = false);
+        static void Decide(Camera& camera, const Detections& detections, std::chrono::steady_clock::time_point captured,
+                           std::chrono::steady_clock::time_point now);
+        static std::vector<const Track*> Assign(Camera& camera, std::chrono::steady_clock::time_point now);
+        static void Publish(Camera& camera, const cv::Mat& frame, const cv::Rect& crop, const Detections& detections,
+                            std::chrono::steady_clock::time_point now);
+        static void OpenCamera(Camera& camera);
+        static void LoadModel(std::string paramPath, std::string binPath);
+        static void MapWeights(const std::string& binPath);
+        static void UnmapWeights();
+        static void WarmUp();
+        static cv::Rect CropRect(const RegionMask& regionMask, int width, int height);
+
+        static constexpr size_t maxQueueDepth = 2;
 
         static std::string                                 names[3];
         static std::thread                                 worker_;
         static std::atomic<bool>                           running_;
         static ncnn::Net                                   yolo_;
-        static cv::VideoCapture                            cap_;
-        static std::mutex                                  frameMutex_;
-        static cv::Mat                                     latestFrame_;
+        static std::shared_future<void>                    modelReady_;
+        static int                                         inputIndex_;
+        static int                                         outputIndex_;
+        static void*                                       weights_;
+        static size_t                                      weightsSize_;
+        static std::vector<std::unique_ptr<Camera>>        cameras_;
+        static std::mutex                                  queueMutex_;
+        static std::condition_variable                     queueCv_;
+        static bool                                        needsResolving_;
+        static WatchdogChannel                             inferenceWatchdog_;
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,269 @@
+#include "PulseEngine.h"
+#include "../LaserHandler/LaserHandler.h"
+#include "../Logger/Logger.h"
+#include "../ExceptionExtensions/ExceptionExtensions.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+namespace DebuggerInfrastructure
+{
+    std::mutex                              PulseEngine::mtx_;
+    std::condition_variable                 PulseEngine::cv_;
+    std::thread                             PulseEngine::thread_;
+    bool                                    PulseEngine::running_ = false;
+    bool                                    PulseEngine::initialized_ = false;
+    PulseSettings                           PulseEngine::settings_;
+    std::vector<PulseEngine::Active>        PulseEngine::active_;
+    PulseStats                              PulseEngine::stats_;
+    uint64_t                                PulseEngine::edges_ = 0;
+    double                                  PulseEngine::latenessSumUs_ = 0.0;
+    double                                  PulseEngine::onErrorSumUs_ = 0.0;
+
+    // The first edge of a train is scheduled this far ahead, so it is timed like every other edge
+    constexpr int64_t startLeadNs = 1000 * 1000;
+    constexpr uint32_t maxPulsesPerTrain = 1000;
+
+    void PulseEngine::Initialize(PulseSettings settings, size_t turrets)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (initialized_) {
+            Logger::Info("PulseEngine already initialized");
+            return;
+        }
+        settings_ = settings;
+        active_.assign(turrets, Active{});
+        stats_ = PulseStats{};
+        edges_ = 0;
+        latenessSumUs_ = 0.0;
+        onErrorSumUs_ = 0.0;
+        running_ = true;
+        thread_ = std::thread(&PulseEngine::ThreadFunc);
+        initialized_ = true;
+        Logger::Info("PulseEngine initialized for {} laser(s), engagements {}", turrets,
+                     settings.engage ? fmt::format("fire {} x {} us every {} us", settings.train.count,
+                                                   settings.train.onTime.count(), settings.train.period.count())
+                                     : std::string("hold the laser on"));
+    }
+
+    void PulseEngine::Dispose()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            if (!initialized_) return;
+            running_ = false;
+        }
+        cv_.notify_all();
+        if (thread_.joinable()) thread_.join();
+
+        std::lock_guard<std::mutex> lock(mtx_);
+        for (size_t turret = 0; turret < active_.size(); turret++) {
+            if (active_[turret].running) LaserHandler::SetOutput(turret, false);
+        }
+        active_.clear();
+        initialized_ = false;
+        Logger::Info("Disposed of PulseEngine.");
+    }
+
+    std::string PulseEngine::Fire(size_t turret, PulseTrain train)
+    {
+        if (train.count == 0 || train.count > maxPulsesPerTrain)
+            throw BadRequestException(fmt::format("A pulse train has 1 to {} pulses.", maxPulsesPerTrain).c_str());
+        if (train.onTime.count() <= 0 || train.period < train.onTime)
+            throw BadRequestException("A pulse needs a positive on-time no longer than its period.");
+
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            if (!initialized_) throw std::runtime_error("PulseEngine not initialized, but Fire was called");
+            if (turret >= active_.size()) throw BadRequestException(fmt::format("There is no laser for turret {}.", turret).c_str());
+            if (LaserHandler::IsLocked()) throw BadRequestException("Laser is locked due to emergency => cannot fire.");
+            Active& active = active_[turret];
+            if (active.running) throw BadRequestException("Laser is firing a pulse train already.");
+            if (LaserHandler::IsEnabled(turret)) throw BadRequestException("Laser is enabled already.");
+
+            active = Active{};
+            active.running = true;
+            active.train = train;
+            active.startNs = MonotonicNs() + startLeadNs;
+            active.nextNs = active.startNs;
+        }
+        cv_.notify_all();
+        return fmt::format("Laser firing {} x {} us every {} us.", train.count, train.onTime.count(), train.period.count());
+    }
+
+    std::string PulseEngine::Fire(size_t turret)
+    {
+        PulseTrain train;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            train = settings_.train;
+        }
+        return Fire(turret, train);
+    }
+
+    void PulseEngine::Abort(size_t turret)
+    {
+        std::string message;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            if (turret >= active_.size() || !active_[turret].running) return;
+            message = Finish(turret, active_[turret], true);
+        }
+        // From the caller, the engine thread may be late or blocked
+        LaserHandler::SetOutput(turret, false);
+        Logger::Warning(message);
+    }
+
+    bool PulseEngine::IsBusy(size_t turret)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return turret < active_.size() && active_[turret].running;
+    }
+
+    bool PulseEngine::EngagesInPulses()
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return initialized_ && settings_.engage;
+    }
+
+    PulseStats PulseEngine::GetStats()
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return stats_;
+    }
+
+    int64_t PulseEngine::MonotonicNs()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+    void PulseEngine::ThreadFunc()
+    {
+        int priority = settings_.priority;
+        if (priority > 0) {
+            sched_param param{};
+            param.sched_priority = std::clamp(priority, sched_get_priority_min(SCHED_FIFO), sched_get_priority_max(SCHED_FIFO));
+            int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+            if (error == 0) {
+                std::lock_guard<std::mutex> lock(mtx_);
+                stats_.realtime = true;
+                Logger::Info("PulseEngine thread runs with SCHED_FIFO priority {}", param.sched_priority);
+            } else {
+                Logger::Warning("PulseEngine could not get SCHED_FIFO ({}), pulse timing will follow the default scheduler",
+                                std::strerror(error));
+            }
+        }
+
+        std::vector<std::string> finished;
+        std::unique_lock<std::mutex> lock(mtx_);
+        while (running_) {
+            int64_t next = std::numeric_limits<int64_t>::max();
+            for (const Active& active : active_) {
+                if (active.running) next = std::min(next, active.nextNs);
+            }
+            if (next == std::numeric_limits<int64_t>::max()) {
+                cv_.wait(lock);
+                continue;
+            }
+
+            // Far from the edge: a timed wait that new commands can interrupt
+            int64_t wakeAheadNs = std::chrono::duration_cast<std::chrono::nanoseconds>(settings_.wakeAhead).count();
+            int64_t remaining = next - MonotonicNs();
+            if (remaining > wakeAheadNs) {
+                cv_.wait_for(lock, std::chrono::nanoseconds(remaining - wakeAheadNs));
+                continue;
+            }
+
+            // Close to it: an absolute sleep, without the lock so Abort is never blocked
+            lock.unlock();
+            timespec deadline{ time_t(next / 1000000000), long(next % 1000000000) };
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR) {}
+            lock.lock();
+
+            int64_t now = MonotonicNs();
+            for (size_t turret = 0; turret < active_.size(); turret++) {
+                Active& active = active_[turret];
+                if (active.running && active.nextNs <= now) Edge(turret, active, finished);
+            }
+
+            if (!finished.empty()) {
+                lock.unlock();
+                for (const auto& message : finished) Logger::Info(message);
+                finished.clear();
+                lock.lock();
+            }
+        }
+    }
+
+    void PulseEngine::Edge(size_t turret, Active& active, std::vector<std::string>& finished)
+    {
+        const int64_t onNs = std::chrono::duration_cast<std::chrono::nanoseconds>(active.train.onTime).count();
+        const int64_t periodNs = std::chrono::duration_cast<std::chrono::nanoseconds>(active.train.period).count();
+
+        if (!active.on) {
+            if (!LaserHandler::SetOutput(turret, true)) {
+                // Locked or the line failed, the laser stays off
+                finished.push_back(Finish(turret, active, true));
+                return;
+            }
+            int64_t at = MonotonicNs();
+            double latenessUs = double(at - active.nextNs) / 1000.0;
+            active.maxLatenessUs = std::max(active.maxLatenessUs, latenessUs);
+            Record(latenessUs);
+            active.risenNs = at;
+            active.on = true;
+            active.nextNs += onNs;
+            return;
+        }
+
+        LaserHandler::SetOutput(turret, false);
+        int64_t at = MonotonicNs();
+        double latenessUs = double(at - active.nextNs) / 1000.0;
+        double onErrorUs = std::abs(double(at - active.risenNs - onNs) / 1000.0);
+        active.maxLatenessUs = std::max(active.maxLatenessUs, latenessUs);
+        active.onErrorSumUs += onErrorUs;
+        active.maxOnErrorUs = std::max(active.maxOnErrorUs, onErrorUs);
+        Record(latenessUs);
+        stats_.pulses++;
+        onErrorSumUs_ += onErrorUs;
+        stats_.meanOnErrorUs = onErrorSumUs_ / double(stats_.pulses);
+        stats_.maxOnErrorUs = std::max(stats_.maxOnErrorUs, onErrorUs);
+
+        active.on = false;
+        active.index++;
+        if (active.index >= active.train.count) {
+            finished.push_back(Finish(turret, active, false));
+            return;
+        }
+        // Scheduled from the start of the train, so lateness does not accumulate
+        active.nextNs = active.startNs + int64_t(active.index) * periodNs;
+    }
+
+    std::string PulseEngine::Finish(size_t turret, Active& active, bool aborted)
+    {
+        active.running = false;
+        stats_.trains++;
+        if (aborted) stats_.aborted++;
+        double meanOnErrorUs = active.index > 0 ? active.onErrorSumUs / double(active.index) : 0.0;
+        return fmt::format("Turret {} pulse train {} after {}/{} pulses of {} us every {} us: "
+                           "edge lateness max {:.1f} us, on-time error mean {:.1f} us max {:.1f} us",
+                           turret, aborted ? "aborted" : "done", active.index, active.train.count,
+                           active.train.onTime.count(), active.train.period.count(),
+                           active.maxLatenessUs, meanOnErrorUs, active.maxOnErrorUs);
+    }
+
+    void PulseEngine::Record(double latenessUs)
+    {
+        edges_++;
+        latenessSumUs_ += latenessUs;
+        stats_.meanLatenessUs = latenessSumUs_ / double(edges_);
+        stats_.maxLatenessUs = std::max(stats_.maxLatenessUs, latenessUs);
+    }
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace DebuggerInfrastructure
+{
+    struct PulseTrain
+    {
+        std::chrono::microseconds onTime {20000};
+        std::chrono::microseconds period {50000};
+        uint32_t count = 10;
+    };
+
+    struct PulseSettings
+    {
+        bool engage = false;                        ///< Engagements fire a train instead of holding the laser on.
+        PulseTrain train;                           ///< The train fired per engagement.
+        int priority = 80;                          ///< SCHED_FIFO priority of the engine thread, 0 keeps the default policy.
+        std::chrono::microseconds wakeAhead {2000}; ///< Wait for commands until this close to an edge, then sleep to the edge.
+    };
+
+    struct PulseStats
+    {
+        uint64_t trains = 0;
+        uint64_t pulses = 0;
+        uint64_t aborted = 0;               ///< Trains cut short by Abort or by the laser lock.
+        double meanLatenessUs = 0.0;        ///< Edge written after its scheduled time.
+        double maxLatenessUs = 0.0;
+        double meanOnErrorUs = 0.0;         ///< Measured on-time against the requested one, absolute.
+        double maxOnErrorUs = 0.0;
+        bool realtime = false;              ///< The engine thread got SCHED_FIFO.
+    };
+
+    /**
+     * @brief Fires timed laser pulse trains from one dedicated thread.
+     *
+     * A train (on-time, period, count) is requested as one command and its edges are written at absolute
+     * CLOCK_MONOTONIC deadlines, so the exposure no longer depends on the frame loop. The thread asks for
+     * SCHED_FIFO and falls back to the default policy when it is not allowed.
+     *
+     * Cut-off does not depend on this thread: Abort drives the line low from the caller, and LaserHandler
+     * refuses every rising edge once it is locked, which ends the train.
+     */
+    class PulseEngine
+    {
+    public:
+        static void Initialize(PulseSettings settings, size_t turrets);
+        static void Dispose();
+
+        static std::string Fire(size_t turret, PulseTrain train);
+        // Fires the train from the settings.
+        static std::string Fire(size_t turret);
+        static void Abort(size_t turret);
+        static bool IsBusy(size_t turret);
+        // True when engagements should fire trains, see PulseSettings::engage.
+        static bool EngagesInPulses();
+        static PulseStats GetStats();
+
+    private:
+        struct Active
+        {
+            bool running = false;
+            bool on = false;
+            PulseTrain train;
+            uint32_t index = 0;             ///< Pulses completed.
+            int64_t startNs = 0;
+            int64_t nextNs = 0;             ///< Scheduled time of the next edge.
+            int64_t risenNs = 0;            ///< Measured time of the last rising edge.
+            double maxLatenessUs = 0.0;
+            double onErrorSumUs = 0.0;
+            double maxOnErrorUs = 0.0;
+        };
+
+        static void ThreadFunc();
+        static void Edge(size_t turret, Active& active, std::vector<std::string>& finished);
+        static std::string Finish(size_t turret, Active& active, bool aborted);
+        static void Record(double latenessUs);
+        static int64_t MonotonicNs();
+
+        static std::mutex mtx_;
+        static std::condition_variable cv_;
+        static std::thread thread_;
+        static bool running_;
+        static bool initialized_;
+        static PulseSettings settings_;
+        static std::vector<Active> active_;
+        static PulseStats stats_;
+        static uint64_t edges_;
+        static double latenessSumUs_;
+        static double onErrorSumUs_;
+    };
+}
@@ -3,11 +3,21 @@
 #include "../DbHandler/DbHandler.h"
 #include "../ThirdParties/nlohmann/json.hpp"  // nlohmann::json
 #include "../LaserHandler/LaserHandler.h"
+#include "../PulseEngine/PulseEngine.h"
 #include "../ServoHandler/ServoHandler.h"
+#include "../ServoHandler/SimulatedPwmTree.h"
+#include "../GPIOHandler/GPIOHandler.h"
+#include "../GPIOHandler/SimulatedGpioChip.h"
 #include "../AimHandler/AimHandler.h"
 #include "../DeadLocker/DeadLocker.h"
+#include "../SafetyTrace/SafetyTrace.h"
+#include "../SafetyStateChannel/SafetyStateChannel.h"
+#include "../StateJournal/StateJournal.h"
+#include "../Watchdog/Watchdog.h"
 #include "../ExceptionExtensions/ExceptionExtensions.h"
 #include "../NeuralNetworkHandler/NeuralNetworkHandler.h"
+#include "../TargetVerifier/TargetVerifier.h"
+#include "../AutoCalibrator/AutoCalibrator.h"
 
 namespace DebuggerInfrastructure
     {
@@ -16,10 +26,25 @@ namespace DebuggerInfrastructure
     // We'll use this for convenience:
     using nlohmann::json;
 
+    namespace
+    {
+        // The "turret" query parameter of the aiming endpoints, turret 0 when missing
+        size_t parseTurret(const httplib::Request& req)
+        {
+            if (!req.has_param("turret")) return 0;
+            try {
+                return std::stoul(req.get_param_value("turret"));
+            } catch (...) {
+                throw BadRequestException("Invalid turret parameter");
+            }
+        }
+    }
+
     RESTApi::RESTApi(const std::string& listenAddress, int port)
         : listenAddress_(listenAddress)
         , serverThread_()
         , stopRequested_(false)
+        , statusWaiters_(0)
     {
         if(port_ == -1)
         {
@@ -167,6 +192,7 @@ namespace DebuggerInfrastructure
                 jObj["event"]       = r.event;
                 jObj["className"]   = r.className;
                 jObj["description"] = r.description;
+                jObj["clip"]        = r.clip;
                 jResponse.push_back(jObj);
             }
             res.set_content(jResponse.dump(), "application/json");
@@ -197,7 +223,7 @@ namespace DebuggerInfrastructure
                     msg = "Invalid angle parameter(s)";
                 } else {
                     try {
-                        msg = AimHandler::SetDefaultState({*maybeAngleX, *maybeAngleY});
+                        msg = AimHandler::Get(parseTurret(req)).SetDefaultState({*maybeAngleX, *maybeAngleY});
                     } catch (BadRequestException& ex) {
                         statusCode = 400;
                         msg = ex.what();
@@ -261,7 +287,7 @@ namespace DebuggerInfrastructure
                 } else {
                     Logger::Verbose("{} was called with parameters, pointX={} | pointY={}", req.path, *maybeX, *maybeY);
                     try {
-                        msg = AimHandler::ShootAt({*maybeX, *maybeY});
+                        msg = AimHandler::Get(parseTurret(req)).ShootAt({*maybeX, *maybeY});
                         auto tab = msg.find('\t');
                         if (tab != std::string::npos) msg = msg.substr(0, tab);
                     } catch (BadRequestException& ex) {
@@ -282,22 +308,253 @@ namespace DebuggerInfrastructure
             logResponse(req, res.status, res.body);
         });
 
-        svr_.Get("/status", [&](const httplib::Request& req, httplib::Response& res) {
+        svr_.Post("/AutoCalibrate", [&](const httplib::Request& req, httplib::Response& res) {
             logRequest(req);
-            std::string status;
-            if (DeadLocker::IsLocked()) {
-                std::string reasons;
-                for (const auto& el : DeadLocker::lockReasons) {
-                    reasons += " " + el + " ";
+            int statusCode = 200;
+            std::string msg;
+            json jResponse;
+            AutoCalibrationSettings settings;
+            try {
+                if (req.has_param("gridSize")) settings.gridSize = std::stoul(req.get_param_value("gridSize"));
+                if (req.has_param("cameraId")) settings.cameraId = std::stoul(req.get_param_value("cameraId"));
+                if (req.has_param("turret")) settings.turret = std::stoul(req.get_param_value("turret"));
+                if (AutoCalibrator::Start(settings)) {
+                    msg = fmt::format("Auto calibration of turret {} started on camera {} with a {}x{} grid",
+                                      settings.turret, settings.cameraId, settings.gridSize, settings.gridSize);
+                } else {
+                    statusCode = 400;
+                    msg = "Auto calibration is already running";
                 }
-                status = "Locked due to an emergency (Reasons:" + reasons + ")";
+            } catch (std::logic_error&) {
+                statusCode = 400;
+                msg = "Invalid gridSize, cameraId or turret parameter";
+            } catch (std::exception& ex) {
+                statusCode = 500;
+                msg = ex.what();
+            }
+            jResponse["message"] = msg;
+            res.status = statusCode;
+            res.set_content(jResponse.dump(), "application/json");
+            logResponse(req, res.status, res.body);
+        });
+
+        svr_.Get("/AutoCalibrate", [&](const httplib::Request& req, httplib::Response& res) {
+            logRequest(req);
+            AutoCalibrationStatus status = AutoCalibrator::GetStatus();
+            json j;
+            j["state"]          = AutoCalibrator::StateName(status.state);
+            j["pointsTotal"]    = status.pointsTotal;
+            j["pointsVisited"]  = status.pointsVisited;
+            j["pointsMeasured"] = status.pointsMeasured;
+            j["durationMs"]     = status.durationMs;
+            j["fit"]            = CalibrationModel::FitName(status.report.fit);
+            j["rmsError"]       = status.report.rmsError;
+            j["maxError"]       = status.report.maxError;
+            j["message"]        = status.message;
+            res.set_content(j.dump(), "application/json");
+            logResponse(req, res.status, res.body);
+        });
+
+        // The body of /status, tagged with the version of the safety state it was built from
+        auto statusJson = [](const SafetyState& state) {
+            std::string status;
+            if (state.locked) {
+                status = "Locked due to an emergency (Reasons:" + DeadLocker::DescribeReasons() + ")";
             } else if (AimHandler::IsCalibrationEnabled()) {
                 status = "Calibration (Insects will be ignored and laser is always ON)";
             } else {
                 status = "Armed";
             }
+            ButtonStats button = DeadLocker::GetButtonStats();
+            json reasons = json::array();
+            for (const ActiveLockReason& active : DeadLocker::GetReasons()) {
+                reasons.push_back({
+                    {"reason", std::string(DeadLocker::ReasonName(active.reason))},
+                    {"since", std::chrono::duration_cast<std::chrono::milliseconds>(active.since.time_since_epoch()).count()}
+                });
+            }
+            SafetyStateStats notifications = SafetyStateChannel::GetStats();
             json j;
+            j["version"] = state.version;
             j["status"] = status;
+            j["reasons"] = reasons;
+            j["button"] = {
+                {"presses", button.presses},
+                {"bounces", button.bounces},
+                {"lastLatencyUs", button.lastLatencyUs},
+                {"meanLatencyUs", button.meanLatencyUs},
+                {"maxLatencyUs", button.maxLatencyUs}
+            };
+            j["notifications"] = {
+                {"deliveries", notifications.deliveries},
+                {"coalesced", notifications.coalesced},
+                {"waiters", notifications.waiters},
+                {"subscribers", notifications.subscribers}
+            };
+            return j;
+        };
+
+        svr_.Get("/status", [&](const httplib::Request& req, httplib::Response& res) {
+            logRequest(req);
+            res.set_content(statusJson(SafetyStateChannel::Current()).dump(), "application/json");
+            logResponse(req, res.status, res.body);
+        });
+
+        // Answers once the state is newer than "since" (default: the current one) or after timeoutMs
+        svr_.Get("/status/wait", [&, statusJson](const httplib::Request& req, httplib::Response& res) {
+            logRequest(req);
+            uint64_t since;
+            std::chrono::milliseconds timeout;
+            try {
+                since = req.has_param("since") ? std::stoull(req.get_param_value("since")) : SafetyStateChannel::Current().version;
+                timeout = std::chrono::milliseconds(std::clamp<long>(
+                    req.has_param("timeoutMs") ? std::stol(req.get_param_value("timeoutMs")) : 25000, 0, 60000));
+            } catch (std::logic_error&) {
+                res.status = 400;
+                res.set_content(R"({"message":"Invalid since or timeoutMs parameter"})", "application/json");
+                logResponse(req, res.status, res.body);
+                return;
+            }
+            if (++statusWaiters_ > maxStatusWaiters) {
+                statusWaiters_--;
+                res.status = 503;
+                res.set_content(R"({"message":"Too many status waiters"})", "application/json");
+                logResponse(req, res.status, res.body);
+                return;
+            }
+            // In slices, so Stop does not wait for a whole timeout
+            SafetyState state = SafetyStateChannel::Current();
+            auto deadline = std::chrono::steady_clock::now() + timeout;
+            while (state.version <= since && !stopRequested_) {
+                auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+                if (left <= std::chrono::milliseconds::zero()) break;
+                std::optional<SafetyState> next = SafetyStateChannel::WaitNewer(since, std::min(left, std::chrono::milliseconds(1000)));
+                if (!next) break;
+                state = *next;
+            }
+            statusWaiters_--;
+            json j = statusJson(state);
+            j["changed"] = state.version > since;
+            res.set_content(j.dump(), "application/json");
+            logResponse(req, res.status, res.body);
+        });
+
+        // Server-sent events: the status on connect, then on every change, coalesced if they come faster than sent
+        svr_.Get("/status/events", [&, statusJson](const httplib::Request& req, httplib::Response& res) {
+            logRequest(req);
+            if (++statusWaiters_ > maxStatusWaiters) {
+                statusWaiters_--;
+                res.status = 503;
+                res.set_content(R"({"message":"Too many status waiters"})", "application/json");
+                logResponse(req, res.status, res.body);
+                return;
+            }
+            res.set_header("Cache-Control", "no-cache");
+            struct Stream
+            {
+                std::optional<uint64_t> sent;
+                int idleSeconds = 0;
+            };
+            auto stream = std::make_shared<Stream>();
+            res.set_chunked_content_provider(
+                "text/event-stream",
+                [this, stream, statusJson](size_t /*offset*/, httplib::DataSink& sink) {
+                    SafetyState state = SafetyStateChannel::Current();
+                    if (stream->sent) {
+                        // Wakes every second to notice a stopping server
+                        std::optional<SafetyState> next = SafetyStateChannel::WaitNewer(*stream->sent, std::chrono::seconds(1));
+                        if (!next || stopRequested_) return false;
+                        state = *next;
+                    }
+                    std::string event;
+                    if (stream->sent && state.version == *stream->sent) {
+                        // A comment now and then keeps proxies from closing an idle stream
+                        if (++stream->idleSeconds < 15) return true;
+                        event = ": keep-alive\n\n";
+                    } else {
+                        event = fmt::format("id: {}\ndata: {}\n\n", state.version, statusJson(state).dump());
+                        stream->sent = state.version;
+                    }
+                    stream->idleSeconds = 0;
+                    return sink.write(event.data(), event.size());
+                },
+                [this](bool /*success*/) { statusWaiters_--; });
+        });
+
+        svr_.Get("/safety", [&](const httplib::Request& req, httplib::Response& res) {
+            logRequest(req);
+            json reasons = json::array();
+            for (const SafetyTraceStats& stats : SafetyTrace::GetStats()) {
+                json hops = json::object();
+                for (size_t i = 1; i < size_t(TraceHop::Count); i++) {
+                    const HopLatency& hop = stats.hops[i];
+                    hops[std::string(SafetyTrace::HopName(static_cast<TraceHop>(i)))] = {
+                        {"lastUs", hop.lastUs},
+                        {"p50Us", hop.p50Us},
+                        {"p99Us", hop.p99Us},
+                        {"maxUs", hop.maxUs}
+                    };
+                }
+                reasons.push_back({
+                    {"reason", std::string(DeadLocker::ReasonName(stats.reason))},
+                    {"traces", stats.traces},
+                    {"overBudget", stats.overBudget},
+                    {"budgetMs", stats.budgetMs},
+                    {"hops", hops}
+                });
+            }
+            json recent = json::array();
+            for (const SafetyTraceData& trace : DbHandler::ReadSafetyTraces(20)) {
+                recent.push_back({
+                    {"time", trace.time},
+                    {"reason", trace.reason},
+                    {"detectedUs", trace.detectedUs},
+                    {"initiatedUs", trace.initiatedUs},
+                    {"motionDisarmedUs", trace.motionDisarmedUs},
+                    {"laserCutUs", trace.laserCutUs},
+                    {"servosParkedUs", trace.servosParkedUs},
+                    {"budgetUs", trace.budgetUs}
+                });
+            }
+            json j;
+            j["reasons"] = reasons;
+            j["recent"] = recent;
+            StartupReport startup = StateJournal::GetStartupReport();
+            j["startup"] = {
+                {"journalFound", startup.journalFound},
+                {"previousClean", startup.previousClean},
+                {"previousTorn", startup.previousTorn},
+                {"previousLaserMask", startup.previousLaserMask},
+                {"previousLocked", startup.previousLocked},
+                {"linesDriven", startup.linesDriven},
+                {"servosReleased", startup.servosReleased},
+                {"timeToSafeMs", startup.timeToSafeMs},
+                {"interruptedEngagement", startup.interruptedEngagement}
+            };
+            res.set_content(j.dump(), "application/json");
+            logResponse(req, res.status, res.body);
+        });
+
+        svr_.Get("/watchdog", [&](const httplib::Request& req, httplib::Response& res) {
+            logRequest(req);
+            json channels = json::array();
+            for (const WatchdogChannelStats& stats : Watchdog::GetStats()) {
+                channels.push_back({
+                    {"name", stats.name},
+                    {"stage", Watchdog::StageName(stats.stage)},
+                    {"deadlineMs", stats.deadlineMs},
+                    {"beats", stats.beats},
+                    {"misses", stats.misses},
+                    {"lastGapMs", stats.lastGapMs},
+                    {"maxGapMs", stats.maxGapMs},
+                    {"minMarginMs", stats.minMarginMs},
+                    {"stalled", stats.stalled}
+                });
+            }
+            json j;
+            j["tripped"] = Watchdog::IsTripped();
+            j["trips"] = Watchdog::Trips();
+            j["channels"] = channels;
             res.set_content(j.dump(), "application/json");
             logResponse(req, res.status, res.body);
         });
@@ -307,8 +564,8 @@ namespace DebuggerInfrastructure
             int statusCode = 200;
             std::string msg;
             try {
-                if (DeadLocker::lockReasons.find(NAMEOF(RESTApi)) != DeadLocker::lockReasons.end()) {
-                    DeadLocker::Recover(NAMEOF(RESTApi));
+                if (DeadLocker::HasReason(LockReason::RESTApi)) {
+                    DeadLocker::Recover(LockReason::RESTApi);
                     DbHandler::InsertDataNow(EMERGENCYREMOVELOCKREASON, NAMEOF(RESTApi), "RESTapi veto was revoked.");
                     msg = "Successfully unLocked.";
                 } else {
@@ -329,17 +586,22 @@ namespace DebuggerInfrastructure
         });
 
         svr_.Post("/disable", [&](const httplib::Request& req, httplib::Response& res) {
-            logRequest(req);
+            SafetyTrace::Clock::time_point received = SafetyTrace::Clock::now();
             int statusCode = 200;
             std::string msg;
             try {
-                if (DeadLocker::lockReasons.find(NAMEOF(RESTApi)) == DeadLocker::lockReasons.end()) {
+                bool newReason = !DeadLocker::HasReason(LockReason::RESTApi);
+                {
+                    SafetyTrace::Scope trace(LockReason::RESTApi, received);
+                    DeadLocker::EmergencyInitiate(LockReason::RESTApi);
+                }
+                logRequest(req);
+                if (newReason) {
                     msg = "Successfully Locked.";
                     DbHandler::InsertDataNow(EMERGENCYADDLOCKREASON, NAMEOF(RESTApi), "RESTapi veto was invoked.");
                 } else {
                     msg = "Already locked by REST";
                 }
-                DeadLocker::EmergencyInitiate(NAMEOF(RESTApi));
             } catch (BadRequestException& ex) {
                 statusCode = 400;
                 msg = ex.what();
@@ -381,7 +643,8 @@ namespace DebuggerInfrastructure
                     int     eventId     = item["event"].get<int>();
                     auto    className   = item["className"].get<std::string>();
                     auto    description = item["description"].get<std::string>();
-                    RecordData rd(time, eventId, className, description);
+                    auto    clip        = item.value("clip", std::string{});
+                    RecordData rd(time, eventId, className, description, clip);
                     DbHandler::InsertData(rd);
                     insertedCount++;
                 }
@@ -398,14 +661,197 @@ namespace DebuggerInfrastructure
             }
         });
 
+        svr_.Get("/cameras", [&](const httplib::Request& req, httplib::Response& res) {
+            logRequest(req);
+            json jResponse = json::array();
+            for (const auto& stats : NeuralNetworkHandler::GetCameraStats()) {
+                json jObj;
+                jObj["id"]            = stats.id;
+                jObj["turrets"]       = stats.turrets;
+                jObj["captureFps"]    = stats.captureFps;
+                jObj["inferenceFps"]  = stats.inferenceFps;
+                jObj["queueDepth"]    = stats.queueDepth;
+                jObj["droppedFrames"] = stats.droppedFrames;
+                jObj["staleFrames"]   = stats.staleFrames;
+                jObj["lastLatencyMs"] = stats.lastLatencyMs;
+                jObj["engagedTargets"]   = stats.engagedTargets;
+                jObj["lostTargets"]      = stats.lostTargets;
+                jObj["engagedPerMinute"] = stats.engagedPerMinute;
+                jObj["inputPixelsPerFrame"] = stats.inputPixelsPerFrame;
+                jResponse.push_back(jObj);
+            }
+            res.set_content(jResponse.dump(), "application/json");
+            logResponse(req, res.status, res.body);
+        });
+
+        svr_.Get("/turrets", [&](const httplib::Request& req, httplib::Response& res) {
+            logRequest(req);
+            json jResponse = json::array();
+            for (size_t id = 0; id < AimHandler::Count(); id++) {
+                AimHandler& turret = AimHandler::Get(id);
+                TurretState state = turret.GetState();
+                json jObj;
+                jObj["id"]           = id;
+                jObj["locked"]       = state.locked;
+                jObj["defaultState"] = {state.defaultX, state.defaultY};
+                jObj["lastShoot"]    = std::chrono::duration_cast<std::chrono::milliseconds>(state.lastShoot.time_since_epoch()).count();
+                jObj["onTarget"]     = turret.IsOnTarget();
+                jObj["laser"]        = LaserHandler::GetStatus(id);
+                FeedbackStats feedback = turret.GetFeedbackStats();
+                json jFeedback;
+                jFeedback["angleSensor"]    = feedback.angleSensor;
+                jFeedback["limitSwitches"]  = feedback.limitSwitches;
+                if (feedback.angleSensor) {
+                    jFeedback["angle"]      = {feedback.angle.first, feedback.angle.second};
+                }
+                jFeedback["samples"]        = feedback.samples;
+                jFeedback["readErrors"]     = feedback.readErrors;
+                jFeedback["limitTrips"]     = feedback.limitTrips;
+                jFeedback["limitStops"]     = feedback.limitStops;
+                jFeedback["responses"]      = feedback.responses;
+                jFeedback["timeouts"]       = feedback.timeouts;
+                jFeedback["responseMs"]     = {{"last", feedback.lastResponseMs}, {"mean", feedback.meanResponseMs}, {"max", feedback.maxResponseMs}};
+                jFeedback["settleMs"]       = {{"last", feedback.lastSettleMs}, {"mean", feedback.meanSettleMs}, {"max", feedback.maxSettleMs}};
+                jFeedback["lastErrorDeg"]   = feedback.lastErrorDeg;
+                jObj["feedback"]     = jFeedback;
+                jResponse.push_back(jObj);
+            }
+            res.set_content(jResponse.dump(), "application/json");
+            logResponse(req, res.status, res.body);
+        });
+
+        svr_.Post("/Pulse", [&](const httplib::Request& req, httplib::Response& res) {
+            logRequest(req);
+            int statusCode = 200;
+            std::string msg;
+            json jResponse;
+            try {
+                size_t turret = req.has_param("turret") ? std::stoul(req.get_param_value("turret")) : 0;
+                PulseTrain train;
+                if (req.has_param("onUs")) train.onTime = std::chrono::microseconds(std::stol(req.get_param_value("onUs")));
+                if (req.has_param("periodUs")) train.period = std::chrono::microseconds(std::stol(req.get_param_value("periodUs")));
+                if (req.has_param("count")) train.count = std::stoul(req.get_param_value("count"));
+                msg = PulseEngine::Fire(turret, train);
+            } catch (BadRequestException& ex) {
+                statusCode = 400;
+                msg = ex.what();
+            } catch (std::logic_error&) {
+                statusCode = 400;
+                msg = "Invalid turret, onUs, periodUs or count parameter";
+            } catch (std::runtime_error& ex) {
+                statusCode = 500;
+                msg = ex.what();
+            }
+            jResponse["message"] = msg;
+            res.status = statusCode;
+            res.set_content(jResponse.dump(), "application/json");
+            logResponse(req, res.status, res.body);
+        });
+
+        svr_.Get("/Pulse", [&](const httplib::Request& req, httplib::Response& res) {
+            logRequest(req);
+            PulseStats stats = PulseEngine::GetStats();
+            json j;
+            j["trains"]         = stats.trains;
+            j["pulses"]         = stats.pulses;
+            j["aborted"]        = stats.aborted;
+            j["meanLatenessUs"] = stats.meanLatenessUs;
+            j["maxLatenessUs"]  = stats.maxLatenessUs;
+            j["meanOnErrorUs"]  = stats.meanOnErrorUs;
+            j["maxOnErrorUs"]   = stats.maxOnErrorUs;
+            j["realtime"]       = stats.realtime;
+            res.set_content(j.dump(), "application/json");
+            logResponse(req, res.status, res.body);
+        });
+
+        svr_.Post("/Simulation/Press", [&](const httplib::Request& req, httplib::Response& res) {
+            logRequest(req);
+            int statusCode = 200;
+            std::string msg;
+            json jResponse;
+            try {
+                auto* chip = dynamic_cast<SimulatedGpioChip*>(&GPIOHandler::Backend());
+                if (chip == nullptr) {
+                    throw BadRequestException("The hardware is not simulated");
+                }
+                unsigned int line = std::stoul(req.get_param_value("line"));
+                std::chrono::milliseconds hold(req.has_param("holdMs") ? std::stol(req.get_param_value("holdMs")) : 200);
+                chip->Press(line, hold);
+                msg = fmt::format("Pressing simulated line {} for {} ms", line, hold.count());
+            } catch (BadRequestException& ex) {
+                statusCode = 400;
+                msg = ex.what();
+            } catch (std::logic_error&) {
+                statusCode = 400;
+                msg = "Invalid line or holdMs parameter";
+            } catch (std::runtime_error& ex) {
+                statusCode = 500;
+                msg = ex.what();
+            }
+            jResponse["message"] = msg;
+            res.status = statusCode;
+            res.set_content(jResponse.dump(), "application/json");
+            logResponse(req, res.status, res.body);
+        });
+
+        svr_.Get("/Simulation", [&](const httplib::Request& req, httplib::Response& res) {
+            logRequest(req);
+            json j;
+            j["simulated"] = SimulatedPwmTree::IsInitialized();
+            j["servos"]    = json::array();
+            for (size_t id = 0; id < AimHandler::Count(); id++) {
+                TurretSettings settings = AimHandler::Get(id).GetSettings();
+                for (int channel : {settings.xChannel, settings.yChannel}) {
+                    auto angle = SimulatedPwmTree::GetAngle(settings.pwmChip, channel);
+                    auto commanded = SimulatedPwmTree::GetCommandedAngle(settings.pwmChip, channel);
+                    if (!angle || !commanded) continue;
+                    j["servos"].push_back({{"turret", id}, {"chip", settings.pwmChip}, {"channel", channel},
+                                           {"angle", *angle}, {"commanded", *commanded}});
+                }
+            }
+            res.set_content(j.dump(), "application/json");
+            logResponse(req, res.status, res.body);
+        });
+
+        svr_.Get("/verifier", [&](const httplib::Request& req, httplib::Response& res) {
+            logRequest(req);
+            VerifierStats stats = TargetVerifier::GetStats();
+            json j;
+            j["enabled"]       = stats.enabled;
+            j["batches"]       = stats.batches;
+            j["crops"]         = stats.crops;
+            j["confirmed"]     = stats.confirmed;
+            j["rejected"]      = stats.rejected;
+            j["lastBatchMs"]   = stats.lastBatchMs;
+            j["maxBatchMs"]    = stats.maxBatchMs;
+            j["averageCropMs"] = stats.averageCropMs;
+            res.set_content(j.dump(), "application/json");
+            logResponse(req, res.status, res.body);
+        });
+
         svr_.Get("/video", [&](const httplib::Request& req, httplib::Response& res) {
             res.set_header("Connection", "close");
+            size_t cameraId = 0;
+            if (req.has_param("camera")) {
+                try {
+                    cameraId = std::stoul(req.get_param_value("camera"));
+                } catch (...) {
+                    res.status = 400;
+                    res.set_content("Invalid 'camera' parameter (must be integer)", "text/plain");
+                    return;
+                }
+            }
+            if (cameraId >= NeuralNetworkHandler::GetCameraCount()) {
+                res.status = 404;
+                res.set_content("No such camera", "text/plain");
+                return;
+            }
             try {
                 res.set_content_provider(
                     "multipart/x-mixed-replace; boundary=frame",
-                    [&](size_t /*offset*/, httplib::DataSink& sink) {
+                    [cameraId](size_t /*offset*/, httplib::DataSink& sink) {
                         try {
-                            auto frame = NeuralNetworkHandler::GetLatestFrame();
+                            auto frame = NeuralNetworkHandler::GetLatestFrame(cameraId);
                             std::vector<uchar> buf;
                             cv::imencode(".jpg", frame, buf);
                             std::ostringstream header;
@@ -15,6 +15,9 @@ namespace DebuggerInfrastructure
     /**
         * @brief A simple REST API server that runs on a separate thread,
         *        providing endpoints /data/range, /status, /enable, /disable.
+        *
+        * /status/wait (long-poll) and /status/events (server-sent events) hold a server worker each while they
+        * wait for the safety state to change, so at most maxStatusWaiters of them run at once.
         */
     class RESTApi
     {
@@ -61,5 +64,8 @@ namespace DebuggerInfrastructure
         httplib::Server svr_;             ///< The HTTP server instance from cpp-httplib.
         std::thread serverThread_;        ///< The thread that runs the server.
         std::atomic<bool> stopRequested_; ///< A flag indicating that we want to stop the server.
+        std::atomic<int> statusWaiters_;  ///< Clients blocked in /status/wait or /status/events.
+
+        static constexpr int maxStatusWaiters = 4;
     };
 }
\ No newline at end of file
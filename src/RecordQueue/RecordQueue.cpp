@@ -0,0 +1,82 @@
+#include "RecordQueue.h"
+#include "../Logger/Logger.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace DebuggerInfrastructure
+{
+    std::mutex                              RecordQueue::mtx;
+    std::condition_variable                 RecordQueue::cv;
+    std::deque<std::function<void()>>       RecordQueue::tasks;
+    bool                                    RecordQueue::running = false;
+    std::thread                             RecordQueue::thread;
+    RecordQueueStats                        RecordQueue::stats;
+
+    void RecordQueue::Initialize()
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        if (running) {
+            throw std::runtime_error("RecordQueue is already initialized");
+        }
+        running = true;
+        thread = std::thread(&RecordQueue::ThreadFunc);
+    }
+
+    void RecordQueue::Dispose()
+    {
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            running = false;
+        }
+        cv.notify_all();
+        if (thread.joinable()) thread.join();
+    }
+
+    void RecordQueue::Post(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            stats.posted++;
+            if (running) {
+                tasks.push_back(std::move(task));
+                stats.maxPending = std::max(stats.maxPending, tasks.size());
+                cv.notify_one();
+                return;
+            }
+            stats.ranInline++;
+        }
+        Run(task);
+    }
+
+    RecordQueueStats RecordQueue::GetStats()
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        RecordQueueStats result = stats;
+        result.pending = tasks.size();
+        return result;
+    }
+
+    void RecordQueue::ThreadFunc()
+    {
+        std::unique_lock<std::mutex> lk(mtx);
+        while (true) {
+            cv.wait(lk, [] { return !running || !tasks.empty(); });
+            // Disposed: what was posted before still gets written
+            if (tasks.empty()) return;
+            std::function<void()> task = std::move(tasks.front());
+            tasks.pop_front();
+            lk.unlock();
+            Run(task);
+            lk.lock();
+        }
+    }
+
+    void RecordQueue::Run(const std::function<void()>& task)
+    {
+        try {
+            task();
+        } catch (const std::exception& ex) {
+            Logger::Error("Could not write a record: {}", ex.what());
+        }
+    }
+}
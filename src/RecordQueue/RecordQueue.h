@@ -0,0 +1,52 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace DebuggerInfrastructure
+{
+    struct RecordQueueStats
+    {
+        uint64_t posted = 0;
+        uint64_t ranInline = 0;         ///< Ran on the posting thread, the queue was not running.
+        size_t pending = 0;
+        size_t maxPending = 0;
+    };
+
+    /**
+     * @brief Takes the log lines and database records of the emergency paths off the threads that cut the lasers.
+     *
+     * The button edge is handled on the GPIO event loop, which also carries every other line's events. A database
+     * flush or a console write there holds up the next edge. The cut path posts what it has to tell instead, and
+     * the queue's own thread writes it, one task after another in the order posted.
+     *
+     * Before Initialize and after Dispose a posted task runs on the caller, so nothing is lost at startup or
+     * shutdown. Dispose runs what is still queued.
+     */
+    class RecordQueue
+    {
+    public:
+        static void Initialize();
+        // Runs the tasks still queued and stops the thread, call before DbHandler::Dispose
+        static void Dispose();
+
+        // Never blocks on the database or the console
+        static void Post(std::function<void()> task);
+        static RecordQueueStats GetStats();
+
+    private:
+        static void ThreadFunc();
+        static void Run(const std::function<void()>& task);
+
+        static std::mutex mtx;
+        static std::condition_variable cv;
+        static std::deque<std::function<void()>> tasks;
+        static bool running;
+        static std::thread thread;
+        static RecordQueueStats stats;
+    };
+}
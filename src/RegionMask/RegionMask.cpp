@@ -0,0 +1,91 @@
+#include "RegionMask.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace DebuggerInfrastructure
+{
+    RegionMask::RegionMask(RegionSettings settings)
+    {
+        for (auto& polygon : settings.regionsOfInterest)
+        {
+            regions_.push_back(Compile(std::move(polygon)));
+        }
+        for (auto& polygon : settings.exclusionZones)
+        {
+            exclusions_.push_back(Compile(std::move(polygon)));
+        }
+
+        if (!regions_.empty())
+        {
+            bounds_ = regions_.front().bounds;
+            for (const auto& region : regions_)
+            {
+                bounds_.x0 = std::min(bounds_.x0, region.bounds.x0);
+                bounds_.y0 = std::min(bounds_.y0, region.bounds.y0);
+                bounds_.x1 = std::max(bounds_.x1, region.bounds.x1);
+                bounds_.y1 = std::max(bounds_.y1, region.bounds.y1);
+            }
+        }
+    }
+
+    RegionMask::CompiledPolygon RegionMask::Compile(Polygon polygon)
+    {
+        if (polygon.size() < 3)
+        {
+            throw std::invalid_argument("Region polygon must have at least 3 points");
+        }
+
+        NormalizedRect bounds {1.0, 1.0, 0.0, 0.0};
+        for (auto& [x, y] : polygon)
+        {
+            x = std::clamp(x, 0.0, 1.0);
+            y = std::clamp(y, 0.0, 1.0);
+            bounds.x0 = std::min(bounds.x0, x);
+            bounds.y0 = std::min(bounds.y0, y);
+            bounds.x1 = std::max(bounds.x1, x);
+            bounds.y1 = std::max(bounds.y1, y);
+        }
+        return CompiledPolygon{std::move(polygon), bounds};
+    }
+
+    bool RegionMask::Contains(const CompiledPolygon& polygon, double x, double y)
+    {
+        const auto& b = polygon.bounds;
+        if (x < b.x0 || x > b.x1 || y < b.y0 || y > b.y1) return false;
+
+        // Even-odd ray casting
+        bool inside = false;
+        const auto& pts = polygon.points;
+        for (size_t i = 0, j = pts.size() - 1; i < pts.size(); j = i++)
+        {
+            const auto& [xi, yi] = pts[i];
+            const auto& [xj, yj] = pts[j];
+            if ((yi > y) != (yj > y) && x < (xj - xi) * (y - yi) / (yj - yi) + xi)
+            {
+                inside = !inside;
+            }
+        }
+        return inside;
+    }
+
+    bool RegionMask::IsAllowed(double x, double y) const
+    {
+        for (const auto& exclusion : exclusions_)
+        {
+            if (Contains(exclusion, x, y)) return false;
+        }
+        if (regions_.empty()) return true;
+        return std::any_of(regions_.begin(), regions_.end(),
+                           [x, y](const CompiledPolygon& region) { return Contains(region, x, y); });
+    }
+
+    NormalizedRect RegionMask::BoundingBox() const
+    {
+        return bounds_;
+    }
+
+    bool RegionMask::IsFullFrame() const
+    {
+        return bounds_.x0 <= 0.0 && bounds_.y0 <= 0.0 && bounds_.x1 >= 1.0 && bounds_.y1 >= 1.0;
+    }
+}
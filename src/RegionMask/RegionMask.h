@@ -0,0 +1,64 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+namespace DebuggerInfrastructure
+{
+    // Polygon in normalized frame coordinates ([0, 1] on both axes, same space as AimHandler::SetPoint).
+    using Polygon = std::vector<std::pair<double, double>>;
+
+    struct RegionSettings
+    {
+        std::vector<Polygon> regionsOfInterest;
+        std::vector<Polygon> exclusionZones;
+
+        bool operator==(const RegionSettings&) const = default;
+    };
+
+    struct NormalizedRect
+    {
+        double x0;
+        double y0;
+        double x1;
+        double y1;
+    };
+
+    /**
+     * @brief Answers whether a normalized frame point may be engaged.
+     *
+     * A point is allowed when it lies inside any region of interest (or no region is configured)
+     * and outside every exclusion zone. The bounding box of the regions of interest is used to crop
+     * the inference input. Only insects are filtered by the polygons, protected entities count anywhere
+     * in the frame: NeuralNetworkHandler infers the whole frame for them as well.
+     */
+    class RegionMask
+    {
+    public:
+        RegionMask() = default;
+        explicit RegionMask(RegionSettings settings);
+
+        bool IsAllowed(double x, double y) const;
+
+        /**
+         * @brief Bounding box of all regions of interest, or the full frame when none are configured.
+         */
+        NormalizedRect BoundingBox() const;
+
+        bool IsFullFrame() const;
+
+    private:
+        struct CompiledPolygon
+        {
+            Polygon points;
+            NormalizedRect bounds;
+        };
+
+        static CompiledPolygon Compile(Polygon polygon);
+        static bool Contains(const CompiledPolygon& polygon, double x, double y);
+
+        std::vector<CompiledPolygon> regions_;
+        std::vector<CompiledPolygon> exclusions_;
+        NormalizedRect bounds_ {0.0, 0.0, 1.0, 1.0};
+    };
+}
@@ -0,0 +1,141 @@
+#include "SafetyStateChannel.h"
+#include "../Logger/Logger.h"
+#include <stdexcept>
+
+namespace DebuggerInfrastructure
+{
+    Seqlock<SafetyState>                                SafetyStateChannel::state;
+    std::mutex                                          SafetyStateChannel::mtx;
+    std::condition_variable                             SafetyStateChannel::cv;
+    bool                                                SafetyStateChannel::closed = false;
+    uint64_t                                            SafetyStateChannel::waiters = 0;
+    std::mutex                                          SafetyStateChannel::dispatchMtx;
+    std::map<SafetySubscriberId, SafetyStateChannel::Subscriber> SafetyStateChannel::subscribers;
+    SafetySubscriberId                                  SafetyStateChannel::nextSubscriber = 1;
+    std::atomic<size_t>                                 SafetyStateChannel::subscriberCount{0};
+    std::atomic<uint64_t>                               SafetyStateChannel::deliveries{0};
+    std::atomic<uint64_t>                               SafetyStateChannel::coalesced{0};
+    std::thread                                         SafetyStateChannel::thread;
+    bool                                                SafetyStateChannel::running = false;
+
+    void SafetyStateChannel::Initialize()
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        if (running) {
+            throw std::runtime_error("SafetyStateChannel is already initialized");
+        }
+        closed = false;
+        running = true;
+        thread = std::thread(&SafetyStateChannel::ThreadFunc);
+    }
+
+    void SafetyStateChannel::Dispose()
+    {
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            running = false;
+            closed = true;
+        }
+        cv.notify_all();
+        if (thread.joinable()) thread.join();
+    }
+
+    SafetyState SafetyStateChannel::Publish(bool locked, uint32_t reasonMask, uint32_t recoveringMask)
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        SafetyState next = state.Load();
+        if (next.version != 0 && next.locked == locked && next.reasonMask == reasonMask && next.recoveringMask == recoveringMask) {
+            return next;
+        }
+        if (locked && !next.locked) next.locks++;
+        if (!locked && next.locked) next.unlocks++;
+        next.version++;
+        next.locked = locked;
+        next.reasonMask = reasonMask;
+        next.recoveringMask = recoveringMask;
+        next.changedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        state.Store(next);
+        cv.notify_all();
+        return next;
+    }
+
+    SafetyState SafetyStateChannel::Current()
+    {
+        return state.Load();
+    }
+
+    std::optional<SafetyState> SafetyStateChannel::WaitNewer(uint64_t version, std::chrono::milliseconds timeout)
+    {
+        std::unique_lock<std::mutex> lk(mtx);
+        waiters++;
+        cv.wait_for(lk, timeout, [version] { return closed || state.Load().version > version; });
+        waiters--;
+        if (closed) return std::nullopt;
+        return state.Load();
+    }
+
+    SafetySubscriberId SafetyStateChannel::Subscribe(const std::string& name,
+                                                     std::function<void(const SafetyState&, const SafetyState&)> callback)
+    {
+        std::lock_guard<std::mutex> dlk(dispatchMtx);
+        SafetySubscriberId id = nextSubscriber++;
+        subscribers.emplace(id, Subscriber{name, std::move(callback)});
+        subscriberCount.store(subscribers.size());
+        return id;
+    }
+
+    void SafetyStateChannel::Unsubscribe(SafetySubscriberId id)
+    {
+        std::lock_guard<std::mutex> dlk(dispatchMtx);
+        subscribers.erase(id);
+        subscriberCount.store(subscribers.size());
+    }
+
+    SafetyStateStats SafetyStateChannel::GetStats()
+    {
+        SafetyStateStats stats;
+        stats.version = state.Load().version;
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            stats.waiters = waiters;
+        }
+        stats.deliveries = deliveries.load();
+        stats.coalesced = coalesced.load();
+        stats.subscribers = subscriberCount.load();
+        return stats;
+    }
+
+    void SafetyStateChannel::ThreadFunc()
+    {
+        // From the version before the first, so a state published before Initialize (StateJournal subscribes
+        // first, a fail-closed lock may come early) still reaches the subscribers
+        SafetyState previous;
+        while (true) {
+            std::optional<SafetyState> current = WaitNewer(previous.version, std::chrono::seconds(1));
+            if (!current) {
+                // Disposed: the last transition (the lock of a shutdown, say) is still delivered
+                SafetyState last = state.Load();
+                if (last.version > previous.version) Dispatch(previous, last);
+                return;
+            }
+            if (current->version == previous.version) continue;
+            Dispatch(previous, *current);
+            previous = *current;
+        }
+    }
+
+    void SafetyStateChannel::Dispatch(const SafetyState& previous, const SafetyState& current)
+    {
+        std::lock_guard<std::mutex> dlk(dispatchMtx);
+        coalesced += current.version - previous.version - 1;
+        for (auto& [id, subscriber] : subscribers) {
+            try {
+                subscriber.callback(previous, current);
+            } catch (const std::exception& ex) {
+                Logger::Error("Safety state subscriber {} failed: {}", subscriber.name, ex.what());
+            }
+            deliveries++;
+        }
+    }
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include "../Seqlock/Seqlock.h"
+
+namespace DebuggerInfrastructure
+{
+    /**
+     * @brief One version of the safety state, as published by DeadLocker.
+     */
+    struct SafetyState
+    {
+        uint64_t version = 0;           ///< Grows by one with every change, 0 before the first.
+        bool locked = false;
+        uint32_t reasonMask = 0;        ///< One bit per LockReason.
+        uint32_t recoveringMask = 0;    ///< Reasons counting down to their unlock.
+        uint64_t locks = 0;             ///< Lock transitions so far, a coalesced waiter still sees how many it missed.
+        uint64_t unlocks = 0;
+        int64_t changedNs = 0;          ///< system_clock ns since epoch.
+    };
+
+    struct SafetyStateStats
+    {
+        uint64_t version = 0;
+        uint64_t deliveries = 0;        ///< Subscriber calls.
+        uint64_t coalesced = 0;         ///< Versions the subscribers skipped because a newer one was already there.
+        uint64_t waiters = 0;           ///< Blocked in WaitNewer now.
+        size_t subscribers = 0;
+    };
+
+    using SafetySubscriberId = uint64_t;
+
+    /**
+     * @brief Tells everyone who is not on the cut path that the safety state changed.
+     *
+     * DeadLocker still cuts the lasers and parks the servos itself, then publishes the new state here. Every
+     * change gets the next version. Current() is lock-free. WaitNewer() blocks a caller (a long-poll or SSE
+     * client, for instance) until the version passes the one it has seen. Subscribers are called one after another
+     * on the channel's own thread with the latest state. Changes that pile up while they run are coalesced into
+     * one call, so a slow subscriber delays only itself and the other subscribers, never the interlock.
+     */
+    class SafetyStateChannel
+    {
+    public:
+        static void Initialize();
+        // Releases every waiter, delivers a change the subscribers have not seen yet and stops their thread
+        static void Dispose();
+
+        // Caller serializes the publishes (DeadLocker holds its mutex). An unchanged state publishes nothing
+        static SafetyState Publish(bool locked, uint32_t reasonMask, uint32_t recoveringMask);
+        static SafetyState Current();
+        /**
+         * @brief Blocks until the version is newer than the given one or the timeout passes.
+         * @return The current state, with the same version on a timeout; nullopt once the channel is disposed.
+         */
+        static std::optional<SafetyState> WaitNewer(uint64_t version, std::chrono::milliseconds timeout);
+
+        // The callback gets the state it was last called with and the current one
+        static SafetySubscriberId Subscribe(const std::string& name,
+                                            std::function<void(const SafetyState& previous, const SafetyState& current)> callback);
+        // Returns once a running call of the subscriber is done
+        static void Unsubscribe(SafetySubscriberId id);
+
+        static SafetyStateStats GetStats();
+
+    private:
+        struct Subscriber
+        {
+            std::string name;
+            std::function<void(const SafetyState&, const SafetyState&)> callback;
+        };
+
+        static void ThreadFunc();
+        static void Dispatch(const SafetyState& previous, const SafetyState& current);
+
+        static Seqlock<SafetyState> state;
+        // Publish, the waiters and closed
+        static std::mutex mtx;
+        static std::condition_variable cv;
+        static bool closed;
+        static uint64_t waiters;
+        // Held while the subscribers run
+        static std::mutex dispatchMtx;
+        static std::map<SafetySubscriberId, Subscriber> subscribers;
+        static SafetySubscriberId nextSubscriber;
+        // Readable without waiting for a slow subscriber
+        static std::atomic<size_t> subscriberCount;
+        static std::atomic<uint64_t> deliveries;
+        static std::atomic<uint64_t> coalesced;
+        static std::thread thread;
+        static bool running;
+    };
+}
@@ -0,0 +1,175 @@
+#include "SafetyTrace.h"
+#include "../DbHandler/DbHandler.h"
+#include "../Logger/Logger.h"
+#include "../RecordQueue/RecordQueue.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace DebuggerInfrastructure
+{
+    thread_local SafetyTrace::Scope*                                    SafetyTrace::current = nullptr;
+    std::mutex                                                          SafetyTrace::mtx;
+    SafetyTraceSettings                                                 SafetyTrace::settings;
+    std::array<SafetyTrace::ReasonStats, size_t(LockReason::Count)>     SafetyTrace::stats;
+
+    SafetyTrace::Scope::Scope(LockReason reason, Clock::time_point origin)
+        : m_previous(current)
+        , m_reason(reason)
+        , m_hops{}
+    {
+        m_hops[size_t(TraceHop::Origin)] = origin;
+        current = this;
+    }
+
+    SafetyTrace::Scope::~Scope()
+    {
+        current = m_previous;
+        if (m_hops[size_t(TraceHop::LaserCut)] == Clock::time_point{}) return;
+        try {
+            SafetyTrace::record(*this);
+        } catch (const std::exception& ex) {
+            Logger::Error("Could not record the safety trace: {}", ex.what());
+        }
+    }
+
+    void SafetyTrace::Initialize(SafetyTraceSettings newSettings)
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        settings = newSettings;
+    }
+
+    void SafetyTrace::Mark(TraceHop hop, Clock::time_point at)
+    {
+        if (current == nullptr) return;
+        Clock::time_point& slot = current->m_hops[size_t(hop)];
+        // The first time counts, the lock path may pass a hop twice
+        if (slot == Clock::time_point{}) slot = at;
+    }
+
+    std::string_view SafetyTrace::HopName(TraceHop hop)
+    {
+        switch (hop) {
+            case TraceHop::Origin:          return "origin";
+            case TraceHop::Detected:        return "detected";
+            case TraceHop::Initiated:       return "initiated";
+            case TraceHop::MotionDisarmed:  return "motionDisarmed";
+            case TraceHop::LaserCut:        return "laserCut";
+            case TraceHop::ServosParked:    return "servosParked";
+            default:                        return "unknown";
+        }
+    }
+
+    double SafetyTrace::budgetMs(LockReason reason)
+    {
+        return reason == LockReason::NeuralNetworkHandler ? settings.visionBudgetMs : settings.directBudgetMs;
+    }
+
+    void SafetyTrace::record(const Scope& scope)
+    {
+        Clock::time_point origin = scope.m_hops[size_t(TraceHop::Origin)];
+        auto sinceOrigin = [&](TraceHop hop) -> double {
+            Clock::time_point at = scope.m_hops[size_t(hop)];
+            return at == Clock::time_point{} ? -1.0 : std::chrono::duration<double, std::micro>(at - origin).count();
+        };
+
+        double laserCutUs = sinceOrigin(TraceHop::LaserCut);
+        double budgetUs;
+        bool over;
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            budgetUs = budgetMs(scope.m_reason) * 1000.0;
+            over = laserCutUs > budgetUs;
+            ReasonStats& reason = stats[size_t(scope.m_reason)];
+            reason.traces++;
+            if (over) reason.overBudget++;
+            for (size_t i = 0; i < size_t(TraceHop::Count); i++) {
+                double us = sinceOrigin(static_cast<TraceHop>(i));
+                if (us < 0.0) continue;
+                Histogram& histogram = reason.hops[i];
+                histogram.buckets[bucketOf(uint64_t(us))]++;
+                histogram.lastUs = us;
+                histogram.maxUs = std::max(histogram.maxUs, us);
+            }
+        }
+
+        std::string_view name = DeadLocker::ReasonName(scope.m_reason);
+        SafetyTraceData data;
+        data.time = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+        data.reason = std::string(name);
+        data.detectedUs = int64_t(sinceOrigin(TraceHop::Detected));
+        data.initiatedUs = int64_t(sinceOrigin(TraceHop::Initiated));
+        data.motionDisarmedUs = int64_t(sinceOrigin(TraceHop::MotionDisarmed));
+        data.laserCutUs = int64_t(laserCutUs);
+        data.servosParkedUs = int64_t(sinceOrigin(TraceHop::ServosParked));
+        data.budgetUs = int64_t(budgetUs);
+
+        // The scope may close on the GPIO event loop, the console and the database are written elsewhere
+        RecordQueue::Post([data = std::move(data), name, laserCutUs, budgetUs, over] {
+            if (over) {
+                Logger::Critical("Safety budget exceeded: {} cut the laser {:.0f} us after its trigger, budget {:.0f} us",
+                                 name, laserCutUs, budgetUs);
+            } else {
+                Logger::Info("{} cut the laser {:.0f} us after its trigger", name, laserCutUs);
+            }
+            DbHandler::InsertSafetyTrace(data);
+        });
+    }
+
+    size_t SafetyTrace::bucketOf(uint64_t us)
+    {
+        if (us < SubBuckets) return us;
+        // The leading bit picks the power of two, the next three bits the sub-bucket
+        unsigned octave = std::bit_width(us) - 1;
+        size_t sub = (us >> (octave - 3)) & (SubBuckets - 1);
+        return std::min<size_t>((octave - 2) * SubBuckets + sub, Buckets - 1);
+    }
+
+    double SafetyTrace::bucketUpperUs(size_t bucket)
+    {
+        if (bucket < SubBuckets) return double(bucket + 1);
+        unsigned octave = unsigned(bucket / SubBuckets) + 2;
+        size_t sub = bucket % SubBuckets;
+        return std::ldexp(double(SubBuckets + sub + 1), int(octave) - 3);
+    }
+
+    double SafetyTrace::percentile(const Histogram& histogram, uint64_t total, double fraction)
+    {
+        if (total == 0) return 0.0;
+        uint64_t rank = std::max<uint64_t>(1, uint64_t(fraction * double(total) + 0.5));
+        uint64_t seen = 0;
+        for (size_t bucket = 0; bucket < Buckets; bucket++) {
+            seen += histogram.buckets[bucket];
+            if (seen >= rank) {
+                // The upper bound of the bucket, so it never reports better than measured
+                return std::min(bucketUpperUs(bucket), histogram.maxUs);
+            }
+        }
+        return histogram.maxUs;
+    }
+
+    std::vector<SafetyTraceStats> SafetyTrace::GetStats()
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        std::vector<SafetyTraceStats> result;
+        for (size_t r = 0; r < size_t(LockReason::Count); r++) {
+            const ReasonStats& reason = stats[r];
+            SafetyTraceStats entry;
+            entry.reason = static_cast<LockReason>(r);
+            entry.traces = reason.traces;
+            entry.overBudget = reason.overBudget;
+            entry.budgetMs = budgetMs(entry.reason);
+            for (size_t i = 0; i < size_t(TraceHop::Count); i++) {
+                const Histogram& histogram = reason.hops[i];
+                uint64_t total = 0;
+                for (uint64_t count : histogram.buckets) total += count;
+                entry.hops[i] = HopLatency{histogram.lastUs,
+                                           percentile(histogram, total, 0.5),
+                                           percentile(histogram, total, 0.99),
+                                           histogram.maxUs};
+            }
+            result.push_back(entry);
+        }
+        return result;
+    }
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+#include <vector>
+#include "../DeadLocker/DeadLocker.h"
+
+namespace DebuggerInfrastructure
+{
+    /**
+     * @brief The hops of the path from a trigger to the laser being off, in the order they are reached.
+     */
+    enum class TraceHop : uint8_t
+    {
+        Origin,             ///< Frame captured, button edge, request received
+        Detected,           ///< Inference done, edge handled
+        Initiated,          ///< DeadLocker::EmergencyInitiate holds its lock
+        MotionDisarmed,     ///< Every motion controller disarmed
+        LaserCut,           ///< Every laser line driven low
+        ServosParked,       ///< Every servo locked
+        Count
+    };
+
+    struct SafetyTraceSettings
+    {
+        double visionBudgetMs = 250.0;      ///< Frame capture to laser off, includes the inference.
+        double directBudgetMs = 5.0;        ///< Button edge or REST veto to laser off.
+    };
+
+    struct HopLatency
+    {
+        double lastUs = 0.0;                ///< Since the origin.
+        double p50Us = 0.0;                 ///< Upper bound of the histogram bucket.
+        double p99Us = 0.0;
+        double maxUs = 0.0;
+    };
+
+    struct SafetyTraceStats
+    {
+        LockReason reason;
+        uint64_t traces = 0;
+        uint64_t overBudget = 0;
+        double budgetMs = 0.0;
+        std::array<HopLatency, size_t(TraceHop::Count)> hops;
+    };
+
+    /**
+     * @brief Timestamps every hop of an emergency from its trigger to the laser going low.
+     *
+     * The lock path runs synchronously on the thread that raised the emergency, so a Scope opened there
+     * collects the hops marked further down by DeadLocker, AimHandler and LaserHandler without passing
+     * anything through their interfaces. A trace is kept only if it reached LaserCut, emergencies raised
+     * while already locked cut nothing. Kept traces go into a per reason histogram at once. The database record
+     * and the log line, Critical for a trace over its budget, are posted to the RecordQueue.
+     *
+     * Timestamps are std::chrono::steady_clock, the CLOCK_MONOTONIC of the GPIO edge events.
+     */
+    class SafetyTrace
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        class Scope
+        {
+        public:
+            Scope(LockReason reason, Clock::time_point origin);
+            // Records the trace if the laser was cut while it was open
+            ~Scope();
+
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+
+        private:
+            Scope* m_previous;
+            LockReason m_reason;
+            std::array<Clock::time_point, size_t(TraceHop::Count)> m_hops;
+
+            friend class SafetyTrace;
+        };
+
+        static void Initialize(SafetyTraceSettings settings);
+        // Stamps the hop on the Scope open on this thread, does nothing without one
+        static void Mark(TraceHop hop, Clock::time_point at = Clock::now());
+        static std::vector<SafetyTraceStats> GetStats();
+        static std::string_view HopName(TraceHop hop);
+
+    private:
+        // Microseconds in 8 buckets per power of two (within 12.5 %), the last one takes everything from about 70 minutes on
+        static constexpr size_t SubBuckets = 8;
+        static constexpr size_t Buckets = 240;
+        struct Histogram
+        {
+            std::array<uint64_t, Buckets> buckets {};
+            double lastUs = 0.0;
+            double maxUs = 0.0;
+        };
+        struct ReasonStats
+        {
+            uint64_t traces = 0;
+            uint64_t overBudget = 0;
+            std::array<Histogram, size_t(TraceHop::Count)> hops;
+        };
+
+        static void record(const Scope& scope);
+        static double budgetMs(LockReason reason);
+        static size_t bucketOf(uint64_t us);
+        static double bucketUpperUs(size_t bucket);
+        static double percentile(const Histogram& histogram, uint64_t total, double fraction);
+
+        static thread_local Scope* current;
+        static std::mutex mtx;
+        static SafetyTraceSettings settings;
+        static std::array<ReasonStats, size_t(LockReason::Count)> stats;
+    };
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <type_traits>
+
+namespace DebuggerInfrastructure
+{
+    /**
+     * @brief Single-value sequence lock: readers never block, writers are serialized and publish whole snapshots.
+     *
+     * The value is kept as an array of atomic words, so a reader racing a writer copies torn but well-defined
+     * data, notices the changed sequence and retries. Nothing is a plain data race, which keeps ThreadSanitizer
+     * quiet without suppressions. Meant for small, rarely written state read on hot paths.
+     */
+    template <typename T>
+    class Seqlock
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Seqlock values are copied word by word");
+
+    public:
+        Seqlock()
+            : Seqlock(T{})
+        {
+        }
+
+        explicit Seqlock(const T& value)
+        {
+            Store(value);
+        }
+
+        Seqlock(const Seqlock&) = delete;
+        Seqlock& operator=(const Seqlock&) = delete;
+
+        T Load() const
+        {
+            Words copy;
+            while (true) {
+                uint64_t before = sequence_.load(std::memory_order_acquire);
+                if (before & 1) continue;
+                // Acquire per word instead of a fence (which ThreadSanitizer cannot model): the sequence
+                // is read again after the words, and a word from a write in progress brings its odd sequence
+                for (size_t i = 0; i < wordCount; i++) {
+                    copy[i] = words_[i].load(std::memory_order_acquire);
+                }
+                if (sequence_.load(std::memory_order_relaxed) == before) break;
+            }
+            T value;
+            std::memcpy(static_cast<void*>(&value), copy.data(), sizeof(T));
+            return value;
+        }
+
+        void Store(const T& value)
+        {
+            std::lock_guard<std::mutex> lock(writeMutex_);
+            Publish(value);
+        }
+
+        /**
+         * @brief Read-modify-write under the writer lock, returns the published value.
+         */
+        template <typename F>
+        T Update(F&& modify)
+        {
+            std::lock_guard<std::mutex> lock(writeMutex_);
+            T value = Unpack();
+            modify(value);
+            Publish(value);
+            return value;
+        }
+
+    private:
+        static constexpr size_t wordCount = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+        using Words = std::array<uint64_t, wordCount>;
+
+        // Only called with writeMutex_ held, so nobody else changes the words meanwhile
+        T Unpack() const
+        {
+            Words copy;
+            for (size_t i = 0; i < wordCount; i++) {
+                copy[i] = words_[i].load(std::memory_order_relaxed);
+            }
+            T value;
+            std::memcpy(static_cast<void*>(&value), copy.data(), sizeof(T));
+            return value;
+        }
+
+        void Publish(const T& value)
+        {
+            Words copy {};
+            std::memcpy(copy.data(), &value, sizeof(T));
+            uint64_t sequence = sequence_.load(std::memory_order_relaxed);
+            sequence_.store(sequence + 1, std::memory_order_relaxed);
+            // Release per word, a reader that sees any new word also sees the odd sequence
+            for (size_t i = 0; i < wordCount; i++) {
+                words_[i].store(copy[i], std::memory_order_release);
+            }
+            sequence_.store(sequence + 2, std::memory_order_release);
+        }
+
+        std::atomic<uint64_t> sequence_ {0};
+        std::array<std::atomic<uint64_t>, wordCount> words_ {};
+        std::mutex writeMutex_;
+    };
+}
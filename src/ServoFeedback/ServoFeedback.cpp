@@ -0,0 +1,251 @@
+#include "ServoFeedback.h"
+#include "../GPIOHandler/GPIOHandler.h"
+#include "../ServoHandler/ServoHandler.h"
+#include "../ServoHandler/SimulatedPwmTree.h"
+#include "../Logger/Logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace DebuggerInfrastructure
+{
+    namespace
+    {
+        // A sample older than this many periods is stale, the sampler stopped or the sensor fails
+        constexpr int64_t stalePeriods = 5;
+
+        int64_t steadyNs()
+        {
+            return std::chrono::steady_clock::now().time_since_epoch().count();
+        }
+    }
+
+    SysfsAdcReader::SysfsAdcReader(const std::string& path, double rawAtMin, double rawAtMax)
+        : m_path(path)
+        , m_fd(open(path.c_str(), O_RDONLY | O_CLOEXEC))
+        , m_rawAtMin(rawAtMin)
+        , m_rawAtMax(rawAtMax)
+    {
+        if (m_fd < 0) {
+            throw std::runtime_error("Could not open the ADC channel " + path + ": " + strerror(errno));
+        }
+        if (m_rawAtMax == m_rawAtMin) {
+            close(m_fd);
+            throw std::runtime_error("ADC channel " + path + " needs different readings at the two ends");
+        }
+    }
+
+    SysfsAdcReader::~SysfsAdcReader()
+    {
+        close(m_fd);
+    }
+
+    std::optional<double> SysfsAdcReader::Read()
+    {
+        // sysfs attributes are re-read from offset 0, one pread per sample
+        char buffer[32];
+        ssize_t length = pread(m_fd, buffer, sizeof(buffer) - 1, 0);
+        if (length <= 0) return std::nullopt;
+        buffer[length] = '\0';
+        char* end = nullptr;
+        long raw = std::strtol(buffer, &end, 10);
+        if (end == buffer) return std::nullopt;
+        double fraction = (double(raw) - m_rawAtMin) / (m_rawAtMax - m_rawAtMin);
+        return kMinAngle + fraction * (kMaxAngle - kMinAngle);
+    }
+
+    SimulatedServoReader::SimulatedServoReader(int pwmChip, int pwmChannel)
+        : m_pwmChip(pwmChip)
+        , m_pwmChannel(pwmChannel)
+    {
+    }
+
+    std::optional<double> SimulatedServoReader::Read()
+    {
+        return SimulatedPwmTree::GetAngle(m_pwmChip, m_pwmChannel);
+    }
+
+    ServoFeedback::ServoFeedback(const FeedbackSettings& settings, int pwmChip, int xChannel, int yChannel)
+        : m_settings(settings)
+        , m_staleNs(0)
+        , m_angle(0)
+        , m_sampledNs(0)
+    {
+        if (m_settings.sampleHz <= 0.0 || m_settings.toleranceDeg <= 0.0) {
+            throw std::runtime_error("Servo feedback sample rate and tolerance must be positive");
+        }
+        m_readers[size_t(FeedbackAxis::X)] = MakeReader(m_settings.x, pwmChip, xChannel);
+        m_readers[size_t(FeedbackAxis::Y)] = MakeReader(m_settings.y, pwmChip, yChannel);
+        if (bool(m_readers[0]) != bool(m_readers[1])) {
+            throw std::runtime_error("Servo feedback needs an angle sensor on both axes or on none");
+        }
+
+        const AxisFeedbackSettings* axes[] = {&m_settings.x, &m_settings.y};
+        for (size_t axis = 0; axis < size_t(FeedbackAxis::Count); axis++) {
+            m_limits[axis * 2].line = axes[axis]->minLimitLine;
+            m_limits[axis * 2 + 1].line = axes[axis]->maxLimitLine;
+        }
+
+        try {
+            for (LimitSwitch& limit : m_limits) {
+                if (limit.line < 0) continue;
+                unsigned int line = static_cast<unsigned int>(limit.line);
+                GPIOHandler::RequestLineEvents(line, "ServoLimitSwitch");
+                m_limitLines.push_back(line);
+                // Active low like the emergency button, closed pulls the line to ground
+                limit.closed.store(GPIOHandler::GetValue(line) == 0);
+                GPIOHandler::Watch(line, [this, &limit](unsigned int, const GpioEvent& event) { OnLimitEdge(limit, event); });
+            }
+            if (HasAngleSensor()) {
+                auto period = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(1.0 / m_settings.sampleHz));
+                m_staleNs = stalePeriods * period.count();
+                m_sampler = GPIOHandler::Sample(period, [this] { Sample(); });
+            }
+        } catch (...) {
+            Close();
+            throw;
+        }
+
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        m_stats.angleSensor = HasAngleSensor();
+        m_stats.limitSwitches = !m_limitLines.empty();
+    }
+
+    ServoFeedback::~ServoFeedback()
+    {
+        Close();
+    }
+
+    void ServoFeedback::Close()
+    {
+        if (m_sampler) {
+            GPIOHandler::Unsample(*m_sampler);
+            m_sampler.reset();
+        }
+        for (unsigned int line : m_limitLines) {
+            GPIOHandler::Unwatch(line);
+            GPIOHandler::ReleaseLine(line);
+        }
+        m_limitLines.clear();
+    }
+
+    const FeedbackSettings& ServoFeedback::GetSettings() const
+    {
+        return m_settings;
+    }
+
+    bool ServoFeedback::HasAngleSensor() const
+    {
+        return m_readers[0] != nullptr;
+    }
+
+    std::optional<std::pair<double, double>> ServoFeedback::Angle(std::chrono::steady_clock::time_point* sampledAt) const
+    {
+        int64_t sampled = m_sampledNs.load(std::memory_order_acquire);
+        if (sampled == 0 || steadyNs() - sampled > m_staleNs) return std::nullopt;
+        // The angle is stored before its time, a newer angle with the older time only looks older
+        auto angle = Unpack(m_angle.load(std::memory_order_acquire));
+        if (sampledAt) *sampledAt = std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(sampled));
+        return angle;
+    }
+
+    bool ServoFeedback::LimitClosed(FeedbackAxis axis, double direction) const
+    {
+        if (direction == 0.0) return false;
+        return m_limits[size_t(axis) * 2 + (direction > 0.0 ? 1 : 0)].closed.load(std::memory_order_acquire);
+    }
+
+    void ServoFeedback::Sample()
+    {
+        // Both axes in one go, so the pair is one instant of the turret
+        auto x = m_readers[size_t(FeedbackAxis::X)]->Read();
+        auto y = m_readers[size_t(FeedbackAxis::Y)]->Read();
+        int64_t now = steadyNs();
+        {
+            std::lock_guard<std::mutex> lock(m_statsMutex);
+            if (!x || !y) {
+                m_stats.readErrors++;
+                return;
+            }
+            m_stats.samples++;
+            m_stats.angle = {*x, *y};
+        }
+        m_angle.store(Pack({*x, *y}), std::memory_order_release);
+        m_sampledNs.store(now, std::memory_order_release);
+    }
+
+    void ServoFeedback::OnLimitEdge(LimitSwitch& limit, const GpioEvent& event)
+    {
+        bool closed = !event.rising;
+        if (limit.closed.exchange(closed) == closed || !closed) return;
+        {
+            std::lock_guard<std::mutex> lock(m_statsMutex);
+            m_stats.limitTrips++;
+        }
+        Logger::Warning("Servo limit switch on GPIO line {} closed", limit.line);
+    }
+
+    void ServoFeedback::RecordResponse(double responseMs, double settleMs, double errorDeg)
+    {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        m_stats.responses++;
+        double n = double(m_stats.responses);
+        m_stats.lastResponseMs = responseMs;
+        m_stats.meanResponseMs += (responseMs - m_stats.meanResponseMs) / n;
+        m_stats.maxResponseMs = std::max(m_stats.maxResponseMs, responseMs);
+        m_stats.lastSettleMs = settleMs;
+        m_stats.meanSettleMs += (settleMs - m_stats.meanSettleMs) / n;
+        m_stats.maxSettleMs = std::max(m_stats.maxSettleMs, settleMs);
+        m_stats.lastErrorDeg = errorDeg;
+    }
+
+    void ServoFeedback::RecordTimeout()
+    {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        m_stats.timeouts++;
+    }
+
+    void ServoFeedback::RecordLimitStop()
+    {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        m_stats.limitStops++;
+    }
+
+    FeedbackStats ServoFeedback::GetStats() const
+    {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        return m_stats;
+    }
+
+    std::unique_ptr<AngleReader> ServoFeedback::MakeReader(const AxisFeedbackSettings& settings, int pwmChip, int channel)
+    {
+        if (settings.source == "none") return nullptr;
+        if (settings.source == "adc") return std::make_unique<SysfsAdcReader>(settings.adcPath, settings.rawAtMin, settings.rawAtMax);
+        if (settings.source == "simulated") {
+            if (!SimulatedPwmTree::GetAngle(pwmChip, channel)) {
+                throw std::runtime_error(fmt::format("pwmchip{} channel {} is not a simulated servo", pwmChip, channel));
+            }
+            return std::make_unique<SimulatedServoReader>(pwmChip, channel);
+        }
+        throw std::runtime_error("Unknown servo feedback source \"" + settings.source + "\"");
+    }
+
+    uint64_t ServoFeedback::Pack(std::pair<double, double> value)
+    {
+        float parts[2] = {float(value.first), float(value.second)};
+        uint64_t packed;
+        std::memcpy(&packed, parts, sizeof(packed));
+        return packed;
+    }
+
+    std::pair<double, double> ServoFeedback::Unpack(uint64_t value)
+    {
+        float parts[2];
+        std::memcpy(parts, &value, sizeof(parts));
+        return {parts[0], parts[1]};
+    }
+}
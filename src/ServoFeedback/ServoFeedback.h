@@ -0,0 +1,172 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../GPIOHandler/GpioEventLoop.h"
+
+namespace DebuggerInfrastructure
+{
+    enum class FeedbackAxis : uint8_t
+    {
+        X,
+        Y,
+        Count
+    };
+
+    struct AxisFeedbackSettings
+    {
+        std::string source = "none";    ///< "none", "adc" (a sysfs IIO channel) or "simulated" (the simulated servo)
+        std::string adcPath;            ///< e.g. /sys/bus/iio/devices/iio:device0/in_voltage0_raw
+        double rawAtMin = 0.0;          ///< ADC reading at kMinAngle
+        double rawAtMax = 4095.0;       ///< ADC reading at kMaxAngle
+        int minLimitLine = -1;          ///< GPIO limit switch at the low end, active low, -1 for none
+        int maxLimitLine = -1;          ///< GPIO limit switch at the high end, active low, -1 for none
+    };
+
+    struct FeedbackSettings
+    {
+        AxisFeedbackSettings x;
+        AxisFeedbackSettings y;
+        double sampleHz = 500.0;
+        double toleranceDeg = 1.0;      ///< Measured angle this close to the target counts as settled.
+        double timeoutMs = 500.0;       ///< Not settled this long after the commanded motion ended is reported.
+    };
+
+    struct FeedbackStats
+    {
+        bool angleSensor = false;
+        bool limitSwitches = false;
+        std::pair<double, double> angle {0.0, 0.0};   ///< Last measured, valid when angleSensor
+        uint64_t samples = 0;
+        uint64_t readErrors = 0;
+        uint64_t limitTrips = 0;
+        uint64_t limitStops = 0;        ///< Moves stopped short by a closed limit switch.
+        uint64_t responses = 0;         ///< Targets confirmed by the sensor.
+        uint64_t timeouts = 0;
+        double lastResponseMs = 0.0;    ///< Target posted to measured settle.
+        double meanResponseMs = 0.0;
+        double maxResponseMs = 0.0;
+        double lastSettleMs = 0.0;      ///< Commanded motion ended to measured settle, replaces the fixed settle delay.
+        double meanSettleMs = 0.0;
+        double maxSettleMs = 0.0;
+        double lastErrorDeg = 0.0;      ///< Largest axis error at the settle.
+    };
+
+    /**
+     * @brief Reads the actual angle of one servo axis in degrees. Empty when the reading failed.
+     *
+     * Called on the GPIO event loop thread, it should take microseconds.
+     */
+    class AngleReader
+    {
+    public:
+        virtual ~AngleReader() = default;
+        virtual std::optional<double> Read() = 0;
+    };
+
+    /**
+     * @brief A potentiometer or absolute encoder on a sysfs IIO channel, mapped linearly onto the servo range.
+     */
+    class SysfsAdcReader : public AngleReader
+    {
+    public:
+        SysfsAdcReader(const std::string& path, double rawAtMin, double rawAtMax);
+        ~SysfsAdcReader() override;
+        std::optional<double> Read() override;
+
+    private:
+        std::string m_path;
+        int m_fd;
+        double m_rawAtMin;
+        double m_rawAtMax;
+    };
+
+    /**
+     * @brief The horn of a SimulatedPwmTree servo.
+     */
+    class SimulatedServoReader : public AngleReader
+    {
+    public:
+        SimulatedServoReader(int pwmChip, int pwmChannel);
+        std::optional<double> Read() override;
+
+    private:
+        int m_pwmChip;
+        int m_pwmChannel;
+    };
+
+    /**
+     * @brief The optional position feedback of one turret: an angle sensor per axis and limit switches at the ends.
+     *
+     * Angle readers are sampled together by a sampler on the GPIO event loop and limit switches are watched
+     * edges on the same loop, so the feedback adds no thread. The latest sample is published lock-free for
+     * the motion controller, which settles on it instead of waiting a fixed delay and reports the measured
+     * response times back. A sample older than a few periods counts as missing, and the controller falls
+     * back to the fixed delay.
+     */
+    class ServoFeedback
+    {
+    public:
+        // Throws std::runtime_error when a configured reader or limit line cannot be opened
+        ServoFeedback(const FeedbackSettings& settings, int pwmChip, int xChannel, int yChannel);
+        ~ServoFeedback();
+
+        ServoFeedback(const ServoFeedback&) = delete;
+        ServoFeedback& operator=(const ServoFeedback&) = delete;
+
+        const FeedbackSettings& GetSettings() const;
+        bool HasAngleSensor() const;
+
+        /**
+         * @brief The last sample and its steady_clock time, empty without a sensor or when the sample is stale.
+         */
+        std::optional<std::pair<double, double>> Angle(std::chrono::steady_clock::time_point* sampledAt = nullptr) const;
+
+        /**
+         * @brief True while the limit switch at the end the axis moves towards is closed (direction < 0 the low end).
+         */
+        bool LimitClosed(FeedbackAxis axis, double direction) const;
+
+        void RecordResponse(double responseMs, double settleMs, double errorDeg);
+        void RecordTimeout();
+        void RecordLimitStop();
+        FeedbackStats GetStats() const;
+
+    private:
+        struct LimitSwitch
+        {
+            int line = -1;
+            std::atomic<bool> closed {false};
+        };
+
+        void Sample();
+        // Stops the sampler and releases the limit lines
+        void Close();
+        void OnLimitEdge(LimitSwitch& limit, const GpioEvent& event);
+        static std::unique_ptr<AngleReader> MakeReader(const AxisFeedbackSettings& settings, int pwmChip, int channel);
+        static uint64_t Pack(std::pair<double, double> value);
+        static std::pair<double, double> Unpack(uint64_t value);
+
+        FeedbackSettings m_settings;
+        std::array<std::unique_ptr<AngleReader>, size_t(FeedbackAxis::Count)> m_readers;
+        // Index: axis * 2 + (high end ? 1 : 0)
+        std::array<LimitSwitch, 2 * size_t(FeedbackAxis::Count)> m_limits;
+        std::vector<unsigned int> m_limitLines;
+        std::optional<GpioEventLoop::SamplerId> m_sampler;
+        int64_t m_staleNs;
+
+        std::atomic<uint64_t> m_angle;
+        std::atomic<int64_t> m_sampledNs;       ///< 0 until the first complete sample
+
+        mutable std::mutex m_statsMutex;
+        FeedbackStats m_stats;
+    };
+}
@@ -1,27 +1,62 @@
 #include "ServoHandler.h"
 #include "../Logger/Logger.h"
 #include "../GPIOHandler/GPIOHandler.h"
-
-#include <gpiod.h>
+#include "../StateJournal/StateJournal.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <charconv>
 #include <stdexcept>
 #include <chrono>
 #include <thread>
 namespace DebuggerInfrastructure
     {
-    ServoHandler::ServoHandler(int pwmChip, int pwmChannel, double frequency)
+    ServoHandler::ServoHandler(int pwmChip, int pwmChannel, double frequency, std::string sysfsRoot)
         : m_pwmChip(pwmChip)
         , m_pwmChannel(pwmChannel)
+        , m_sysfsRoot(sysfsRoot)
         , m_locked(false)
+        , m_dutyFd(-1)
+        , m_lastDutyNs(-1)
+        , m_writes(0)
+        , m_skipped(0)
+        , m_writeNsTotal(0)
+        , m_writeNsMax(0)
     {
-        m_basePath = "/sys/class/pwm/pwmchip" + std::to_string(m_pwmChip);
-        writeSysfs(m_basePath + "/export", std::to_string(m_pwmChannel));
+        m_chipPath = sysfsRoot + "/pwmchip" + std::to_string(m_pwmChip);
+        // Journaled first, a crash right after the export still leaves the channel to be released at the next start
+        StateJournal::RecordServo(m_sysfsRoot, m_pwmChip, m_pwmChannel, true);
+        writeSysfs(m_chipPath + "/export", std::to_string(m_pwmChannel));
         std::this_thread::sleep_for(std::chrono::milliseconds(10));
 
-        m_basePath += "/pwm" + std::to_string(m_pwmChannel);
+        m_basePath = m_chipPath + "/pwm" + std::to_string(m_pwmChannel);
 
         m_periodNs = (1.0 / frequency) * 1e9;
-        writeSysfs(m_basePath + "/period", std::to_string(static_cast<long>(m_periodNs)));
-        writeSysfs(m_basePath + "/enable", "1");
+        try {
+            writeSysfs(m_basePath + "/period", std::to_string(static_cast<long>(m_periodNs)));
+            writeSysfs(m_basePath + "/enable", "1");
+
+            std::string dutyPath = m_basePath + "/duty_cycle";
+            m_dutyFd = open(dutyPath.c_str(), O_WRONLY | O_CLOEXEC);
+            if (m_dutyFd < 0) {
+                throw std::runtime_error("Failed to open " + dutyPath + ": " + std::strerror(errno));
+            }
+        } catch (...) {
+            // No destructor runs for a half-built handler, give the channel back here
+            try {
+                writeSysfs(m_basePath + "/enable", "0");
+            } catch (const std::exception&) {}
+            try {
+                writeSysfs(m_chipPath + "/unexport", std::to_string(m_pwmChannel));
+                StateJournal::RecordServo(m_sysfsRoot, m_pwmChip, m_pwmChannel, false);
+            } catch (const std::exception& ex) {
+                Logger::Warning("pwmchip{}/pwm{} stays exported: {}", m_pwmChip, m_pwmChannel, ex.what());
+            }
+            throw;
+        }
 
         SetAngle(0.0);
         Logger::Info("ServoHandler initialized with hardware PWM.");
@@ -34,10 +69,18 @@ namespace DebuggerInfrastructure
             m_locked = true;
         }
 
-        writeSysfs(m_basePath + "/enable", "0");
+        ServoWriteStats stats = GetStats();
+        Logger::Info("Servo pwmchip{}/pwm{}: {} duty writes, {} skipped, avg {} us, max {} us per write.",
+                     m_pwmChip, m_pwmChannel, stats.writes, stats.skipped, stats.averageWriteUs, stats.maxWriteUs);
+
+        if (m_dutyFd >= 0) {
+            close(m_dutyFd);
+            m_dutyFd = -1;
+        }
 
-        std::string chipPath = "/sys/class/pwm/pwmchip" + std::to_string(m_pwmChip);
-        writeSysfs(chipPath + "/unexport", std::to_string(m_pwmChannel));
+        writeSysfs(m_basePath + "/enable", "0");
+        writeSysfs(m_chipPath + "/unexport", std::to_string(m_pwmChannel));
+        StateJournal::RecordServo(m_sysfsRoot, m_pwmChip, m_pwmChannel, false);
 
         Logger::Info("ServoHandler destroyed and PWM unexported.");
     }
@@ -46,7 +89,6 @@ namespace DebuggerInfrastructure
     {
         std::lock_guard<std::mutex> guard(m_mutex);
         if (m_locked) {
-            Logger::Info("SetAngle ignored: servo is locked.");
             return;
         }
 
@@ -56,18 +98,21 @@ namespace DebuggerInfrastructure
         double pulseUs = kMinPulseWidthUs +
                         (newAngle / (kMaxAngle - kMinAngle)) *
                         (kMaxPulseWidthUs - kMinPulseWidthUs);
-        long dutyNs = static_cast<long>(pulseUs * 1000.0);
+        long dutyNs = std::lround(pulseUs * 1000.0 / kDutyResolutionNs) * kDutyResolutionNs;
 
-        writeSysfs(m_basePath + "/duty_cycle", std::to_string(dutyNs));
-        Logger::Info("Servo angle set to " + std::to_string(newAngle) + " degrees.");
+        if (dutyNs == m_lastDutyNs) {
+            m_skipped++;
+            return;
+        }
+        writeDuty(dutyNs);
     }
 
     void ServoHandler::EmergencyDisableAndLock()
     {
         {
             std::lock_guard<std::mutex> guard(m_mutex);
-            writeSysfs(m_basePath + "/duty_cycle",
-                    std::to_string(static_cast<long>(kMinPulseWidthUs * 1000.0)));
+            // Always written, even if it looks redundant
+            writeDuty(static_cast<long>(kMinPulseWidthUs * 1000.0));
             m_locked = true;
         }
         Logger::Info("Emergency disable: servo locked at 0 degrees.");
@@ -86,6 +131,40 @@ namespace DebuggerInfrastructure
         return m_locked;
     }
 
+    ServoWriteStats ServoHandler::GetStats()
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        return ServoWriteStats{
+            m_writes,
+            m_skipped,
+            m_writes ? double(m_writeNsTotal) / double(m_writes) / 1000.0 : 0.0,
+            double(m_writeNsMax) / 1000.0
+        };
+    }
+
+    void ServoHandler::writeDuty(long dutyNs)
+    {
+        char buffer[24];
+        auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer) - 1, dutyNs);
+        if (ec != std::errc()) {
+            throw std::runtime_error("Failed to format duty cycle");
+        }
+        // Terminated, so a shorter value over a longer one still parses in a simulated tree (regular file)
+        *end++ = '\n';
+
+        auto start = std::chrono::steady_clock::now();
+        ssize_t length = end - buffer;
+        if (pwrite(m_dutyFd, buffer, length, 0) != length) {
+            throw std::runtime_error(std::string("Failed to write duty_cycle: ") + std::strerror(errno));
+        }
+        uint64_t elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+        m_lastDutyNs = dutyNs;
+        m_writes++;
+        m_writeNsTotal += elapsedNs;
+        m_writeNsMax = std::max(m_writeNsMax, elapsedNs);
+    }
+
     void ServoHandler::writeSysfs(const std::string &path, const std::string &value)
     {
         std::ofstream fs(path);
@@ -94,4 +173,4 @@ namespace DebuggerInfrastructure
         }
         fs << value;
     }
-}
\ No newline at end of file
+}
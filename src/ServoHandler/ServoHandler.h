@@ -14,28 +14,48 @@ namespace DebuggerInfrastructure
     static constexpr double kMaxPulseWidthUs = 2400.0;
     static constexpr double kMinAngle = 0.0;
     static constexpr double kMaxAngle = 180.0;
+    // Duty cycles are quantized to this step; commands that land on the current step are not written.
+    static constexpr long kDutyResolutionNs = 1000;
+
+    struct ServoWriteStats
+    {
+        uint64_t writes;
+        uint64_t skipped;
+        double averageWriteUs;
+        double maxWriteUs;
+    };
 
     class ServoHandler {
     public:
-        ServoHandler(int pwmChip, int pwmChannel, double frequency);
+        // sysfsRoot can point to a fake PWM tree for development and benchmarking.
+        ServoHandler(int pwmChip, int pwmChannel, double frequency, std::string sysfsRoot = "/sys/class/pwm");
         ~ServoHandler();
 
         void SetAngle(double newAngle);
         void EmergencyDisableAndLock();
         void Unlock();
         bool IsLocked();
+        ServoWriteStats GetStats();
 
     private:
         int m_pwmChip;
         int m_pwmChannel;
+        std::string m_sysfsRoot;
+        std::string m_chipPath;
         std::string m_basePath;
         double m_periodNs;
         std::atomic<bool> m_locked;
         std::mutex m_mutex;
 
+        // duty_cycle stays open for the lifetime of the servo, each command is a single pwrite
+        int m_dutyFd;
+        long m_lastDutyNs;
+        uint64_t m_writes;
+        uint64_t m_skipped;
+        uint64_t m_writeNsTotal;
+        uint64_t m_writeNsMax;
+
         void writeSysfs(const std::string &path, const std::string &value);
+        void writeDuty(long dutyNs);
     };
 } // namespace DebuggerInfrastructure
-
-
-
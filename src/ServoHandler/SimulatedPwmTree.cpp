@@ -0,0 +1,161 @@
+#include "SimulatedPwmTree.h"
+#include "ServoHandler.h"
+#include "../Logger/Logger.h"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace DebuggerInfrastructure
+{
+    std::mutex                              SimulatedPwmTree::mtx_;
+    std::vector<SimulatedPwmTree::Servo>    SimulatedPwmTree::servos_;
+    ServoModelSettings                      SimulatedPwmTree::model_;
+    std::string                             SimulatedPwmTree::root_;
+    std::thread                             SimulatedPwmTree::thread_;
+    std::atomic<bool>                       SimulatedPwmTree::running_{false};
+
+    namespace
+    {
+        void createFile(const std::filesystem::path& path, const std::string& value)
+        {
+            std::ofstream fs(path, std::ios::trunc);
+            if (!fs.is_open()) {
+                throw std::runtime_error("Failed to create " + path.string());
+            }
+            fs << value;
+        }
+    }
+
+    std::string SimulatedPwmTree::Initialize(const std::string& root, const std::vector<PwmChannel>& channels, ServoModelSettings model)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (running_) {
+            Logger::Info("SimulatedPwmTree already initialized at {}", root_);
+            return root_;
+        }
+
+        for (const PwmChannel& pwm : channels) {
+            std::filesystem::path chipPath = std::filesystem::path(root) / ("pwmchip" + std::to_string(pwm.chip));
+            std::filesystem::path channelPath = chipPath / ("pwm" + std::to_string(pwm.channel));
+            std::filesystem::create_directories(channelPath);
+            createFile(chipPath / "export", "");
+            createFile(chipPath / "unexport", "");
+            createFile(channelPath / "period", "0\n");
+            createFile(channelPath / "enable", "0\n");
+            createFile(channelPath / "duty_cycle", "0\n");
+
+            Servo servo;
+            servo.pwm = pwm;
+            servo.dutyFd = open((channelPath / "duty_cycle").c_str(), O_RDONLY | O_CLOEXEC);
+            servo.enableFd = open((channelPath / "enable").c_str(), O_RDONLY | O_CLOEXEC);
+            if (servo.dutyFd < 0 || servo.enableFd < 0) {
+                if (servo.dutyFd >= 0) close(servo.dutyFd);
+                if (servo.enableFd >= 0) close(servo.enableFd);
+                throw std::runtime_error("Failed to open the simulated PWM channel " + channelPath.string());
+            }
+            servos_.push_back(servo);
+        }
+
+        root_ = root;
+        model_ = model;
+        running_ = true;
+        thread_ = std::thread(&SimulatedPwmTree::ThreadFunc);
+        Logger::Info("Simulated PWM tree with {} servo(s) at {}", servos_.size(), root_);
+        return root_;
+    }
+
+    void SimulatedPwmTree::Dispose()
+    {
+        if (!running_.exchange(false)) return;
+        if (thread_.joinable()) thread_.join();
+
+        std::lock_guard<std::mutex> lock(mtx_);
+        for (Servo& servo : servos_) {
+            close(servo.dutyFd);
+            close(servo.enableFd);
+        }
+        servos_.clear();
+        Logger::Info("Disposed of SimulatedPwmTree.");
+    }
+
+    bool SimulatedPwmTree::IsInitialized()
+    {
+        return running_;
+    }
+
+    std::optional<double> SimulatedPwmTree::GetAngle(int chip, int channel)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        Servo* servo = Find(chip, channel);
+        if (!servo) return {};
+        return servo->angle;
+    }
+
+    std::optional<double> SimulatedPwmTree::GetCommandedAngle(int chip, int channel)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        Servo* servo = Find(chip, channel);
+        if (!servo) return {};
+        return servo->commanded;
+    }
+
+    SimulatedPwmTree::Servo* SimulatedPwmTree::Find(int chip, int channel)
+    {
+        auto it = std::find_if(servos_.begin(), servos_.end(), [&](const Servo& servo) {
+            return servo.pwm.chip == chip && servo.pwm.channel == channel;
+        });
+        return it == servos_.end() ? nullptr : &*it;
+    }
+
+    std::optional<long> SimulatedPwmTree::ReadNumber(int fd)
+    {
+        char buffer[32];
+        ssize_t length = pread(fd, buffer, sizeof(buffer), 0);
+        if (length <= 0) return {};
+        long value = 0;
+        auto [end, ec] = std::from_chars(buffer, buffer + length, value);
+        if (ec != std::errc()) return {};
+        return value;
+    }
+
+    void SimulatedPwmTree::Step(Servo& servo, double dt)
+    {
+        if (auto enable = ReadNumber(servo.enableFd)) servo.enabled = *enable == 1;
+        if (auto duty = ReadNumber(servo.dutyFd); duty && *duty > 0) {
+            double pulseUs = double(*duty) / 1000.0;
+            servo.commanded = std::clamp((pulseUs - kMinPulseWidthUs) / (kMaxPulseWidthUs - kMinPulseWidthUs) * (kMaxAngle - kMinAngle),
+                                         kMinAngle, kMaxAngle);
+        }
+        // Without the PWM signal the horn holds where it is
+        if (!servo.enabled) return;
+
+        double tau = std::max(model_.timeConstantMs / 1000.0, dt);
+        double velocity = std::clamp((servo.commanded - servo.angle) / tau, -model_.maxVelocity, model_.maxVelocity);
+        servo.angle += velocity * dt;
+    }
+
+    void SimulatedPwmTree::ThreadFunc()
+    {
+        const auto tick = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(1.0 / model_.tickHz));
+        auto next = std::chrono::steady_clock::now();
+        auto last = next;
+        while (running_) {
+            next += tick;
+            std::this_thread::sleep_until(next);
+            auto now = std::chrono::steady_clock::now();
+            double dt = std::chrono::duration<double>(now - last).count();
+            last = now;
+
+            std::lock_guard<std::mutex> lock(mtx_);
+            for (Servo& servo : servos_) {
+                Step(servo, dt);
+            }
+        }
+    }
+}
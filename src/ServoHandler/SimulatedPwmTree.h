@@ -0,0 +1,68 @@
+#pragma once
+
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <vector>
+
+namespace DebuggerInfrastructure
+{
+    struct PwmChannel
+    {
+        int chip = 0;
+        int channel = 0;
+    };
+
+    struct ServoModelSettings
+    {
+        double maxVelocity = 600.0;         ///< deg/s
+        double timeConstantMs = 25.0;       ///< first-order lag towards the commanded angle
+        double tickHz = 1000.0;
+    };
+
+    /**
+     * @brief A fake /sys/class/pwm tree on disk with a servo model behind every channel.
+     *
+     * ServoHandler is pointed at the tree instead of sysfs and runs unchanged. A thread reads the
+     * duty_cycle and enable files of every channel and moves a simulated horn towards the commanded
+     * angle with limited speed and a first-order lag, so the servo can be read back like a real one
+     * with a position sensor.
+     */
+    class SimulatedPwmTree
+    {
+    public:
+        // Creates the tree under root and returns the path to pass to ServoHandler
+        static std::string Initialize(const std::string& root, const std::vector<PwmChannel>& channels, ServoModelSettings model);
+        static void Dispose();
+        static bool IsInitialized();
+        // Simulated horn angle, empty for a channel that is not in the tree
+        static std::optional<double> GetAngle(int chip, int channel);
+        // Angle of the duty cycle written last
+        static std::optional<double> GetCommandedAngle(int chip, int channel);
+
+    private:
+        struct Servo
+        {
+            PwmChannel pwm;
+            int dutyFd = -1;
+            int enableFd = -1;
+            bool enabled = false;
+            double commanded = 0.0;
+            double angle = 0.0;
+        };
+
+        static void ThreadFunc();
+        static void Step(Servo& servo, double dt);
+        static std::optional<long> ReadNumber(int fd);
+        static Servo* Find(int chip, int channel);
+
+        static std::mutex mtx_;
+        static std::vector<Servo> servos_;
+        static ServoModelSettings model_;
+        static std::string root_;
+        static std::thread thread_;
+        static std::atomic<bool> running_;
+    };
+}
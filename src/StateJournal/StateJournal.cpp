@@ -0,0 +1,252 @@
+#include "StateJournal.h"
+#include "../GPIOHandler/GPIOHandler.h"
+#include "../Logger/Logger.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace DebuggerInfrastructure
+{
+    std::mutex                          StateJournal::mtx;
+    StateJournal::Image*                StateJournal::image = nullptr;
+    StateJournal::Image                 StateJournal::previous{};
+    bool                                StateJournal::previousValid = false;
+    StartupReport                       StateJournal::report;
+    std::vector<unsigned int>           StateJournal::heldLines;
+    SafetySubscriberId                  StateJournal::subscriber = 0;
+
+    namespace
+    {
+        std::vector<unsigned int> currentLines;
+
+        // Best effort, a channel that is already gone is as safe as it gets
+        bool writeFile(const std::string& path, const std::string& value)
+        {
+            int fd = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+            if (fd < 0) return false;
+            bool written = ::write(fd, value.data(), value.size()) == ssize_t(value.size());
+            close(fd);
+            return written;
+        }
+    }
+
+    void StateJournal::Initialize(const std::string& path)
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        if (image) {
+            throw std::runtime_error("StateJournal is already initialized");
+        }
+        int fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            Logger::Warning("State journal {} cannot be opened, running without one: {}", path, std::strerror(errno));
+            return;
+        }
+        struct stat st {};
+        bool sized = fstat(fd, &st) == 0 && st.st_size == off_t(sizeof(Image));
+        if (!sized && (ftruncate(fd, 0) != 0 || ftruncate(fd, sizeof(Image)) != 0)) {
+            Logger::Warning("State journal {} cannot be sized, running without one: {}", path, std::strerror(errno));
+            close(fd);
+            return;
+        }
+        void* mapped = mmap(nullptr, sizeof(Image), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mapped == MAP_FAILED) {
+            Logger::Warning("State journal {} cannot be mapped, running without one: {}", path, std::strerror(errno));
+            return;
+        }
+        image = static_cast<Image*>(mapped);
+
+        previous = *image;
+        previousValid = sized && previous.magic == magicValue && previous.layout == layoutVersion;
+        if (!previousValid) {
+            std::memset(static_cast<void*>(image), 0, sizeof(Image));
+            image->magic = magicValue;
+            image->layout = layoutVersion;
+            previous = Image{};
+        }
+        // The lines and servos of the previous run stay in the journal until MakeSafe took care of them,
+        // so a crash in between leaves them to the next start
+        heldLines.assign(previous.lines, previous.lines + std::min<uint32_t>(previous.lineCount, MaxLines));
+        writeLocked([](Image& journal) {
+            journal.pid = getpid();
+            journal.clean = 0;
+        });
+        subscriber = SafetyStateChannel::Subscribe(NAMEOF(StateJournal), &StateJournal::onSafetyState);
+    }
+
+    StartupReport StateJournal::MakeSafe(std::chrono::steady_clock::time_point processStart)
+    {
+        StartupReport result;
+        std::vector<unsigned int> orphans;
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            result.journalFound = previousValid;
+            if (previousValid) {
+                result.previousClean = previous.clean != 0;
+                result.previousTorn = (previous.sequence & 1) != 0;
+                result.previousPid = previous.pid;
+                result.previousLaserMask = previous.laserMask;
+                result.previousLocked = previous.locked != 0;
+                result.previousReasonMask = previous.reasonMask;
+            }
+            for (unsigned int line : heldLines) {
+                if (std::find(currentLines.begin(), currentLines.end(), line) == currentLines.end()) orphans.push_back(line);
+            }
+            heldLines.clear();
+        }
+
+        // Lines of the previous run the current config does not drive any more: low, and held so until Dispose
+        for (unsigned int line : orphans) {
+            try {
+                GPIOHandler::RequestLinesOutput({line}, NAMEOF(StateJournal), {0});
+                {
+                    std::lock_guard<std::mutex> lk(mtx);
+                    heldLines.push_back(line);
+                }
+                result.linesDriven++;
+            } catch (const std::exception& ex) {
+                Logger::Warning("Laser line {} of the previous run cannot be driven low: {}", line, ex.what());
+            }
+        }
+
+        // What ServoHandler's destructor would have done: stop the pulses and give the channel back
+        std::string root(previous.pwmRoot, strnlen(previous.pwmRoot, sizeof(previous.pwmRoot)));
+        for (uint32_t i = 0; i < std::min<uint32_t>(previous.servoCount, MaxServos); i++) {
+            const JournalServo& servo = previous.servos[i];
+            if (!servo.exported) continue;
+            std::string chip = root + "/pwmchip" + std::to_string(servo.chip);
+            writeFile(chip + "/pwm" + std::to_string(servo.channel) + "/enable", "0");
+            if (writeFile(chip + "/unexport", std::to_string(servo.channel))) {
+                result.servosReleased++;
+            }
+            RecordServo(root, servo.chip, servo.channel, false);
+        }
+
+        result.timeToSafeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - processStart).count();
+        result.interruptedEngagement = result.journalFound && !result.previousClean && result.previousLaserMask != 0;
+        RecordLaserLines(currentLines);
+
+        if (result.journalFound && !result.previousClean) {
+            Logger::Warning("The previous run (pid {}) did not shut down cleanly{}: lasers 0x{:x}, {}locked",
+                            result.previousPid, result.previousTorn ? " and died writing its journal" : "",
+                            result.previousLaserMask, result.previousLocked ? "" : "not ");
+        }
+        Logger::Info("Safe state {:.1f} ms after start: {} configured and {} leftover laser line(s) low, {} leftover servo channel(s) released",
+                     result.timeToSafeMs, currentLines.size(), result.linesDriven, result.servosReleased);
+
+        std::lock_guard<std::mutex> lk(mtx);
+        report = result;
+        return result;
+    }
+
+    void StateJournal::Dispose()
+    {
+        SafetyStateChannel::Unsubscribe(subscriber);
+        subscriber = 0;
+        std::vector<unsigned int> lines;
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            lines.swap(heldLines);
+        }
+        for (unsigned int line : lines) {
+            GPIOHandler::SetValue(line, 0);
+            GPIOHandler::ReleaseLine(line);
+        }
+        write([](Image& journal) {
+            // The leftovers of the run before are safe now, only this run's lines stay listed
+            journal.lineCount = uint32_t(std::min(currentLines.size(), MaxLines));
+            std::copy_n(currentLines.begin(), journal.lineCount, journal.lines);
+            journal.laserMask = 0;
+            journal.clean = 1;
+        });
+
+        std::lock_guard<std::mutex> lk(mtx);
+        if (!image) return;
+        msync(image, sizeof(Image), MS_SYNC);
+        munmap(image, sizeof(Image));
+        image = nullptr;
+        currentLines.clear();
+    }
+
+    void StateJournal::RecordLaserLines(const std::vector<unsigned int>& lines)
+    {
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            currentLines = lines;
+        }
+        write([&lines](Image& journal) {
+            // The lines of the previous run not yet made safe stay listed
+            std::vector<unsigned int> listed = lines;
+            for (unsigned int line : heldLines) {
+                if (std::find(listed.begin(), listed.end(), line) == listed.end()) listed.push_back(line);
+            }
+            journal.lineCount = uint32_t(std::min(listed.size(), MaxLines));
+            std::copy_n(listed.begin(), journal.lineCount, journal.lines);
+        });
+    }
+
+    void StateJournal::RecordLasers(uint64_t enabledMask)
+    {
+        write([enabledMask](Image& journal) { journal.laserMask = enabledMask; });
+    }
+
+    void StateJournal::RecordServo(const std::string& pwmRoot, int chip, int channel, bool exported)
+    {
+        write([&](Image& journal) {
+            size_t copied = std::min(pwmRoot.size(), sizeof(journal.pwmRoot) - 1);
+            std::memcpy(journal.pwmRoot, pwmRoot.data(), copied);
+            journal.pwmRoot[copied] = '\0';
+
+            uint32_t slot = 0;
+            while (slot < journal.servoCount && (journal.servos[slot].chip != chip || journal.servos[slot].channel != channel)) slot++;
+            if (slot == journal.servoCount) {
+                if (slot == MaxServos) {
+                    Logger::Warning("State journal is full, pwmchip{}/pwm{} is not recorded", chip, channel);
+                    return;
+                }
+                journal.servoCount++;
+            }
+            journal.servos[slot] = JournalServo{chip, channel, uint8_t(exported ? 1 : 0), {}};
+        });
+    }
+
+    StartupReport StateJournal::GetStartupReport()
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        return report;
+    }
+
+    template <typename F>
+    void StateJournal::write(F&& modify)
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        writeLocked(std::forward<F>(modify));
+    }
+
+    template <typename F>
+    void StateJournal::writeLocked(F&& modify)
+    {
+        if (!image) return;
+        // Only a crash of this process interrupts a write, so keeping the compiler from reordering is enough
+        image->sequence++;
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        modify(*image);
+        image->updatedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        image->sequence++;
+    }
+
+    void StateJournal::onSafetyState(const SafetyState&, const SafetyState& current)
+    {
+        write([&current](Image& journal) {
+            journal.locked = current.locked ? 1 : 0;
+            journal.reasonMask = current.reasonMask;
+        });
+    }
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "../SafetyStateChannel/SafetyStateChannel.h"
+
+namespace DebuggerInfrastructure
+{
+    /**
+     * @brief What the journal of the previous run said, and what the early startup did about it.
+     */
+    struct StartupReport
+    {
+        bool journalFound = false;          ///< False on the first run or after a layout change.
+        bool previousClean = true;          ///< The previous run reached Dispose.
+        bool previousTorn = false;          ///< It died in the middle of a journal write.
+        int previousPid = 0;
+        uint64_t previousLaserMask = 0;     ///< Lasers on when it stopped.
+        bool previousLocked = false;
+        uint32_t previousReasonMask = 0;
+        size_t linesDriven = 0;             ///< Laser lines of the previous run driven low that the current config does not use.
+        size_t servosReleased = 0;          ///< PWM channels it left exported, disabled and unexported.
+        double timeToSafeMs = 0.0;          ///< Process start to every laser low and every servo released.
+        bool interruptedEngagement = false; ///< It died with a laser on, the system starts vetoed.
+    };
+
+    /**
+     * @brief A few hundred bytes of memory-mapped file holding the current actuator and lock state.
+     *
+     * LaserHandler, ServoHandler and the SafetyStateChannel record into it as they change. A record is just a few
+     * stores into the shared mapping: no syscall, no flush. The page cache keeps the last state when the process
+     * dies, though not when the power is cut (the GPIO and PWM state is gone then too).
+     *
+     * At the next start MakeSafe reads what the previous run left behind before anything slow is started. It
+     * drives the laser lines low and disables and unexports the PWM channels that run held. A run that died
+     * with a laser on counts as an interrupted engagement.
+     *
+     * Without a usable journal file the process still starts. Records are then dropped, and the early path only
+     * covers the lines of the current config.
+     */
+    class StateJournal
+    {
+    public:
+        // Maps the journal and keeps a copy of what the previous run left in it
+        static void Initialize(const std::string& path);
+        /**
+         * @brief Early startup: makes the hardware of the previous run safe.
+         * Call after LaserHandler::Initialize drove the configured lines low. Measured from processStart.
+         */
+        static StartupReport MakeSafe(std::chrono::steady_clock::time_point processStart);
+        // Marks the run clean and releases the lines MakeSafe holds, call after LaserHandler::Dispose
+        static void Dispose();
+
+        static void RecordLaserLines(const std::vector<unsigned int>& lines);
+        static void RecordLasers(uint64_t enabledMask);
+        static void RecordServo(const std::string& pwmRoot, int chip, int channel, bool exported);
+
+        static StartupReport GetStartupReport();
+
+        static constexpr size_t MaxLines = 64;
+        static constexpr size_t MaxServos = 16;
+
+    private:
+        struct JournalServo
+        {
+            int32_t chip;
+            int32_t channel;
+            uint8_t exported;
+            uint8_t padding[7];
+        };
+
+        // The file layout, bump layoutVersion when it changes
+        struct Image
+        {
+            uint64_t magic;
+            uint32_t layout;
+            int32_t pid;
+            uint64_t sequence;              ///< Odd while a write is in progress
+            uint8_t clean;
+            uint8_t locked;
+            uint8_t padding[2];
+            uint32_t reasonMask;
+            uint64_t laserMask;
+            int64_t updatedNs;              ///< system_clock ns since epoch
+            uint32_t lineCount;
+            uint32_t lines[MaxLines];
+            uint32_t servoCount;
+            JournalServo servos[MaxServos];
+            char pwmRoot[128];
+        };
+
+        static constexpr uint64_t magicValue = 0x4c4e524a49424544ull;  // "DEBIJRNL"
+        static constexpr uint32_t layoutVersion = 1;
+
+        template <typename F>
+        static void write(F&& modify);
+        // write with mtx already held
+        template <typename F>
+        static void writeLocked(F&& modify);
+        static void onSafetyState(const SafetyState& previous, const SafetyState& current);
+
+        static std::mutex mtx;
+        static Image* image;                ///< nullptr without a journal
+        static Image previous;              ///< Copied at Initialize
+        static bool previousValid;
+        static StartupReport report;
+        static std::vector<unsigned int> heldLines;
+        static SafetySubscriberId subscriber;
+    };
+}
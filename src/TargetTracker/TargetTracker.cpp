@@ -0,0 +1,60 @@
+#include "TargetTracker.h"
+#include <algorithm>
+#include <tuple>
+
+namespace DebuggerInfrastructure
+{
+    std::atomic<uint64_t> TargetTracker::nextId_{1};
+
+    TargetTracker::TargetTracker(double gate, std::chrono::milliseconds maxAge)
+        : gate_(gate)
+        , maxAge_(maxAge)
+    {
+    }
+
+    void TargetTracker::Update(const std::vector<Observation>& observations, std::chrono::steady_clock::time_point now)
+    {
+        // All candidate pairs inside the gate, closest first
+        std::vector<std::tuple<double, size_t, size_t>> pairs;
+        for (size_t t = 0; t < tracks_.size(); t++) {
+            for (size_t o = 0; o < observations.size(); o++) {
+                double dx = tracks_[t].x - observations[o].x;
+                double dy = tracks_[t].y - observations[o].y;
+                double distance = dx * dx + dy * dy;
+                if (distance <= gate_ * gate_) pairs.emplace_back(distance, t, o);
+            }
+        }
+        std::sort(pairs.begin(), pairs.end());
+
+        std::vector<bool> trackMatched(tracks_.size(), false);
+        std::vector<bool> observationMatched(observations.size(), false);
+        for (const auto& [distance, t, o] : pairs) {
+            if (trackMatched[t] || observationMatched[o]) continue;
+            trackMatched[t] = observationMatched[o] = true;
+            Track& track = tracks_[t];
+            track.x = observations[o].x;
+            track.y = observations[o].y;
+            track.box = observations[o].box;
+            track.score = observations[o].score;
+            track.lastSeen = now;
+        }
+
+        for (size_t o = 0; o < observations.size(); o++) {
+            if (observationMatched[o]) continue;
+            const Observation& observation = observations[o];
+            tracks_.push_back(Track{nextId_++, observation.x, observation.y, observation.box, observation.score, now, now});
+        }
+
+        std::erase_if(tracks_, [&](const Track& track) { return now - track.lastSeen > maxAge_; });
+    }
+
+    std::vector<Track>& TargetTracker::Tracks()
+    {
+        return tracks_;
+    }
+
+    const std::vector<Track>& TargetTracker::Tracks() const
+    {
+        return tracks_;
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+namespace DebuggerInfrastructure
+{
+    enum class Verification
+    {
+        Pending,
+        Confirmed,
+        Rejected
+    };
+
+    struct Track
+    {
+        uint64_t id;
+        double x;                   ///< Normalized frame coordinates of the box center.
+        double y;
+        cv::Rect box;               ///< Pixel box in the frame the track was last seen in.
+        float score;
+        std::chrono::steady_clock::time_point firstSeen;
+        std::chrono::steady_clock::time_point lastSeen;
+        Verification verification = Verification::Pending;
+    };
+
+    struct Observation
+    {
+        double x;
+        double y;
+        cv::Rect box;
+        float score;
+    };
+
+    /**
+     * @brief Associates per-frame insect detections of one camera into tracks.
+     *
+     * Greedy nearest-center matching inside a gate, which suits the small and fast insect boxes better than IoU.
+     * Tracks that are not seen for maxAge are dropped.
+     */
+    class TargetTracker
+    {
+    public:
+        explicit TargetTracker(double gate = 0.08, std::chrono::milliseconds maxAge = std::chrono::milliseconds(500));
+
+        void Update(const std::vector<Observation>& observations, std::chrono::steady_clock::time_point now);
+
+        std::vector<Track>& Tracks();
+        const std::vector<Track>& Tracks() const;
+
+    private:
+        std::vector<Track> tracks_;
+        double gate_;
+        std::chrono::milliseconds maxAge_;
+
+        static std::atomic<uint64_t> nextId_;
+    };
+}
@@ -0,0 +1,144 @@
+#include "TargetVerifier.h"
+#include "../Logger/Logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace DebuggerInfrastructure
+{
+    VerifierSettings    TargetVerifier::settings_;
+    ncnn::Net           TargetVerifier::net_;
+    int                 TargetVerifier::inputIndex_ = -1;
+    int                 TargetVerifier::outputIndex_ = -1;
+    std::atomic<bool>   TargetVerifier::ready_{false};
+    std::mutex          TargetVerifier::statsMutex_;
+    VerifierStats       TargetVerifier::stats_ {};
+    double              TargetVerifier::totalCropMs_ = 0.0;
+
+    void TargetVerifier::Initialize(VerifierSettings settings)
+    {
+        settings_ = std::move(settings);
+        if (!settings_.enabled) {
+            Logger::Info("TargetVerifier disabled, detections are engaged without confirmation.");
+            return;
+        }
+
+        // Crops run in parallel, one extractor each
+        net_.opt.num_threads = 1;
+        if (net_.load_param(settings_.paramPath.c_str()) != 0 || net_.load_model(settings_.binPath.c_str()) != 0) {
+            throw std::runtime_error("Failed to load verifier model from " + settings_.paramPath);
+        }
+        if (net_.input_indexes().empty() || net_.output_indexes().empty()) {
+            throw std::runtime_error("Verifier model has no input or output blobs");
+        }
+        inputIndex_ = net_.input_indexes()[0];
+        outputIndex_ = net_.output_indexes()[0];
+
+        {
+            std::lock_guard<std::mutex> lock(statsMutex_);
+            stats_ = VerifierStats{};
+            stats_.enabled = true;
+            totalCropMs_ = 0.0;
+        }
+        ready_.store(true);
+        Logger::Info("TargetVerifier initialized: {}x{} input, threshold {}, at most {} crops per frame",
+                     settings_.inputSize, settings_.inputSize, settings_.threshold, settings_.maxBatch);
+    }
+
+    void TargetVerifier::Dispose()
+    {
+        if (!ready_.exchange(false)) return;
+        net_.clear();
+        VerifierStats stats = GetStats();
+        Logger::Info("TargetVerifier disposed: {} crops in {} batches, {} confirmed, {} rejected, avg {} ms per crop, max batch {} ms",
+                     stats.crops, stats.batches, stats.confirmed, stats.rejected, stats.averageCropMs, stats.maxBatchMs);
+    }
+
+    void TargetVerifier::VerifyPending(const cv::Mat& frame, std::vector<Track>& tracks)
+    {
+        std::vector<Track*> batch;
+        for (auto& track : tracks) {
+            if (track.verification != Verification::Pending) continue;
+            if (!ready_.load()) {
+                track.verification = Verification::Confirmed;
+                continue;
+            }
+            if (batch.size() < settings_.maxBatch) batch.push_back(&track);
+        }
+        if (batch.empty()) return;
+
+        // The crops overlap in time, so each one is timed on its own thread and the batch as a whole
+        auto start = std::chrono::steady_clock::now();
+        std::vector<float> scores(batch.size(), 0.f);
+        std::vector<double> cropMs(batch.size(), 0.0);
+        #pragma omp parallel for
+        for (int i = 0; i < int(batch.size()); i++) {
+            auto cropStart = std::chrono::steady_clock::now();
+            scores[i] = Classify(frame, batch[i]->box);
+            cropMs[i] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cropStart).count();
+        }
+        double batchMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        uint64_t confirmed = 0;
+        for (size_t i = 0; i < batch.size(); i++) {
+            bool insect = scores[i] >= settings_.threshold;
+            batch[i]->verification = insect ? Verification::Confirmed : Verification::Rejected;
+            confirmed += insect;
+            Logger::Verbose("Track {} {} by verifier (score {})", batch[i]->id, insect ? "confirmed" : "rejected", scores[i]);
+        }
+
+        std::lock_guard<std::mutex> lock(statsMutex_);
+        stats_.batches++;
+        stats_.crops += batch.size();
+        stats_.confirmed += confirmed;
+        stats_.rejected += batch.size() - confirmed;
+        stats_.lastBatchMs = batchMs;
+        stats_.maxBatchMs = std::max(stats_.maxBatchMs, batchMs);
+        for (double ms : cropMs) totalCropMs_ += ms;
+        stats_.averageCropMs = totalCropMs_ / double(stats_.crops);
+    }
+
+    VerifierStats TargetVerifier::GetStats()
+    {
+        std::lock_guard<std::mutex> lock(statsMutex_);
+        return stats_;
+    }
+
+    float TargetVerifier::Classify(const cv::Mat& frame, const cv::Rect& box)
+    {
+        int padX = int(box.width * settings_.cropPadding);
+        int padY = int(box.height * settings_.cropPadding);
+        cv::Rect padded(box.x - padX, box.y - padY, box.width + 2 * padX, box.height + 2 * padY);
+        cv::Rect crop = padded & cv::Rect(0, 0, frame.cols, frame.rows);
+        if (crop.empty()) return 0.f;
+
+        cv::Mat patch = frame(crop).clone();
+        ncnn::Mat in = ncnn::Mat::from_pixels_resize(patch.data, ncnn::Mat::PIXEL_BGR2RGB, patch.cols, patch.rows,
+                                                     settings_.inputSize, settings_.inputSize);
+        const float mean_vals[3] = {0.f, 0.f, 0.f};
+        const float norm_vals[3] = {1 / 255.f, 1 / 255.f, 1 / 255.f};
+        in.substract_mean_normalize(mean_vals, norm_vals);
+
+        ncnn::Extractor ex = net_.create_extractor();
+        ncnn::Mat out;
+        if (ex.input(inputIndex_, in) != 0 || ex.extract(outputIndex_, out) != 0) return 0.f;
+
+        const float* scores = out;
+        int classes = out.w;
+        if (settings_.insectClass >= classes) return 0.f;
+
+        // Models exported with a softmax head already give probabilities, raw logits get one here
+        float sum = 0.f;
+        bool probabilities = true;
+        for (int c = 0; c < classes; c++) {
+            sum += scores[c];
+            probabilities = probabilities && scores[c] >= 0.f && scores[c] <= 1.f;
+        }
+        if (probabilities && std::abs(sum - 1.f) < 1e-3f) return scores[settings_.insectClass];
+
+        float maxScore = *std::max_element(scores, scores + classes);
+        sum = 0.f;
+        for (int c = 0; c < classes; c++) sum += std::exp(scores[c] - maxScore);
+        return std::exp(scores[settings_.insectClass] - maxScore) / sum;
+    }
+}
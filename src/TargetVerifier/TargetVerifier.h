@@ -0,0 +1,66 @@
+#pragma once
+
+#include <ncnn/net.h>
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "../TargetTracker/TargetTracker.h"
+
+namespace DebuggerInfrastructure
+{
+    struct VerifierSettings
+    {
+        bool enabled = false;
+        std::string paramPath = "./res/Verifier/model.ncnn.param";
+        std::string binPath = "./res/Verifier/model.ncnn.bin";
+        int inputSize = 64;
+        int insectClass = 0;
+        float threshold = 0.6f;
+        size_t maxBatch = 8;            ///< Crops classified per frame, the rest waits for the next frame.
+        double cropPadding = 0.5;       ///< Context added around the box, relative to its size.
+    };
+
+    struct VerifierStats
+    {
+        bool enabled;
+        uint64_t batches;
+        uint64_t crops;
+        uint64_t confirmed;
+        uint64_t rejected;
+        double lastBatchMs;
+        double maxBatchMs;
+        double averageCropMs;       ///< Classification of one crop, timed on its own thread.
+    };
+
+    /**
+     * @brief Optional second stage that confirms new insect tracks with a small crop classifier before firing.
+     *
+     * Every track is classified once, when it is still pending. Pending tracks of a frame are classified together,
+     * each crop on its own extractor in parallel, and at most maxBatch per frame so the added cost is bounded.
+     * When disabled every track is confirmed immediately.
+     */
+    class TargetVerifier
+    {
+    public:
+        static void Initialize(VerifierSettings settings);
+        static void Dispose();
+
+        static void VerifyPending(const cv::Mat& frame, std::vector<Track>& tracks);
+        static VerifierStats GetStats();
+
+    private:
+        static float Classify(const cv::Mat& frame, const cv::Rect& box);
+
+        static VerifierSettings settings_;
+        static ncnn::Net net_;
+        static int inputIndex_;
+        static int outputIndex_;
+        static std::atomic<bool> ready_;
+
+        static std::mutex statsMutex_;
+        static VerifierStats stats_;
+        static double totalCropMs_;
+    };
+}
@@ -0,0 +1,161 @@
+#include "TimerScheduler.h"
+#include "../Logger/Logger.h"
+#include <stdexcept>
+
+namespace DebuggerInfrastructure
+{
+    TimerScheduler::TimerScheduler(std::string name, Mode mode)
+        : m_name(std::move(name))
+        , m_nextId(1)
+        , m_mode(mode)
+        , m_virtualNow(Clock::now().time_since_epoch().count())
+        , m_running(true)
+    {
+        if (m_mode == Mode::Threaded) {
+            m_thread = std::thread(&TimerScheduler::ThreadFunc, this);
+        }
+    }
+
+    TimerScheduler::~TimerScheduler()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_running = false;
+            m_timers.clear();
+        }
+        m_cv.notify_all();
+        if (m_thread.joinable()) m_thread.join();
+    }
+
+    TimerId TimerScheduler::ScheduleAfter(Clock::duration delay, std::function<void()> task)
+    {
+        return Add(Now() + delay, Clock::duration::zero(), std::move(task));
+    }
+
+    TimerId TimerScheduler::ScheduleEvery(Clock::duration period, std::function<void()> task)
+    {
+        if (period <= Clock::duration::zero()) {
+            throw std::runtime_error("A periodic timer needs a positive period");
+        }
+        return Add(Now() + period, period, std::move(task));
+    }
+
+    TimerId TimerScheduler::Add(Clock::time_point due, Clock::duration period, std::function<void()> task)
+    {
+        TimerId id;
+        bool earliest;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            id = m_nextId++;
+            m_timers.emplace(id, Timer{std::move(task), period});
+            earliest = m_deadlines.empty() || due < m_deadlines.top().due;
+            m_deadlines.push(Deadline{due, id});
+        }
+        // Only a new earliest deadline changes how long the thread has to sleep
+        if (earliest) m_cv.notify_one();
+        return id;
+    }
+
+    bool TimerScheduler::Cancel(TimerId id)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_timers.erase(id) > 0;
+    }
+
+    size_t TimerScheduler::Pending()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_timers.size();
+    }
+
+    TimerScheduler::Clock::time_point TimerScheduler::Now() const
+    {
+        if (m_mode == Mode::Threaded) return Clock::now();
+        return Clock::time_point(Clock::duration(m_virtualNow.load(std::memory_order_acquire)));
+    }
+
+    std::optional<TimerScheduler::Clock::time_point> TimerScheduler::NextDue()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        while (!m_deadlines.empty() && !m_timers.contains(m_deadlines.top().id)) m_deadlines.pop();
+        if (m_deadlines.empty()) return std::nullopt;
+        return m_deadlines.top().due;
+    }
+
+    void TimerScheduler::AdvanceTo(Clock::time_point until)
+    {
+        if (m_mode != Mode::Virtual) {
+            throw std::runtime_error("Only a virtual scheduler can advance its clock");
+        }
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_deadlines.empty()) {
+            Deadline next = m_deadlines.top();
+            if (!m_timers.contains(next.id)) {
+                m_deadlines.pop();
+                continue;
+            }
+            if (next.due > until) break;
+            m_deadlines.pop();
+            // The task sees its own deadline as the time
+            if (next.due > Now()) m_virtualNow.store(next.due.time_since_epoch().count(), std::memory_order_release);
+            std::function<void()> task = Take(next, Now());
+
+            lock.unlock();
+            Run(next.id, task);
+            lock.lock();
+        }
+        if (until > Now()) m_virtualNow.store(until.time_since_epoch().count(), std::memory_order_release);
+    }
+
+    std::function<void()> TimerScheduler::Take(const Deadline& next, Clock::time_point now)
+    {
+        auto it = m_timers.find(next.id);
+        if (it->second.period > Clock::duration::zero()) {
+            // From the deadline, not from now, so a periodic timer does not drift; missed periods are skipped
+            Clock::time_point due = next.due + it->second.period;
+            while (due <= now) due += it->second.period;
+            m_deadlines.push(Deadline{due, next.id});
+            return it->second.task;
+        }
+        std::function<void()> task = std::move(it->second.task);
+        m_timers.erase(it);
+        return task;
+    }
+
+    void TimerScheduler::Run(TimerId id, const std::function<void()>& task)
+    {
+        try {
+            task();
+        } catch (const std::exception& ex) {
+            Logger::Error("{} timer {} failed: {}", m_name, id, ex.what());
+        } catch (...) {
+            Logger::Error("{} timer {} failed with an unknown exception", m_name, id);
+        }
+    }
+
+    void TimerScheduler::ThreadFunc()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (m_running) {
+            if (m_deadlines.empty()) {
+                m_cv.wait(lock);
+                continue;
+            }
+            Deadline next = m_deadlines.top();
+            if (!m_timers.contains(next.id)) {
+                m_deadlines.pop();
+                continue;
+            }
+            if (next.due > Clock::now()) {
+                m_cv.wait_until(lock, next.due);
+                continue;
+            }
+            m_deadlines.pop();
+            std::function<void()> task = Take(next, Clock::now());
+
+            lock.unlock();
+            Run(next.id, task);
+            lock.lock();
+        }
+    }
+}
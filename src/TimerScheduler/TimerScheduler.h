@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace DebuggerInfrastructure
+{
+    using TimerId = uint64_t;
+
+    /**
+     * @brief Runs delayed and periodic tasks on one thread, ordered by a min-heap of deadlines.
+     *
+     * Any number of timers costs one heap entry each, not a thread. Cancel removes a timer at once: a
+     * cancelled task never starts. A task that is already running is not interrupted, so tasks that
+     * race with a cancellation must re-check their own state under their owner's lock.
+     * Tasks run one after another on the scheduler thread and should be short.
+     *
+     * A Virtual scheduler has no thread and its own clock: time stands still until AdvanceTo moves it and
+     * runs the tasks due on the way on the calling thread. Owners that read the time through Now() then
+     * replay the same timing on every run, e.g. the interlock simulation.
+     */
+    class TimerScheduler
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        enum class Mode
+        {
+            Threaded,
+            Virtual
+        };
+
+        explicit TimerScheduler(std::string name, Mode mode = Mode::Threaded);
+        // Drops the pending timers and joins the thread
+        ~TimerScheduler();
+
+        TimerScheduler(const TimerScheduler&) = delete;
+        TimerScheduler& operator=(const TimerScheduler&) = delete;
+
+        TimerId ScheduleAfter(Clock::duration delay, std::function<void()> task);
+        // First run after one period, then every period until cancelled
+        TimerId ScheduleEvery(Clock::duration period, std::function<void()> task);
+        // True if the timer was pending, false if it already ran, is running or never existed
+        bool Cancel(TimerId id);
+        size_t Pending();
+
+        // Clock::now(), or the virtual time, which starts at the Clock::now() of the construction
+        Clock::time_point Now() const;
+        // Deadline of the next pending timer
+        std::optional<Clock::time_point> NextDue();
+        // Virtual mode only: runs every task due until the given time in deadline order, then sets the clock to it
+        void AdvanceTo(Clock::time_point until);
+
+    private:
+        struct Timer
+        {
+            std::function<void()> task;
+            Clock::duration period;         ///< zero for one-shot timers
+        };
+
+        struct Deadline
+        {
+            Clock::time_point due;
+            TimerId id;
+            // Equal deadlines run in the order they were scheduled
+            bool operator>(const Deadline& other) const { return due > other.due || (due == other.due && id > other.id); }
+        };
+
+        TimerId Add(Clock::time_point due, Clock::duration period, std::function<void()> task);
+        void ThreadFunc();
+        // Caller holds m_mutex and popped the deadline of a pending timer
+        std::function<void()> Take(const Deadline& next, Clock::time_point now);
+        void Run(TimerId id, const std::function<void()>& task);
+
+        std::string m_name;
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        // Cancelled timers leave their deadline behind, it is skipped when it comes up
+        std::priority_queue<Deadline, std::vector<Deadline>, std::greater<Deadline>> m_deadlines;
+        std::unordered_map<TimerId, Timer> m_timers;
+        TimerId m_nextId;
+        Mode m_mode;
+        std::atomic<Clock::rep> m_virtualNow;
+        bool m_running;
+        std::thread m_thread;
+    };
+}
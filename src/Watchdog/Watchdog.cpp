@@ -0,0 +1,201 @@
+#include "Watchdog.h"
+#include "../DeadLocker/DeadLocker.h"
+#include "../DbHandler/DbHandler.h"
+#include "../SafetyTrace/SafetyTrace.h"
+#include "../Logger/Logger.h"
+#include <fmt/ranges.h>
+#include <stdexcept>
+
+namespace DebuggerInfrastructure
+{
+    std::mutex                                                  Watchdog::mtx;
+    WatchdogSettings                                            Watchdog::settings;
+    std::array<Watchdog::Channel, Watchdog::MaxChannels>        Watchdog::channels;
+    std::unique_ptr<TimerScheduler>                             Watchdog::scheduler;
+    std::atomic<bool>                                           Watchdog::tripped{false};
+    std::atomic<uint64_t>                                       Watchdog::trips{0};
+
+    void Watchdog::Initialize(WatchdogSettings newSettings)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (scheduler) {
+            Logger::Info("Watchdog already initialized");
+            return;
+        }
+        settings = newSettings;
+        if (!settings.enabled) {
+            Logger::Warning("Watchdog is disabled, pipeline stalls will not lock the system");
+            return;
+        }
+        if (settings.checkPeriodMs <= 0.0) {
+            throw std::runtime_error("Watchdog check period must be positive");
+        }
+        scheduler = std::make_unique<TimerScheduler>(NAMEOF(Watchdog));
+        scheduler->ScheduleEvery(std::chrono::duration_cast<TimerScheduler::Clock::duration>(
+                                     std::chrono::duration<double, std::milli>(settings.checkPeriodMs)),
+                                 [] { Watchdog::check(); });
+        Logger::Info("Watchdog checks every {} ms, deadlines capture {} ms, inference {} ms, control {} ms",
+                     settings.checkPeriodMs, settings.captureDeadlineMs, settings.inferenceDeadlineMs, settings.controlDeadlineMs);
+    }
+
+    void Watchdog::Dispose()
+    {
+        std::unique_ptr<TimerScheduler> stopping;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = std::move(scheduler);
+        }
+        // Joined outside the lock, a running check takes it. A tripped lock stays, the system is going down.
+        stopping.reset();
+    }
+
+    WatchdogChannel Watchdog::Register(const std::string& name, WatchdogStage stage)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (WatchdogChannel id = 0; id < MaxChannels; id++) {
+            Channel& channel = channels[id];
+            if (channel.used.load()) continue;
+            channel.name = name;
+            channel.stage = stage;
+            channel.misses = 0;
+            channel.stalled = false;
+            channel.lastBeatNs.store(0);
+            channel.maxGapNs.store(0);
+            channel.beats.store(0);
+            channel.used.store(true, std::memory_order_release);
+            return id;
+        }
+        throw std::runtime_error("Watchdog has no free channel for " + name);
+    }
+
+    void Watchdog::Unregister(WatchdogChannel id)
+    {
+        if (id >= MaxChannels) return;
+        std::lock_guard<std::mutex> lock(mtx);
+        channels[id].used.store(false);
+        channels[id].stalled = false;
+    }
+
+    void Watchdog::Heartbeat(WatchdogChannel id)
+    {
+        if (id >= MaxChannels) return;
+        Channel& channel = channels[id];
+        if (!channel.used.load(std::memory_order_acquire)) return;
+        int64_t now = steadyNs();
+        int64_t previous = channel.lastBeatNs.exchange(now, std::memory_order_acq_rel);
+        if (previous != 0) {
+            int64_t gap = now - previous;
+            int64_t max = channel.maxGapNs.load(std::memory_order_relaxed);
+            while (gap > max && !channel.maxGapNs.compare_exchange_weak(max, gap, std::memory_order_relaxed)) {}
+        }
+        channel.beats.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void Watchdog::check()
+    {
+        std::vector<std::string> stalls;
+        bool anyStalled = false;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            int64_t now = steadyNs();
+            for (Channel& channel : channels) {
+                if (!channel.used.load(std::memory_order_acquire)) continue;
+                int64_t last = channel.lastBeatNs.load(std::memory_order_acquire);
+                if (last == 0) continue;
+
+                double gapMs = double(now - last) / 1e6;
+                if (gapMs <= deadlineMs(channel.stage)) {
+                    channel.stalled = false;
+                    continue;
+                }
+                int64_t gap = now - last;
+                int64_t max = channel.maxGapNs.load(std::memory_order_relaxed);
+                while (gap > max && !channel.maxGapNs.compare_exchange_weak(max, gap, std::memory_order_relaxed)) {}
+                if (!channel.stalled) {
+                    channel.stalled = true;
+                    channel.misses++;
+                    stalls.push_back(fmt::format("{} ({:.0f} ms)", channel.name, gapMs));
+                }
+                anyStalled = true;
+            }
+        }
+
+        if (anyStalled && !tripped.load()) {
+            tripped.store(true);
+            trips.fetch_add(1);
+            {
+                SafetyTrace::Scope trace(LockReason::Watchdog, SafetyTrace::Clock::now());
+                DeadLocker::EmergencyInitiate(LockReason::Watchdog);
+            }
+            std::string msg = fmt::format("Pipeline stalled: {}", fmt::join(stalls, ", "));
+            Logger::Critical(msg);
+            DbHandler::InsertDataNow(EMERGENCYADDLOCKREASON, NAMEOF(Watchdog), msg);
+        } else if (!anyStalled && tripped.load()) {
+            tripped.store(false);
+            DeadLocker::Recover(LockReason::Watchdog);
+            Logger::Info("Every watched stage makes progress again, the watchdog lock is recovering");
+            DbHandler::InsertDataNow(EMERGENCYREMOVELOCKREASON, NAMEOF(Watchdog), "Pipeline heartbeats resumed.");
+        } else if (!stalls.empty()) {
+            Logger::Critical("Pipeline stalled while already locked by the watchdog: {}", fmt::join(stalls, ", "));
+        }
+    }
+
+    std::vector<WatchdogChannelStats> Watchdog::GetStats()
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        std::vector<WatchdogChannelStats> result;
+        int64_t now = steadyNs();
+        for (const Channel& channel : channels) {
+            if (!channel.used.load(std::memory_order_acquire)) continue;
+            WatchdogChannelStats stats;
+            stats.name = channel.name;
+            stats.stage = channel.stage;
+            stats.deadlineMs = deadlineMs(channel.stage);
+            stats.beats = channel.beats.load(std::memory_order_relaxed);
+            stats.misses = channel.misses;
+            int64_t last = channel.lastBeatNs.load(std::memory_order_acquire);
+            stats.lastGapMs = last == 0 ? 0.0 : double(now - last) / 1e6;
+            stats.maxGapMs = double(channel.maxGapNs.load(std::memory_order_relaxed)) / 1e6;
+            stats.minMarginMs = stats.deadlineMs - stats.maxGapMs;
+            stats.stalled = channel.stalled;
+            result.push_back(stats);
+        }
+        return result;
+    }
+
+    bool Watchdog::IsTripped()
+    {
+        return tripped.load();
+    }
+
+    uint64_t Watchdog::Trips()
+    {
+        return trips.load();
+    }
+
+    const char* Watchdog::StageName(WatchdogStage stage)
+    {
+        switch (stage) {
+            case WatchdogStage::Capture:    return "capture";
+            case WatchdogStage::Inference:  return "inference";
+            case WatchdogStage::Control:    return "control";
+            default:                        return "unknown";
+        }
+    }
+
+    double Watchdog::deadlineMs(WatchdogStage stage)
+    {
+        switch (stage) {
+            case WatchdogStage::Capture:    return settings.captureDeadlineMs;
+            case WatchdogStage::Inference:  return settings.inferenceDeadlineMs;
+            case WatchdogStage::Control:    return settings.controlDeadlineMs;
+            default:                        return settings.inferenceDeadlineMs;
+        }
+    }
+
+    int64_t Watchdog::steadyNs()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "../TimerScheduler/TimerScheduler.h"
+
+namespace DebuggerInfrastructure
+{
+    enum class WatchdogStage : uint8_t
+    {
+        Capture,        ///< One channel per camera, a frame was read
+        Inference,      ///< A frame went through the network and the decision
+        Control,        ///< One channel per turret, a motion controller tick
+        Count
+    };
+
+    struct WatchdogSettings
+    {
+        bool enabled = true;
+        double checkPeriodMs = 20.0;
+        double captureDeadlineMs = 500.0;
+        double inferenceDeadlineMs = 1000.0;
+        double controlDeadlineMs = 100.0;
+    };
+
+    struct WatchdogChannelStats
+    {
+        std::string name;
+        WatchdogStage stage;
+        double deadlineMs = 0.0;
+        uint64_t beats = 0;
+        uint64_t misses = 0;            ///< Deadlines missed, counted once per stall.
+        double lastGapMs = 0.0;         ///< Since the last heartbeat, now.
+        double maxGapMs = 0.0;          ///< Longest gap between two heartbeats, or of a stall.
+        double minMarginMs = 0.0;       ///< deadlineMs - maxGapMs, negative once missed.
+        bool stalled = false;
+    };
+
+    using WatchdogChannel = size_t;
+
+    /**
+     * @brief Fails safe when a stage of the vision or control pipeline stops making progress.
+     *
+     * Stages beat their channel each time they complete a unit of work. A channel is watched from its first
+     * heartbeat on, so model loading and camera start-up do not count as a stall. When a watched channel goes
+     * longer than its deadline without a heartbeat the system is locked with LockReason::Watchdog, and once
+     * every channel beats within its deadline again the reason is recovered through the usual unlock delay.
+     *
+     * Heartbeat is lock-free and can be called from any thread. The checks run on their own timer thread.
+     */
+    class Watchdog
+    {
+    public:
+        static void Initialize(WatchdogSettings settings);
+        static void Dispose();
+
+        static WatchdogChannel Register(const std::string& name, WatchdogStage stage);
+        static void Unregister(WatchdogChannel channel);
+        static void Heartbeat(WatchdogChannel channel);
+
+        static std::vector<WatchdogChannelStats> GetStats();
+        static bool IsTripped();
+        static uint64_t Trips();
+        static const char* StageName(WatchdogStage stage);
+
+    private:
+        static constexpr size_t MaxChannels = 32;
+
+        struct Channel
+        {
+            std::atomic<bool> used {false};
+            std::atomic<int64_t> lastBeatNs {0};    ///< 0 until the first heartbeat
+            std::atomic<int64_t> maxGapNs {0};
+            std::atomic<uint64_t> beats {0};
+            // Written by the check only
+            uint64_t misses = 0;
+            bool stalled = false;
+            std::string name;
+            WatchdogStage stage = WatchdogStage::Capture;
+        };
+
+        static void check();
+        static double deadlineMs(WatchdogStage stage);
+        static int64_t steadyNs();
+
+        static std::mutex mtx;
+        static WatchdogSettings settings;
+        static std::array<Channel, MaxChannels> channels;
+        static std::unique_ptr<TimerScheduler> scheduler;
+        static std::atomic<bool> tripped;
+        static std::atomic<uint64_t> trips;
+    };
+}
@@ -5,13 +5,22 @@
 #include "../FrontEnd/FrontEnd.h"
 #include "../GPIOHandler/GPIOHandler.h"
 #include "../ServoHandler/ServoHandler.h"
+#include "../ServoHandler/SimulatedPwmTree.h"
 #include "../Logger/Logger.h"
 #include "../DbHandler/DbHandler.h"
 #include "../REST/RESTapi.h"
 #include "../LaserHandler/LaserHandler.h"
+#include "../PulseEngine/PulseEngine.h"
+#include "../SafetyTrace/SafetyTrace.h"
+#include "../RecordQueue/RecordQueue.h"
+#include "../SafetyStateChannel/SafetyStateChannel.h"
+#include "../StateJournal/StateJournal.h"
+#include "../Watchdog/Watchdog.h"
 #include "../AimHandler/AimHandler.h"
 #include "../DeadLocker/DeadLocker.h"
 #include "../NeuralNetworkHandler/NeuralNetworkHandler.h"
+#include "../IncidentRecorder/IncidentRecorder.h"
+#include "../AutoCalibrator/AutoCalibrator.h"
 
 bool running = true;
 std::mutex mtx;
@@ -28,11 +37,19 @@ namespace DebuggerInfrastructure
 
     std::vector<std::pair<std::function<void()>, std::string>> coreDisposeArray =
     {
+        {Watchdog::Dispose, NAMEOF(Watchdog::Dispose)},
+        {AutoCalibrator::Dispose, NAMEOF(AutoCalibrator::Dispose)},
         {NeuralNetworkHandler::Dispose, NAMEOF(NeuralNetworkHandler::Dispose)},
+        {IncidentRecorder::Dispose, NAMEOF(IncidentRecorder::Dispose)},
         {DeadLocker::Dispose, NAMEOF(DeadLocker::Dispose)},
+        {SafetyStateChannel::Dispose, NAMEOF(SafetyStateChannel::Dispose)},
         {AimHandler::Dispose, NAMEOF(AimHandler::Dispose)},
+        {PulseEngine::Dispose, NAMEOF(PulseEngine::Dispose)},
+        {SimulatedPwmTree::Dispose, NAMEOF(SimulatedPwmTree::Dispose)},
         {LaserHandler::Dispose, NAMEOF(LaserHandler::Dispose)},
+        {StateJournal::Dispose, NAMEOF(StateJournal::Dispose)},
         {GPIOHandler::Dispose, NAMEOF(GPIOHandler::Dispose)},
+        {RecordQueue::Dispose, NAMEOF(RecordQueue::Dispose)},
         {DbHandler::Dispose, NAMEOF(DbHandler::Dispose)},
     };
 
@@ -58,7 +75,7 @@ namespace DebuggerInfrastructure
         std::cerr << "Signal " << signal << " received, disposing resources..." << std::endl;
         try
         {
-            DeadLocker::EmergencyInitiate(NAMEOF(main));
+            DeadLocker::EmergencyInitiate(LockReason::Main);
             DisposeCore();
         }
         catch(std::exception& ex)
@@ -76,15 +93,54 @@ namespace DebuggerInfrastructure
         conditionalVar.notify_one();
     }
 
-    void InitializeCore()
+    constexpr const char* modelParamPath = "./res/Model/model.ncnn.param";
+    constexpr const char* modelBinPath = "./res/Model/model.ncnn.bin";
+
+    void InitializeCore(std::chrono::steady_clock::time_point processStart)
     {
         Logger::Initialize("", 1, 0);
+        // Fail closed before anything slow: every laser low and the servos of a crashed run released
+        HardwareSettings hardware = ExternalConfigsHelper::getOrCreateHardwareSettings();
+        std::vector<TurretSettings> turrets = ExternalConfigsHelper::getOrCreateTurretSettings();
+        std::vector<size_t> laserLines;
+        for (const auto& turret : turrets) laserLines.push_back(turret.laserLine);
+        StateJournal::Initialize(hardware.journalPath);
+        GPIOHandler::Initialize(hardware);
+        LaserHandler::Initialize(laserLines);
+        StartupReport startup = StateJournal::MakeSafe(processStart);
+
+        NeuralNetworkHandler::Preload(modelParamPath, modelBinPath);
         DbHandler::Initialize();
-        GPIOHandler::Initialize("gpiochip0");
-        LaserHandler::Initialize(16);
-        AimHandler::Initialize();
+        RecordQueue::Initialize();
+        SafetyTrace::Initialize(ExternalConfigsHelper::getOrCreateSafetyTraceSettings());
+        SafetyStateChannel::Initialize();
+        std::string pwmRoot = hardware.pwmRoot;
+        if (hardware.simulated)
+        {
+            std::vector<PwmChannel> channels;
+            for (const auto& turret : turrets)
+            {
+                channels.push_back({turret.pwmChip, turret.xChannel});
+                channels.push_back({turret.pwmChip, turret.yChannel});
+            }
+            pwmRoot = SimulatedPwmTree::Initialize(hardware.simulationRoot, channels,
+                                                   {hardware.servoMaxVelocity, hardware.servoTimeConstantMs});
+        }
+        for (auto& turret : turrets) turret.pwmRoot = pwmRoot;
+        PulseEngine::Initialize(ExternalConfigsHelper::getOrCreatePulseSettings(), laserLines.size());
+        AimHandler::Initialize(turrets);
         DeadLocker::Initialize(22);
-        NeuralNetworkHandler::Initialize("./res/Model/model.ncnn.param", "./res/Model/model.ncnn.bin");
+        if (startup.interruptedEngagement)
+        {
+            // Died with a laser on: nothing fires again until an operator lifts the veto with POST /enable
+            DeadLocker::EmergencyInitiate(LockReason::RESTApi);
+            DbHandler::InsertDataNow(EMERGENCYADDLOCKREASON, NAMEOF(StateJournal),
+                                     fmt::format("The previous run (pid {}) died with a laser on, REST veto until /enable.", startup.previousPid));
+        }
+        Watchdog::Initialize(ExternalConfigsHelper::getOrCreateWatchdogSettings());
+        IncidentRecorder::Initialize([] { return NeuralNetworkHandler::GetLatestFrame(); });
+        NeuralNetworkHandler::Initialize(modelParamPath, modelBinPath);
+        AutoCalibrator::Initialize(NeuralNetworkHandler::GetLatestRawFrame, NeuralNetworkHandler::GetCameraCount());
         disposed = false;
     }
 
@@ -134,9 +190,10 @@ void setupSignalHandlers() {
 
 int main()
 {
+    auto processStart = std::chrono::steady_clock::now();
     setupSignalHandlers();
     try {
-        DebuggerInfrastructure::InitializeCore();
+        DebuggerInfrastructure::InitializeCore(processStart);
         auto webUi = DebuggerInfrastructure::InitializeWeb();
 
         std::unique_lock<std::mutex> lock(mtx);
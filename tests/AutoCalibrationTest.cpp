@@ -0,0 +1,141 @@
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include "AimHandler/AimHandler.h"
+#include "AutoCalibrator/AutoCalibrator.h"
+#include "ExternalConfigsHelper/ExternalConfigsHelper.h"
+#include "LaserHandler/LaserHandler.h"
+#include "Logger/Logger.h"
+#include "MotionController/MotionController.h"
+#include "ServoHandler/ServoHandler.h"
+#include "TestSupport/SimulatedStack.h"
+#include "TestSupport/TestSupport.h"
+
+using namespace DebuggerInfrastructure;
+
+namespace
+{
+    // Where the camera sees the dot at these servo angles: a slightly rotated view of the angle range
+    // the default calibration spans
+    std::pair<double, double> Project(std::pair<double, double> angles)
+    {
+        return {(angles.first - 24.0) / 36.0 + 0.02 * (angles.second - 42.0) / 36.0,
+                (angles.second - 23.0) / 38.0 - 0.03 * (angles.first - 42.0) / 36.0};
+    }
+
+    // The angle behind the pulse the servo handler wrote, the inverse of its mapping
+    double ReadAngle(const std::filesystem::path& dutyCycle)
+    {
+        std::ifstream file(dutyCycle);
+        double ns = 0.0;
+        file >> ns;
+        return (ns / 1000.0 - kMinPulseWidthUs) / (kMaxPulseWidthUs - kMinPulseWidthUs) * (kMaxAngle - kMinAngle);
+    }
+
+    // A camera watching turret 0: every frame is rendered from the duty cycles in the simulated PWM tree and
+    // shows the dot only while the laser is on
+    class SyntheticCamera
+    {
+    public:
+        explicit SyntheticCamera(const AimHandler& turret)
+        {
+            const TurretSettings& settings = turret.GetSettings();
+            std::filesystem::path chip = std::filesystem::path(settings.pwmRoot) / ("pwmchip" + std::to_string(settings.pwmChip));
+            m_x = chip / ("pwm" + std::to_string(settings.xChannel)) / "duty_cycle";
+            m_y = chip / ("pwm" + std::to_string(settings.yChannel)) / "duty_cycle";
+        }
+
+        cv::Mat Frame(size_t cameraId, uint64_t& sequence)
+        {
+            sequence = 0;
+            if (cameraId != 0) return cv::Mat();
+            sequence = ++m_sequence;
+            cv::Mat frame(height, width, CV_8UC3, cv::Scalar(40, 60, 50));
+            if (!LaserHandler::IsEnabled(0)) return frame;
+
+            auto dot = Project({ReadAngle(m_x), ReadAngle(m_y)});
+            double cx = dot.first * width, cy = dot.second * height;
+            for (int y = 0; y < height; y++) {
+                uchar* row = frame.ptr<uchar>(y);
+                for (int x = 0; x < width; x++) {
+                    if (std::hypot(x + 0.5 - cx, y + 0.5 - cy) > radius) continue;
+                    row[3 * x] = 30;
+                    row[3 * x + 1] = 40;
+                    row[3 * x + 2] = 255;
+                }
+            }
+            return frame;
+        }
+
+        static constexpr int width = 320;
+        static constexpr int height = 240;
+        static constexpr double radius = 2.5;
+
+    private:
+        std::filesystem::path m_x, m_y;
+        uint64_t m_sequence = 0;        ///< Only the calibrator thread asks for frames
+    };
+}
+
+int main()
+{
+    Logger::Initialize("", 2, 3);
+    SimulatedStackSettings settings;
+    settings.workDir = "AutoCalibration";
+    std::filesystem::remove_all(settings.workDir);
+    const std::string configPath = (settings.workDir / "config.json").string();
+    {
+        SimulatedStack stack(settings);
+        AimHandler& turret = AimHandler::Get(0);
+        SyntheticCamera camera(turret);
+        AutoCalibrator::Initialize([&camera](size_t cameraId, uint64_t& sequence) { return camera.Frame(cameraId, sequence); }, 1);
+
+        // The default grid, sweeping the range of the default calibration
+        AutoCalibrationSettings calibration;
+        Expect(AutoCalibrator::Start(calibration, configPath), "the calibration did not start");
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(60);
+        while (AutoCalibrator::GetStatus().state == AutoCalibrationState::Running && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        AutoCalibrationStatus status = AutoCalibrator::GetStatus();
+        std::cout << AutoCalibrator::StateName(status.state) << " in " << status.durationMs << " ms, " << status.pointsMeasured
+                  << " of " << status.pointsTotal << " points measured: " << status.message << "\n";
+
+        Expect(status.state == AutoCalibrationState::Succeeded, "the calibration ended {}: {}",
+               AutoCalibrator::StateName(status.state), status.message);
+        Expect(status.pointsMeasured == status.pointsTotal, "the dot was found at {} of {} grid points",
+               status.pointsMeasured, status.pointsTotal);
+        // Each point waits for one grid step of travel, the motion controller's settle and the calibrator's own.
+        // A single point running into its timeout blows the budget
+        const double travelMs = 150.0;
+        double budgetMs = double(status.pointsTotal) * (travelMs + MotionLimits{}.settleMs + calibration.settleMs);
+        Expect(status.durationMs < budgetMs, "the {} point grid took {:.0f} ms, the budget is {:.0f} ms",
+               status.pointsTotal, status.durationMs, budgetMs);
+        Expect(status.report.rmsError < 0.2 && status.report.maxError < 0.5, "fitted with RMS error {:.3f} deg, max {:.3f} deg",
+               status.report.rmsError, status.report.maxError);
+
+        // The fit has to aim where the camera sees, across the frame and not only at the grid
+        double worst = 0.0;
+        for (double y = 0.15; y <= 0.85; y += 0.1) {
+            for (double x = 0.15; x <= 0.85; x += 0.1) {
+                auto seen = Project(turret.MapPoint({x, y}));
+                worst = std::max(worst, std::max(std::abs(seen.first - x) * SyntheticCamera::width,
+                                                 std::abs(seen.second - y) * SyntheticCamera::height));
+            }
+        }
+        std::cout << "worst aim " << worst << " px off\n";
+        Expect(worst < 2.0, "the fitted calibration aims up to {:.2f} px off", worst);
+
+        CalibrationSettings saved = ExternalConfigsHelper::getCalibrationSettings(configPath, 0);
+        Expect(saved.calibrationPoints.size() == status.pointsMeasured, "{} calibration points saved, {} measured",
+               saved.calibrationPoints.size(), status.pointsMeasured);
+        Expect(!AimHandler::IsCalibrationEnabled() && !LaserHandler::IsEnabled(0), "the lasers were left on after the calibration");
+
+        AutoCalibrator::Dispose();
+    }
+
+    return TestResult();
+}
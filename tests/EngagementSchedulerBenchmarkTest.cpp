@@ -0,0 +1,163 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <unordered_set>
+#include <vector>
+#include "EngagementScheduler/EngagementScheduler.h"
+#include "Logger/Logger.h"
+#include "TestSupport/TestSupport.h"
+
+using namespace DebuggerInfrastructure;
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    struct Insect
+    {
+        uint64_t id;
+        double x, y, vx, vy;
+        Clock::time_point born, dies;
+    };
+
+    struct ReplaySettings
+    {
+        uint64_t seed = 1;
+        std::chrono::minutes length {10};
+        std::chrono::milliseconds frame {33};
+        double spawnsPerSecond = 1.5;
+        double slewPerSecond = 2.0;         ///< Normalized frame units, both axes at once
+        double onTarget = 0.01;             ///< The laser fires once the turret is this close
+        std::chrono::milliseconds dwell {400};
+    };
+
+    struct ReplayResult
+    {
+        uint64_t engaged = 0;
+        double travel = 0.0;                ///< Chebyshev, what the servos actually slewed
+        double perMinute = 0.0;
+    };
+
+    // The order before the scheduler: the newest box, held for its dwell, then retired
+    class LastBox
+    {
+    public:
+        explicit LastBox(std::chrono::milliseconds dwell) : m_dwell(dwell) {}
+
+        const Track* Next(const std::vector<Track>& tracks, bool firing, Clock::time_point now)
+        {
+            auto elapsed = m_lastTick ? now - *m_lastTick : Clock::duration::zero();
+            m_lastTick = now;
+            const Track* current = nullptr;
+            for (const auto& track : tracks) {
+                if (m_current && track.id == *m_current) current = &track;
+            }
+            if (current) {
+                if (firing) m_fired += elapsed;
+                if (m_fired < m_dwell) return current;
+                m_retired.insert(current->id);
+                engaged++;
+            }
+            m_current.reset();
+            const Track* next = nullptr;
+            for (const auto& track : tracks) {
+                if (!m_retired.contains(track.id) && (!next || track.firstSeen >= next->firstSeen)) next = &track;
+            }
+            if (next) {
+                m_current = next->id;
+                m_fired = Clock::duration::zero();
+            }
+            return next;
+        }
+
+        uint64_t engaged = 0;
+
+    private:
+        std::chrono::milliseconds m_dwell;
+        std::optional<uint64_t> m_current;
+        Clock::duration m_fired {};
+        std::optional<Clock::time_point> m_lastTick;
+        std::unordered_set<uint64_t> m_retired;
+    };
+
+    // The same seeded scene for every policy: insects appear at random, drift and leave after a few seconds
+    template <typename Policy>
+    ReplayResult Replay(const ReplaySettings& settings, Policy& policy)
+    {
+        std::mt19937_64 random(settings.seed);
+        std::uniform_real_distribution<double> position(0.05, 0.95), drift(-0.02, 0.02), lifetime(4.0, 12.0), unit(0.0, 1.0);
+        const double dt = std::chrono::duration<double>(settings.frame).count();
+
+        Clock::time_point start {};
+        Clock::time_point end = start + settings.length;
+        std::vector<Insect> insects;
+        uint64_t nextId = 1;
+        std::pair<double, double> turret {0.5, 0.5};
+        bool firing = false;
+        ReplayResult result;
+        for (Clock::time_point now = start; now < end; now += settings.frame) {
+            if (unit(random) < settings.spawnsPerSecond * dt) {
+                auto life = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(lifetime(random)));
+                insects.push_back({nextId++, position(random), position(random), drift(random), drift(random), now, now + life});
+            }
+            std::erase_if(insects, [now](const Insect& insect) { return insect.dies <= now; });
+            std::vector<Track> tracks;
+            for (auto& insect : insects) {
+                insect.x = std::clamp(insect.x + insect.vx * dt, 0.0, 1.0);
+                insect.y = std::clamp(insect.y + insect.vy * dt, 0.0, 1.0);
+                tracks.push_back(Track{insect.id, insect.x, insect.y, {}, 0.9f, insect.born, now, Verification::Confirmed});
+            }
+
+            const Track* target = policy.Next(tracks, firing, now);
+            firing = false;
+            if (!target) continue;
+            // Both servos slew at once, the longer axis decides
+            double reach = settings.slewPerSecond * dt;
+            double dx = std::clamp(target->x - turret.first, -reach, reach);
+            double dy = std::clamp(target->y - turret.second, -reach, reach);
+            turret = {turret.first + dx, turret.second + dy};
+            result.travel += std::max(std::abs(dx), std::abs(dy));
+            firing = std::max(std::abs(target->x - turret.first), std::abs(target->y - turret.second)) < settings.onTarget;
+        }
+        return result;
+    }
+}
+
+int main()
+{
+    Logger::Initialize("", 2, 3);
+    ReplaySettings settings;
+    const double minutes = double(settings.length.count());
+
+    EngagementScheduler scheduler(settings.dwell);
+    ReplayResult planned = Replay(settings, scheduler);
+    planned.engaged = scheduler.Stats(Clock::time_point{} + settings.length).engaged;
+    planned.perMinute = double(planned.engaged) / minutes;
+
+    LastBox lastBox(settings.dwell);
+    ReplayResult naive = Replay(settings, lastBox);
+    naive.engaged = lastBox.engaged;
+    naive.perMinute = double(naive.engaged) / minutes;
+
+    auto perTarget = [](const ReplayResult& result) { return result.engaged ? result.travel / double(result.engaged) : 0.0; };
+    std::cout << "scheduler: " << planned.engaged << " engaged, " << planned.perMinute << " per minute, travel "
+              << planned.travel << " (" << perTarget(planned) << " per target)\n"
+              << "last box:  " << naive.engaged << " engaged, " << naive.perMinute << " per minute, travel "
+              << naive.travel << " (" << perTarget(naive) << " per target)\n";
+
+    Expect(planned.engaged > 0 && naive.engaged > 0, "the replay engaged nothing");
+    Expect(perTarget(planned) <= perTarget(naive), "the scheduler slewed {:.3f} per target, the last box order {:.3f}",
+           perTarget(planned), perTarget(naive));
+    Expect(planned.engaged >= naive.engaged, "the scheduler engaged {} targets, the last box order {}",
+           planned.engaged, naive.engaged);
+
+    // The scene is a function of the seed alone
+    EngagementScheduler again(settings.dwell);
+    ReplayResult replay = Replay(settings, again);
+    Expect(replay.travel == planned.travel && again.Stats(Clock::time_point{} + settings.length).engaged == planned.engaged,
+           "seed {} did not replay the same", settings.seed);
+
+    return TestResult();
+}
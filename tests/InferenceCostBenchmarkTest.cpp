@@ -0,0 +1,63 @@
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include "InferencePlan/InferencePlan.h"
+#include "Logger/Logger.h"
+#include "TestSupport/TestSupport.h"
+
+using namespace DebuggerInfrastructure;
+
+int main()
+{
+    Logger::Initialize("", 2, 3);
+    // The default camera (1024x1024) with the regions of interest on a windowsill, 30 s at 30 fps
+    constexpr int fullInput = 512;      ///< What the model is exported for
+    constexpr int frames = 900;
+    const cv::Size frame(1024, 1024);
+    const cv::Rect crop(256, 300, 410, 380);
+
+    // Before: the crop letterboxed to the full input and the whole frame inferred at it on every frame
+    const uint64_t fullPixels = uint64_t(fullInput) * fullInput;
+    const double beforePixels = 2.0 * double(fullPixels);
+
+    InferencePlan plan(fullInput, InferencePlan::defaultScanInput, InferencePlan::defaultScanEvery);
+    size_t scans = 0, longestGap = 0, gap = 0;
+    bool sized = true;
+    for (int i = 0; i < frames; i++) {
+        FramePlan next = plan.Next(frame, crop);
+        // No fewer input pixels per frame pixel than the whole frame gets
+        int dense = (fullInput * std::max(crop.width, crop.height) + frame.width - 1) / frame.width;
+        sized = sized && next.cropInput % InferencePlan::stride == 0 && next.cropInput >= dense && next.cropInput <= fullInput;
+        gap++;
+        if (next.scan) {
+            Expect(next.scanInput == InferencePlan::defaultScanInput, "scanned at {}", next.scanInput);
+            scans++;
+            longestGap = std::max(longestGap, gap);
+            gap = 0;
+        }
+    }
+    double afterPixels = plan.AveragePixels();
+    std::cout << "crop " << crop.width << "x" << crop.height << " inferred at " << plan.CropInput(std::max(crop.width, crop.height), frame.width)
+              << ", " << scans << " full-frame scans in " << frames << " frames\n"
+              << "before: " << beforePixels << " net input pixels per frame\n"
+              << "after:  " << afterPixels << " net input pixels per frame (" << beforePixels / afterPixels << "x less)\n";
+
+    Expect(sized, "the crop input is not a multiple of {} between the crop's pixel density and {}", InferencePlan::stride, fullInput);
+    Expect(scans == (frames + InferencePlan::defaultScanEvery - 1) / InferencePlan::defaultScanEvery && longestGap <= InferencePlan::defaultScanEvery,
+           "{} scans, up to {} frames apart, expected one every {} frames", scans, longestGap, InferencePlan::defaultScanEvery);
+    Expect(afterPixels * 2.0 <= beforePixels, "{:.0f} net input pixels per frame, before {:.0f}", afterPixels, beforePixels);
+
+    // A camera without regions is one pass at the full input, as before
+    InferencePlan whole(fullInput, InferencePlan::defaultScanInput, InferencePlan::defaultScanEvery);
+    for (int i = 0; i < 10; i++) {
+        FramePlan next = whole.Next(frame, cv::Rect(0, 0, frame.width, frame.height));
+        Expect(next.cropInput == fullInput && !next.scan, "the whole frame was planned at {} with a scan {}", next.cropInput, next.scan);
+    }
+    Expect(whole.AveragePixels() == double(fullPixels), "{:.0f} pixels per whole frame", whole.AveragePixels());
+
+    // Tiny and oversized crops stay within the net's range
+    Expect(plan.CropInput(1, 1024) == InferencePlan::stride && plan.CropInput(4000, 1024) == fullInput,
+           "crop inputs {} and {} out of range", plan.CropInput(1, 1024), plan.CropInput(4000, 1024));
+
+    return TestResult();
+}
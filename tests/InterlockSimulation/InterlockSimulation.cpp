@@ -0,0 +1,369 @@
+#include "InterlockSimulation.h"
+#include "ExceptionExtensions/ExceptionExtensions.h"
+#include "GPIOHandler/GPIOHandler.h"
+#include "GPIOHandler/SimulatedGpioChip.h"
+#include "LaserHandler/LaserHandler.h"
+#include "Logger/Logger.h"
+#include "TestSupport/SimulatedStack.h"
+#include "TimerScheduler/TimerScheduler.h"
+#include <algorithm>
+#include <optional>
+#include <random>
+#include <thread>
+#include <utility>
+
+namespace DebuggerInfrastructure
+{
+    namespace
+    {
+        using Clock = TimerScheduler::Clock;
+        using Ms = std::chrono::duration<double, std::milli>;
+
+        /**
+         * @brief One simulation: the triggers as the outside world sees them, and the checks against DeadLocker.
+         */
+        class Simulation
+        {
+        public:
+            Simulation(const InterlockSimulationSettings& settings, SimulatedGpioChip& chip, TimerScheduler& clock,
+                       InterlockSimulationReport& report)
+                : m_settings(settings)
+                , m_chip(chip)
+                , m_clock(clock)
+                , m_report(report)
+                , m_random(settings.seed)
+                , m_unlockDelay(std::chrono::duration_cast<Clock::duration>(Ms(DeadLocker::GetUnlockDelayMs())))
+                , m_debounce(std::chrono::duration_cast<Clock::duration>(Ms(DeadLocker::GetDebounceMs())))
+                , m_wasLocked(DeadLocker::IsLocked())
+            {
+            }
+
+            void PlayRun(size_t run)
+            {
+                m_run = run;
+                for (size_t action = 0; action < m_settings.actionsPerRun; action++) {
+                    Wait(RandomGap());
+                    Act();
+                    m_report.actions++;
+                }
+                WithdrawAll();
+                // Liveness: with nothing left, the lasers unlock within the longest delay
+                Wait(2 * m_unlockDelay + m_debounce + std::chrono::milliseconds(1));
+                if (DeadLocker::IsLocked()) {
+                    Violation(fmt::format("still locked with every trigger withdrawn, reasons{}", DeadLocker::DescribeReasons()));
+                }
+            }
+
+        private:
+            enum class Action
+            {
+                Press,
+                Release,
+                Detect,
+                Clear,
+                Veto,
+                Revoke,
+                Fire,
+                LaserOff,
+                Count
+            };
+
+            Clock::duration RandomGap()
+            {
+                // Mostly races with the debounce and the unlock timers, sometimes long enough to unlock
+                std::uniform_int_distribution<int> kind(0, 9);
+                int k = kind(m_random);
+                if (k < 4) return std::chrono::microseconds(std::uniform_int_distribution<int>(0, 50000)(m_random));
+                if (k < 8) return std::chrono::milliseconds(std::uniform_int_distribution<int>(50, 4000)(m_random));
+                return std::chrono::milliseconds(std::uniform_int_distribution<int>(4000, 12000)(m_random));
+            }
+
+            void Act()
+            {
+                auto action = Action(std::uniform_int_distribution<int>(0, int(Action::Count) - 1)(m_random));
+                switch (action) {
+                    case Action::Press:     if (!m_held) Button(true); break;
+                    case Action::Release:   if (m_held) Button(false); break;
+                    case Action::Detect:    Detect(); break;
+                    case Action::Clear:     Clear(); break;
+                    case Action::Veto:      Veto(); break;
+                    case Action::Revoke:    Revoke(); break;
+                    case Action::Fire:      Fire(); break;
+                    case Action::LaserOff:  LaserOff(); break;
+                    default: break;
+                }
+                Check();
+            }
+
+            // The button with contact bounce: the edge, then up to three more within the debounce window
+            void Button(bool press)
+            {
+                int level = press ? 0 : 1;
+                Edge(level);
+                int bounces = std::uniform_int_distribution<int>(0, 3)(m_random);
+                int64_t windowUs = std::chrono::duration_cast<std::chrono::microseconds>(m_debounce).count();
+                for (int i = 0; i < bounces; i++) {
+                    Wait(std::chrono::microseconds(std::uniform_int_distribution<int64_t>(100, std::max<int64_t>(100, windowUs / 4))(m_random)));
+                    Edge(1 - level);
+                    Wait(std::chrono::microseconds(std::uniform_int_distribution<int64_t>(100, std::max<int64_t>(100, windowUs / 4))(m_random)));
+                    Edge(level);
+                }
+                // The press or release counts from its last edge, when the contacts came to rest
+                m_held = press;
+                if (press) m_heldSince = m_clock.Now();
+                else if (DeadLocker::HasReason(LockReason::EmergencyButton)) Withdrawn(LockReason::EmergencyButton, m_clock.Now());
+            }
+
+            void Edge(int level)
+            {
+                uint64_t expected = GPIOHandler::DispatchedEvents() + 1;
+                m_chip.Drive(m_settings.buttonLine, level,
+                             std::chrono::duration_cast<std::chrono::nanoseconds>(m_clock.Now().time_since_epoch()).count());
+                m_report.buttonEdges++;
+                // One edge in flight at a time keeps the order of the timeline
+                auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+                while (GPIOHandler::DispatchedEvents() < expected) {
+                    if (std::chrono::steady_clock::now() > deadline) {
+                        Violation("the GPIO event loop did not deliver a button edge within 1 s");
+                        return;
+                    }
+                    std::this_thread::yield();
+                }
+                Check();
+            }
+
+            // As NeuralNetworkHandler::Decide does it on a frame with and without a protected entity
+            void Detect()
+            {
+                m_present = true;
+                m_report.detections++;
+                if (!DeadLocker::HasReason(LockReason::NeuralNetworkHandler) || !m_needsResolving) {
+                    DeadLocker::EmergencyInitiate(LockReason::NeuralNetworkHandler);
+                    m_needsResolving = true;
+                }
+            }
+
+            void Clear()
+            {
+                m_present = false;
+                if (DeadLocker::IsLocked() && DeadLocker::HasReason(LockReason::NeuralNetworkHandler) && m_needsResolving) {
+                    DeadLocker::Recover(LockReason::NeuralNetworkHandler);
+                    m_needsResolving = false;
+                    Withdrawn(LockReason::NeuralNetworkHandler, m_clock.Now());
+                }
+            }
+
+            // As POST /disable and POST /enable do it
+            void Veto()
+            {
+                m_vetoed = true;
+                m_report.vetoes++;
+                DeadLocker::EmergencyInitiate(LockReason::RESTApi);
+            }
+
+            void Revoke()
+            {
+                // A second /enable finds the countdown already running, it withdraws nothing
+                if (std::exchange(m_vetoed, false) && DeadLocker::HasReason(LockReason::RESTApi)) {
+                    DeadLocker::Recover(LockReason::RESTApi);
+                    Withdrawn(LockReason::RESTApi, m_clock.Now());
+                }
+            }
+
+            // Whoever wants the laser on, locked or not: a stale IsLocked() read is exactly the race to catch
+            void Fire()
+            {
+                size_t turret = std::uniform_int_distribution<size_t>(0, m_settings.laserLines.size() - 1)(m_random);
+                if (LaserHandler::IsEnabled(turret)) return;
+                m_report.enableAttempts++;
+                try {
+                    LaserHandler::Enable(turret);
+                } catch (const BadRequestException&) {
+                    m_report.enablesRefused++;
+                }
+            }
+
+            void LaserOff()
+            {
+                size_t turret = std::uniform_int_distribution<size_t>(0, m_settings.laserLines.size() - 1)(m_random);
+                if (LaserHandler::IsEnabled(turret)) LaserHandler::Disable(turret);
+            }
+
+            void WithdrawAll()
+            {
+                if (m_held) Button(false);
+                Clear();
+                Revoke();
+                for (size_t turret = 0; turret < m_settings.laserLines.size(); turret++) {
+                    if (LaserHandler::IsEnabled(turret)) LaserHandler::Disable(turret);
+                }
+                Check();
+            }
+
+            void Withdrawn(LockReason reason, Clock::time_point at)
+            {
+                m_lastWithdrawn = at;
+                m_lastWithdrawnReason = reason;
+            }
+
+            // Moves the virtual clock timer by timer, checking after each
+            void Wait(Clock::duration duration)
+            {
+                Clock::time_point until = m_clock.Now() + duration;
+                while (true) {
+                    std::optional<Clock::time_point> due = m_clock.NextDue();
+                    if (!due || *due > until) break;
+                    m_clock.AdvanceTo(*due);
+                    Check();
+                }
+                m_clock.AdvanceTo(until);
+                Check();
+            }
+
+            void Check()
+            {
+                Clock::time_point now = m_clock.Now();
+                bool locked = DeadLocker::IsLocked();
+                uint32_t mask = DeadLocker::GetReasonMask();
+
+                for (size_t turret = 0; turret < m_settings.laserLines.size(); turret++) {
+                    if (GPIOHandler::GetValue(static_cast<unsigned int>(m_settings.laserLines[turret])) == 1 && (locked || mask != 0)) {
+                        Violation(fmt::format("laser {} is on while locked{}", turret, DeadLocker::DescribeReasons()));
+                    }
+                }
+                if (!locked && (m_present || m_vetoed || (m_held && now - m_heldSince > m_debounce))) {
+                    Violation(fmt::format("unlocked while {}", m_present ? "a protected entity is in view" :
+                                                               m_vetoed ? "the REST veto is active" : "the button is held"));
+                }
+                if (!locked && mask != 0) {
+                    Violation(fmt::format("unlocked with reasons{}", DeadLocker::DescribeReasons()));
+                }
+
+                if (locked != m_wasLocked) {
+                    m_wasLocked = locked;
+                    Fingerprint(now, locked, mask);
+                    if (locked) {
+                        m_report.locks++;
+                        m_lastWithdrawn.reset();
+                    } else {
+                        m_report.unlocks++;
+                        Unlocked(now);
+                    }
+                }
+            }
+
+            void Unlocked(Clock::time_point now)
+            {
+                if (!m_lastWithdrawn) {
+                    Violation("unlocked without any trigger being withdrawn");
+                    return;
+                }
+                Clock::duration latency = now - *m_lastWithdrawn;
+                if (latency < m_unlockDelay || latency > 2 * m_unlockDelay + m_debounce) {
+                    Violation(fmt::format("unlocked {:.1f} ms after {} was withdrawn", Ms(latency).count(),
+                                          DeadLocker::ReasonName(m_lastWithdrawnReason)));
+                }
+                m_latencies[size_t(m_lastWithdrawnReason)].push_back(Ms(latency).count());
+            }
+
+            void Fingerprint(Clock::time_point now, bool locked, uint32_t mask)
+            {
+                // FNV-1a over the virtual time since the start and the new state
+                uint64_t values[] = {uint64_t((now - m_start).count()), uint64_t(locked), uint64_t(mask)};
+                for (uint64_t value : values) {
+                    for (int byte = 0; byte < 8; byte++) {
+                        m_report.fingerprint ^= (value >> (byte * 8)) & 0xff;
+                        m_report.fingerprint *= 1099511628211ull;
+                    }
+                }
+            }
+
+            void Violation(const std::string& what)
+            {
+                m_report.violations++;
+                if (m_report.firstViolations.size() < InterlockSimulation::maxReportedViolations) {
+                    m_report.firstViolations.push_back(fmt::format("run {} at {:.3f} s: {}", m_run,
+                        std::chrono::duration<double>(m_clock.Now() - m_start).count(), what));
+                }
+            }
+
+        public:
+            void Finish()
+            {
+                m_report.virtualHours = std::chrono::duration<double, std::ratio<3600>>(m_clock.Now() - m_start).count();
+                for (size_t reason = 0; reason < m_latencies.size(); reason++) {
+                    std::vector<double>& samples = m_latencies[reason];
+                    if (samples.empty()) continue;
+                    std::sort(samples.begin(), samples.end());
+                    auto at = [&](double fraction) { return samples[std::min(samples.size() - 1, size_t(fraction * double(samples.size())))]; };
+                    m_report.unlockLatency[reason] = LatencyDistribution{samples.size(), samples.front(), at(0.5), at(0.99), samples.back()};
+                }
+            }
+
+        private:
+            const InterlockSimulationSettings& m_settings;
+            SimulatedGpioChip& m_chip;
+            TimerScheduler& m_clock;
+            InterlockSimulationReport& m_report;
+            std::mt19937 m_random;
+            const Clock::duration m_unlockDelay;
+            const Clock::duration m_debounce;
+            const Clock::time_point m_start = m_clock.Now();
+
+            size_t m_run = 0;
+            bool m_held = false;
+            Clock::time_point m_heldSince;
+            bool m_present = false;
+            bool m_needsResolving = false;
+            bool m_vetoed = false;
+            bool m_wasLocked;
+            std::optional<Clock::time_point> m_lastWithdrawn;
+            LockReason m_lastWithdrawnReason = LockReason::Main;
+            std::array<std::vector<double>, size_t(LockReason::Count)> m_latencies;
+        };
+    }
+
+    InterlockSimulationReport InterlockSimulation::Run(const InterlockSimulationSettings& settings)
+    {
+        if (settings.laserLines.empty()) {
+            throw std::runtime_error("The interlock simulation needs at least one laser");
+        }
+        auto timers = std::make_unique<TimerScheduler>(NAMEOF(InterlockSimulation), TimerScheduler::Mode::Virtual);
+        TimerScheduler& clock = *timers;
+        SimulatedStack stack({settings.workDir, settings.buttonLine, settings.laserLines}, std::move(timers));
+
+        InterlockSimulationReport report;
+        report.seed = settings.seed;
+        Simulation simulation(settings, stack.Chip(), clock, report);
+        for (size_t run = 0; run < settings.runs; run++) {
+            simulation.PlayRun(run);
+            report.runs++;
+        }
+        simulation.Finish();
+        return report;
+    }
+
+    std::string InterlockSimulation::Describe(const InterlockSimulationReport& report)
+    {
+        std::string text = fmt::format(
+            "Interlock simulation, seed {}: {} runs, {} actions, {:.1f} virtual hours\n"
+            "  {} button edges, {} detections, {} vetoes, {} laser requests ({} refused), {} locks, {} unlocks\n"
+            "  fingerprint {:016x}\n"
+            "  unlock latency after the last trigger was withdrawn:\n",
+            report.seed, report.runs, report.actions, report.virtualHours,
+            report.buttonEdges, report.detections, report.vetoes, report.enableAttempts, report.enablesRefused,
+            report.locks, report.unlocks, report.fingerprint);
+        for (size_t reason = 0; reason < report.unlockLatency.size(); reason++) {
+            const LatencyDistribution& latency = report.unlockLatency[reason];
+            if (latency.count == 0) continue;
+            text += fmt::format("    {:<22} n={:<6} min {:.1f} ms  p50 {:.1f} ms  p99 {:.1f} ms  max {:.1f} ms\n",
+                                DeadLocker::ReasonName(LockReason(reason)), latency.count,
+                                latency.minMs, latency.p50Ms, latency.p99Ms, latency.maxMs);
+        }
+        text += fmt::format("  {} violation(s)\n", report.violations);
+        for (const std::string& violation : report.firstViolations) {
+            text += "    " + violation + "\n";
+        }
+        return text;
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "DeadLocker/DeadLocker.h"
+
+namespace DebuggerInfrastructure
+{
+    struct InterlockSimulationSettings
+    {
+        size_t runs = 1000;
+        size_t actionsPerRun = 40;
+        uint32_t seed = 1;
+        unsigned int buttonLine = 22;
+        std::vector<size_t> laserLines = {16, 17};
+        std::filesystem::path workDir = "InterlockSimulation";   ///< Database, config and PWM tree of the run
+    };
+
+    struct LatencyDistribution
+    {
+        uint64_t count = 0;
+        double minMs = 0.0;
+        double p50Ms = 0.0;
+        double p99Ms = 0.0;
+        double maxMs = 0.0;
+    };
+
+    struct InterlockSimulationReport
+    {
+        uint32_t seed = 0;
+        uint64_t runs = 0;
+        uint64_t actions = 0;
+        uint64_t buttonEdges = 0;           ///< Bounces included
+        uint64_t detections = 0;
+        uint64_t vetoes = 0;
+        uint64_t enableAttempts = 0;
+        uint64_t enablesRefused = 0;
+        uint64_t locks = 0;
+        uint64_t unlocks = 0;
+        double virtualHours = 0.0;
+        uint64_t fingerprint = 0;           ///< Of every lock transition, equal for equal seeds
+        // Last trigger withdrawn to the lasers unlocked, by the reason of that trigger
+        std::array<LatencyDistribution, size_t(LockReason::Count)> unlockLatency;
+        uint64_t violations = 0;
+        std::vector<std::string> firstViolations;   ///< At most maxReportedViolations
+    };
+
+    /**
+     * @brief Plays randomized interleavings of button presses, detections, REST vetoes and laser requests
+     *        against the real DeadLocker, LaserHandler and AimHandler on simulated hardware and a virtual clock.
+     *
+     * DeadLocker runs on a virtual TimerScheduler and the button edges carry virtual timestamps, so hours of
+     * unlock delays pass in milliseconds and a seed replays the same timeline. Button edges still go through the
+     * simulated chip and the GPIO event loop, one at a time. After every action and every timer the run checks:
+     *  - no laser line is high while the system is locked or any reason is active
+     *  - the system is locked while a trigger is present (a held button after the debounce window)
+     *  - an unlock comes no sooner than the unlock delay after the last trigger was withdrawn, and no later than
+     *    the button's two delays plus the debounce
+     *  - with every trigger withdrawn the system unlocks
+     *
+     * The hardware subsystems must not be initialized, the simulation initializes and disposes them itself.
+     */
+    class InterlockSimulation
+    {
+    public:
+        static InterlockSimulationReport Run(const InterlockSimulationSettings& settings);
+        static std::string Describe(const InterlockSimulationReport& report);
+
+        static constexpr size_t maxReportedViolations = 20;
+    };
+}
@@ -0,0 +1,32 @@
+#include <iostream>
+#include "InterlockSimulation/InterlockSimulation.h"
+#include "Logger/Logger.h"
+#include "TestSupport/TestSupport.h"
+
+using namespace DebuggerInfrastructure;
+
+int main()
+{
+    Logger::Initialize("", 2, 3);
+
+    // About 30 virtual hours, under a second of wall time
+    InterlockSimulationSettings settings;
+    settings.runs = 1000;
+    settings.seed = 1;
+
+    InterlockSimulationReport report = InterlockSimulation::Run(settings);
+    std::cout << InterlockSimulation::Describe(report);
+    Expect(report.violations == 0, "{} interlock violation(s)", report.violations);
+    Expect(report.runs == settings.runs, "{} of {} runs played", report.runs, settings.runs);
+    Expect(report.locks > 0 && report.unlocks > 0, "the runs never locked and unlocked");
+    Expect(report.enablesRefused > 0, "no laser request was ever refused");
+
+    // The virtual clock makes the timeline a function of the seed alone
+    InterlockSimulationReport replay = InterlockSimulation::Run(settings);
+    Expect(replay.fingerprint == report.fingerprint, "seed {} replayed as {:016x}, first run {:016x}",
+           settings.seed, replay.fingerprint, report.fingerprint);
+    Expect(replay.locks == report.locks && replay.unlocks == report.unlocks,
+           "the replay locked {}/{} times, the first run {}/{}", replay.locks, replay.unlocks, report.locks, report.unlocks);
+
+    return TestResult();
+}
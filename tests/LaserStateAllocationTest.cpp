@@ -0,0 +1,94 @@
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include "AimHandler/AimHandler.h"
+#include "DeadLocker/DeadLocker.h"
+#include "GPIOHandler/GPIOHandler.h"
+#include "LaserHandler/LaserHandler.h"
+#include "Logger/Logger.h"
+#include "TestSupport/SimulatedStack.h"
+#include "TestSupport/TestSupport.h"
+
+using namespace DebuggerInfrastructure;
+
+// Every heap allocation of the process, whichever thread makes it
+static std::atomic<size_t> allocations{0};
+
+void* operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+int main()
+{
+    Logger::Initialize("", 2, 3);
+    SimulatedStackSettings settings;
+    settings.workDir = "LaserStateAllocation";
+    SimulatedStack stack(settings);
+
+    LaserHandler::Enable(0);
+    Expect(LaserHandler::IsEnabled(0) && !LaserHandler::IsEnabled(1), "laser 0 alone should be on after Enable");
+
+    // What the vision loop asks about every turret on every frame
+    constexpr int frames = 100000;
+    size_t engaged = 0;
+    size_t before = allocations.load();
+    for (int frame = 0; frame < frames; frame++) {
+        for (size_t turret = 0; turret < settings.laserLines.size(); turret++) {
+            AimHandler& aim = AimHandler::Get(turret);
+            engaged += aim.IsLaserEnabled() + aim.IsEngaged() + (LaserHandler::GetState(turret) == LaserState::Enabled);
+        }
+        engaged += DeadLocker::IsLocked() + (LaserHandler::GetEnabledMask() != 0);
+    }
+    size_t made = allocations.load() - before;
+    std::cout << frames << " frames of laser checks, " << made << " allocation(s), " << engaged << " hits\n";
+    Expect(made == 0, "the per-frame laser checks made {} heap allocation(s)", made);
+    Expect(engaged == size_t(frames) * 4, "{} hits, expected {}", engaged, size_t(frames) * 4);
+
+    // A failed write leaves the line high, the laser has to stay reported as on
+    GPIOHandler::ReleaseLine(settings.laserLines[0]);
+    bool threw = false;
+    try {
+        LaserHandler::Disable(0);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    Expect(threw, "Disable should fail with the laser line released");
+    Expect(LaserHandler::IsEnabled(0), "laser 0 reported off although its line was never written low");
+    Expect(!LaserHandler::SetOutput(0, false), "SetOutput should fail with the laser line released");
+    Expect(LaserHandler::IsEnabled(0), "laser 0 reported off after a failed SetOutput");
+    LaserHandler::EmergencyDisableAndLock();
+    Expect(LaserHandler::GetEnabledMask() == 1, "lasers 0x{:x} reported on after a failed emergency cut, expected 0x1",
+           LaserHandler::GetEnabledMask());
+
+    return TestResult();
+}
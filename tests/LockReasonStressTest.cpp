@@ -0,0 +1,92 @@
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "DeadLocker/DeadLocker.h"
+#include "LaserHandler/LaserHandler.h"
+#include "SafetyStateChannel/SafetyStateChannel.h"
+#include "Logger/Logger.h"
+#include "TestSupport/SimulatedStack.h"
+#include "TestSupport/TestSupport.h"
+
+using namespace DebuggerInfrastructure;
+
+int main()
+{
+    Logger::Initialize("", 2, 3);
+    SimulatedStackSettings settings;
+    settings.workDir = "LockReasonStress";
+    std::filesystem::remove_all(settings.workDir);
+
+    // One thread per reason raises and recovers it, as its owner would. The unlock delays run on a virtual clock
+    // that another thread keeps advancing, so unlocks race the next emergency. Run with ENABLE_TSAN: a plain data
+    // race around the reason bitmask fails the test there
+    constexpr int cycles = 2000;
+    const std::vector<LockReason> owned = {LockReason::NeuralNetworkHandler, LockReason::RESTApi, LockReason::Watchdog};
+    auto scheduler = std::make_unique<TimerScheduler>("LockReasonStress", TimerScheduler::Mode::Virtual);
+    TimerScheduler& clock = *scheduler;
+
+    const auto step = std::chrono::duration_cast<TimerScheduler::Clock::duration>(
+        std::chrono::duration<double, std::milli>(DeadLocker::GetUnlockDelayMs() / 2));
+    std::atomic<int> owners{int(owned.size())};
+    std::atomic<uint64_t> broken{0}, reads{0}, advances{0};
+    {
+        SimulatedStack stack(settings, std::move(scheduler));
+        std::vector<std::thread> threads;
+        for (LockReason reason : owned) {
+            threads.emplace_back([&, reason] {
+                for (int i = 0; i < cycles; i++) {
+                    DeadLocker::EmergencyInitiate(reason);
+                    // Nobody else clears this reason and a held reason keeps everything locked
+                    if (!DeadLocker::HasReason(reason) || !DeadLocker::IsLocked() || !LaserHandler::IsLocked() ||
+                        !(DeadLocker::GetReasonMask() & (1u << unsigned(reason)))) {
+                        broken++;
+                    }
+                    DeadLocker::Recover(reason);
+                    // Until its unlock ran, so the next emergency may find the system unlocked
+                    while (DeadLocker::HasReason(reason)) std::this_thread::yield();
+                }
+                owners--;
+            });
+        }
+        threads.emplace_back([&] {
+            while (owners.load() > 0) {
+                clock.AdvanceTo(clock.Now() + step);
+                advances++;
+                std::this_thread::yield();
+            }
+        });
+        for (int r = 0; r < 2; r++) {
+            threads.emplace_back([&] {
+                uint64_t count = 0;
+                while (owners.load() > 0) {
+                    uint32_t mask = DeadLocker::GetReasonMask();
+                    std::vector<ActiveLockReason> reasons = DeadLocker::GetReasons();
+                    DeadLocker::DescribeReasons();
+                    for (const ActiveLockReason& active : reasons) {
+                        if (active.reason >= LockReason::Count) broken++;
+                    }
+                    if (mask >> unsigned(LockReason::Count)) broken++;
+                    count++;
+                }
+                reads += count;
+            });
+        }
+        for (auto& thread : threads) thread.join();
+
+        // Every owner recovered last, once the delays pass nothing holds the lock
+        clock.AdvanceTo(clock.Now() + std::chrono::hours(1));
+        Expect(DeadLocker::GetReasonMask() == 0, "reasons 0x{:x} left after every owner recovered", DeadLocker::GetReasonMask());
+        Expect(!DeadLocker::IsLocked() && !LaserHandler::IsLocked(), "still locked after every reason recovered");
+    }
+    SafetyState published = SafetyStateChannel::Current();
+    Expect(published.locks > 1 && published.locks == published.unlocks, "{} locks and {} unlocks published",
+           published.locks, published.unlocks);
+    std::cout << owned.size() * cycles << " emergencies, " << published.locks << " locks, " << advances.load() << " clock advances, "
+              << reads.load() << " reason reads, " << broken.load() << " broken\n";
+    Expect(broken == 0, "{} read(s) broke the reason invariants", broken.load());
+
+    return TestResult();
+}
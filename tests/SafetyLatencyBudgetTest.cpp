@@ -0,0 +1,93 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <thread>
+#include "DbHandler/DbHandler.h"
+#include "DeadLocker/DeadLocker.h"
+#include "GPIOHandler/GPIOHandler.h"
+#include "Logger/Logger.h"
+#include "RecordQueue/RecordQueue.h"
+#include "SafetyTrace/SafetyTrace.h"
+#include "TestSupport/SimulatedStack.h"
+#include "TestSupport/TestSupport.h"
+
+using namespace DebuggerInfrastructure;
+
+namespace
+{
+    // The edge goes through the simulated chip and the GPIO event loop like a real one
+    bool Edge(SimulatedGpioChip& chip, unsigned int line, int level)
+    {
+        uint64_t expected = GPIOHandler::DispatchedEvents() + 1;
+        chip.Drive(line, level);
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+        while (GPIOHandler::DispatchedEvents() < expected) {
+            if (std::chrono::steady_clock::now() > deadline) return false;
+            std::this_thread::yield();
+        }
+        return true;
+    }
+}
+
+int main()
+{
+    Logger::Initialize("", 2, 3);
+    SimulatedStackSettings settings;
+    settings.workDir = "SafetyLatencyBudget";
+    std::filesystem::remove_all(settings.workDir);
+    SafetyTraceSettings budgets;
+    SafetyTrace::Initialize(budgets);
+
+    constexpr size_t presses = 100;
+    // The edges carry real timestamps, the latency is measured against them. The virtual clock only skips the
+    // unlock delay between the presses
+    auto scheduler = std::make_unique<TimerScheduler>("SafetyLatencyBudget", TimerScheduler::Mode::Virtual);
+    TimerScheduler& clock = *scheduler;
+    const auto debounce = std::chrono::duration<double, std::milli>(DeadLocker::GetDebounceMs() * 1.5);
+    size_t handled = 0;
+    RecordQueueStats queued;
+    {
+        SimulatedStack stack(settings, std::move(scheduler));
+        for (size_t press = 0; press < presses; press++) {
+            bool delivered = Edge(stack.Chip(), settings.buttonLine, 0);
+            handled += delivered && DeadLocker::IsLocked();
+            std::this_thread::sleep_for(debounce);
+            delivered = Edge(stack.Chip(), settings.buttonLine, 1);
+            std::this_thread::sleep_for(debounce);
+            clock.AdvanceTo(clock.Now() + std::chrono::hours(1));
+            Expect(delivered && !DeadLocker::IsLocked(), "press {} did not unlock after its release", press);
+        }
+        queued = RecordQueue::GetStats();
+    }
+    Expect(handled == presses, "{} of {} presses locked the system", handled, presses);
+    Expect(queued.ranInline == 0 && queued.posted >= 3 * presses,
+           "{} records posted, {} of them written on the posting thread", queued.posted, queued.ranInline);
+
+    for (const SafetyTraceStats& stats : SafetyTrace::GetStats()) {
+        if (stats.reason != LockReason::EmergencyButton) continue;
+        const HopLatency& cut = stats.hops[size_t(TraceHop::LaserCut)];
+        std::cout << stats.traces << " button traces, laser cut p50 " << cut.p50Us << " us, p99 " << cut.p99Us
+                  << " us, max " << cut.maxUs << " us, budget " << stats.budgetMs * 1000.0 << " us\n";
+        Expect(stats.traces == presses, "{} button traces for {} presses", stats.traces, presses);
+        Expect(cut.p99Us <= budgets.directBudgetMs * 1000.0, "laser cut p99 {} us over the {} ms budget",
+               cut.p99Us, budgets.directBudgetMs);
+    }
+
+    // Everything the event loop posted reached the database before it closed
+    DbHandler::Initialize(settings.workDir / "events.db");
+    std::vector<RecordData> records = DbHandler::ReadData();
+    size_t pressRecords = std::count_if(records.begin(), records.end(), [](const RecordData& r) {
+        return r.event == EMERGENCYADDLOCKREASON && r.className == "DeadLocker";
+    });
+    size_t releaseRecords = std::count_if(records.begin(), records.end(), [](const RecordData& r) {
+        return r.event == EMERGENCYREMOVELOCKREASON && r.className == "DeadLocker";
+    });
+    size_t traces = DbHandler::ReadSafetyTraces(presses * 2).size();
+    DbHandler::Dispose();
+    Expect(pressRecords == presses && releaseRecords == presses, "{} press and {} release records for {} presses",
+           pressRecords, releaseRecords, presses);
+    Expect(traces == presses, "{} traces in the database for {} presses", traces, presses);
+
+    return TestResult();
+}
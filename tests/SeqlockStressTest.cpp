@@ -0,0 +1,84 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "AimHandler/AimHandler.h"
+#include "Seqlock/Seqlock.h"
+#include "TestSupport/TestSupport.h"
+
+using namespace DebuggerInfrastructure;
+
+namespace
+{
+    // Every field follows from the one counter, so a torn snapshot breaks the relation
+    TurretState StateOf(int64_t n)
+    {
+        TurretState state;
+        state.locked = n % 2 != 0;
+        state.defaultX = double(n);
+        state.defaultY = -double(n);
+        state.lastShoot = std::chrono::system_clock::time_point(std::chrono::nanoseconds(n));
+        return state;
+    }
+
+    bool Consistent(const TurretState& state)
+    {
+        int64_t n = int64_t(state.defaultX);
+        return state.defaultY == -state.defaultX && state.locked == (n % 2 != 0) &&
+               state.lastShoot == std::chrono::system_clock::time_point(std::chrono::nanoseconds(n));
+    }
+}
+
+int main()
+{
+    // Writers bump the counter through Update as AimHandler does, readers Load without a lock.
+    // Run with ENABLE_TSAN: a plain data race in the seqlock fails the test there
+    constexpr int writers = 2;
+    constexpr int readers = 4;
+    constexpr int64_t updatesPerWriter = 100000;
+
+    Seqlock<TurretState> state(StateOf(0));
+    std::atomic<int> writing{writers};
+    std::atomic<uint64_t> loads{0}, torn{0}, backwards{0};
+
+    std::vector<std::thread> threads;
+    for (int w = 0; w < writers; w++) {
+        threads.emplace_back([&] {
+            for (int64_t i = 0; i < updatesPerWriter; i++) {
+                state.Update([](TurretState& s) { s = StateOf(int64_t(s.defaultX) + 1); });
+            }
+            writing--;
+        });
+    }
+    for (int r = 0; r < readers; r++) {
+        threads.emplace_back([&] {
+            int64_t last = 0;
+            uint64_t count = 0;
+            do {
+                TurretState snapshot = state.Load();
+                count++;
+                if (!Consistent(snapshot)) torn++;
+                int64_t n = int64_t(snapshot.defaultX);
+                if (n < last) backwards++;
+                last = n;
+            } while (writing.load() > 0);
+            loads += count;
+        });
+    }
+    for (auto& thread : threads) thread.join();
+
+    TurretState final = state.Load();
+    std::cout << loads.load() << " loads against " << writers * updatesPerWriter << " updates, "
+              << torn.load() << " torn, " << backwards.load() << " went back\n";
+    Expect(torn == 0, "{} torn snapshot(s)", torn.load());
+    Expect(backwards == 0, "{} snapshot(s) older than one loaded before", backwards.load());
+    Expect(int64_t(final.defaultX) == writers * updatesPerWriter && Consistent(final),
+           "the last snapshot holds {}, expected {}", final.defaultX, writers * updatesPerWriter);
+
+    // Plain Store, what SafetyStateChannel::Publish does
+    state.Store(StateOf(7));
+    Expect(Consistent(state.Load()) && state.Load().defaultX == 7.0, "Store was not read back");
+
+    return TestResult();
+}
@@ -0,0 +1,91 @@
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "Logger/Logger.h"
+#include "ServoHandler/ServoHandler.h"
+#include "ServoHandler/SimulatedPwmTree.h"
+#include "TestSupport/TestSupport.h"
+
+using namespace DebuggerInfrastructure;
+
+namespace
+{
+    std::string ReadFile(const std::filesystem::path& path)
+    {
+        std::ifstream file(path);
+        std::string value;
+        std::getline(file, value);
+        return value;
+    }
+
+    void WriteFile(const std::filesystem::path& path, const std::string& value)
+    {
+        std::ofstream file(path, std::ios::trunc);
+        file << value << '\n';
+    }
+
+    double PulseNs(double angle)
+    {
+        return (kMinPulseWidthUs + angle / (kMaxAngle - kMinAngle) * (kMaxPulseWidthUs - kMinPulseWidthUs)) * 1000.0;
+    }
+}
+
+int main()
+{
+    Logger::Initialize("", 2, 3);
+    std::filesystem::path workDir = "ServoWriteBenchmark";
+    std::filesystem::remove_all(workDir);
+    std::string root = SimulatedPwmTree::Initialize((workDir / "pwm").string(), {{0, 0}}, {});
+    std::filesystem::path duty = std::filesystem::path(root) / "pwmchip0" / "pwm0" / "duty_cycle";
+
+    // 0.1 degree apart, about 1 us of pulse: every command is a new duty cycle
+    constexpr int commands = 20000;
+    auto angleOf = [](int i) { return double(i % 1800) / 10.0; };
+
+    double persistentUs;
+    {
+        ServoHandler servo(0, 0, 50.0, root);
+        ServoWriteStats before = servo.GetStats();
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < commands; i++) servo.SetAngle(angleOf(i + 1));
+        persistentUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / commands;
+        ServoWriteStats stats = servo.GetStats();
+        Expect(stats.writes - before.writes == uint64_t(commands), "{} of {} distinct commands written",
+               stats.writes - before.writes, commands);
+
+        // A command on the current duty cycle, or within its resolution, is not written. Changing the file behind
+        // the handler's back shows whether it was
+        double angle = angleOf(commands);
+        WriteFile(duty, "123");
+        servo.SetAngle(angle);
+        servo.SetAngle(angle + 0.01);
+        ServoWriteStats after = servo.GetStats();
+        Expect(ReadFile(duty) == "123", "a repeated angle was written, duty_cycle holds {}", ReadFile(duty));
+        Expect(after.writes == stats.writes && after.skipped == stats.skipped + 2,
+               "{} writes and {} skips after two repeated angles, expected {} and {}",
+               after.writes, after.skipped, stats.writes, stats.skipped + 2);
+
+        // The emergency write goes out whatever the handler thinks is on the line
+        servo.EmergencyDisableAndLock();
+        Expect(ReadFile(duty) == std::to_string(long(kMinPulseWidthUs * 1000.0)),
+               "the emergency write left duty_cycle at {}", ReadFile(duty));
+        std::cout << "persistent fd: " << persistentUs << " us per command, " << after.averageWriteUs
+                  << " us per write, max " << after.maxWriteUs << " us\n";
+    }
+
+    // What every command cost before: format with std::to_string and open, write and close the file
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < commands; i++) {
+        std::ofstream file(duty);
+        file << std::to_string(long(PulseNs(angleOf(i + 1))));
+    }
+    double reopenUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / commands;
+    std::cout << "open per write: " << reopenUs << " us per command\n";
+    Expect(persistentUs <= reopenUs, "the persistent fd took {:.3f} us per command, opening the file each time {:.3f} us",
+           persistentUs, reopenUs);
+
+    SimulatedPwmTree::Dispose();
+    return TestResult();
+}
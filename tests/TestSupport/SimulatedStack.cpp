@@ -0,0 +1,76 @@
+#include "SimulatedStack.h"
+#include "AimHandler/AimHandler.h"
+#include "DbHandler/DbHandler.h"
+#include "DeadLocker/DeadLocker.h"
+#include "GPIOHandler/GPIOHandler.h"
+#include "LaserHandler/LaserHandler.h"
+#include "Logger/Logger.h"
+#include "RecordQueue/RecordQueue.h"
+#include "ServoHandler/SimulatedPwmTree.h"
+
+namespace DebuggerInfrastructure
+{
+    SimulatedStack::SimulatedStack(const SimulatedStackSettings& settings, std::unique_ptr<TimerScheduler> timers)
+    {
+        try {
+            std::filesystem::create_directories(settings.workDir);
+            DbHandler::Initialize(settings.workDir / "events.db");
+            m_dispose.push_back(DbHandler::Dispose);
+            RecordQueue::Initialize();
+            m_dispose.push_back(RecordQueue::Dispose);
+
+            // The button idles high, pulled up like the real one
+            auto chip = std::make_unique<SimulatedGpioChip>(std::vector<unsigned int>{settings.buttonLine});
+            m_chip = chip.get();
+            GPIOHandler::Initialize(std::move(chip));
+            m_dispose.push_back(GPIOHandler::Dispose);
+
+            std::vector<PwmChannel> channels;
+            std::vector<TurretSettings> turrets;
+            for (size_t id = 0; id < settings.laserLines.size(); id++) {
+                TurretSettings turret;
+                turret.xChannel = int(2 * id);
+                turret.yChannel = int(2 * id + 1);
+                turret.laserLine = settings.laserLines[id];
+                channels.push_back({turret.pwmChip, turret.xChannel});
+                channels.push_back({turret.pwmChip, turret.yChannel});
+                turrets.push_back(turret);
+            }
+            LaserHandler::Initialize(settings.laserLines);
+            m_dispose.push_back(LaserHandler::Dispose);
+            std::string pwmRoot = SimulatedPwmTree::Initialize((settings.workDir / "pwm").string(), channels, {});
+            m_dispose.push_back(SimulatedPwmTree::Dispose);
+            for (auto& turret : turrets) turret.pwmRoot = pwmRoot;
+            AimHandler::Initialize(turrets, (settings.workDir / "config.json").string());
+            m_dispose.push_back(AimHandler::Dispose);
+
+            DeadLocker::Initialize(int(settings.buttonLine), std::move(timers));
+            m_dispose.push_back(DeadLocker::Dispose);
+        } catch (...) {
+            dispose();
+            throw;
+        }
+    }
+
+    SimulatedStack::~SimulatedStack()
+    {
+        dispose();
+    }
+
+    SimulatedGpioChip& SimulatedStack::Chip()
+    {
+        return *m_chip;
+    }
+
+    void SimulatedStack::dispose()
+    {
+        while (!m_dispose.empty()) {
+            try {
+                m_dispose.back()();
+            } catch (const std::exception& ex) {
+                Logger::Error("Could not dispose the simulated stack: {}", ex.what());
+            }
+            m_dispose.pop_back();
+        }
+    }
+}
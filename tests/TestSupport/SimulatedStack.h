@@ -0,0 +1,44 @@
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "GPIOHandler/SimulatedGpioChip.h"
+#include "TimerScheduler/TimerScheduler.h"
+
+namespace DebuggerInfrastructure
+{
+    struct SimulatedStackSettings
+    {
+        std::filesystem::path workDir;              ///< Database, config and PWM tree
+        unsigned int buttonLine = 22;
+        std::vector<size_t> laserLines = {16, 17};
+    };
+
+    /**
+     * @brief The interlock and everything below it on simulated hardware: database, GPIO chip, PWM tree,
+     *        lasers, turrets and DeadLocker.
+     *
+     * Brought up in the order main uses and disposed in reverse when it goes out of scope, also when a test
+     * throws halfway. Only one can exist at a time, the subsystems are static.
+     */
+    class SimulatedStack
+    {
+    public:
+        // timers - DeadLocker's scheduler, nullptr for a threaded one
+        explicit SimulatedStack(const SimulatedStackSettings& settings, std::unique_ptr<TimerScheduler> timers = nullptr);
+        ~SimulatedStack();
+
+        SimulatedStack(const SimulatedStack&) = delete;
+        SimulatedStack& operator=(const SimulatedStack&) = delete;
+
+        SimulatedGpioChip& Chip();
+
+    private:
+        void dispose();
+
+        SimulatedGpioChip* m_chip = nullptr;        ///< Owned by GPIOHandler
+        std::vector<std::function<void()>> m_dispose;
+    };
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdio>
+#include <utility>
+#include <fmt/format.h>
+
+namespace DebuggerInfrastructure
+{
+    // Failed expectations of this test executable so far
+    inline int testFailures = 0;
+
+    /**
+     * @brief Prints the failure and counts it, the test goes on so one run shows every broken expectation.
+     */
+    template <typename... Args>
+    void Expect(bool condition, fmt::format_string<Args...> what, Args&&... args)
+    {
+        if (condition) return;
+        testFailures++;
+        fmt::print(stderr, "FAILED: {}\n", fmt::format(what, std::forward<Args>(args)...));
+    }
+
+    // The exit code for ctest
+    inline int TestResult()
+    {
+        if (testFailures != 0) fmt::print(stderr, "{} expectation(s) failed\n", testFailures);
+        return testFailures == 0 ? 0 : 1;
+    }
+}